@@ -4,12 +4,19 @@
 #include "os.h"
 #include "kernel.h"
 #include "radio.h"
+#include "store.h"
+#include "shell.h"
+#include "telemetry.h"
 
 #define JOYSTICK_X_CHANNEL 0
 #define JOYSTICK_Y_CHANNEL 1
 
 #define RADIO_POWER_PIN PL2
 
+// CONFIG, kept in the store.
+#define CONFIG_CHANNEL      (STORE_KEY_APP + 1)
+#define CONFIG_STATE_PERIOD (STORE_KEY_APP + 2)
+
 #define COP1_STATUS_LIGHT PD7 //38
 #define COP2_STATUS_LIGHT PG1 //40
 #define ROBBER1_STATUS_LIGHT PL7 //42
@@ -56,7 +63,7 @@ void sendPacket() {
         Service_Subscribe(radio_send_service, &radio_send_service_value);
 
         // Set target roomba
-        Radio_Set_Tx_Addr(ROOMBA_ADDRESSES[radio_send_service_value]);
+        Radio_Set_Tx_Addr_P(ROOMBA_ADDRESSES[radio_send_service_value]);
 
         // Set packet data
         packet.type = GAMESTATE_PACKET;
@@ -92,12 +99,9 @@ void receivePacket() {
                 switch(in_packet.type) {
                     // Handle roomba state change requests.
                     case ROOMBASTATE_PACKET:
-                        roomba_state = in_packet.payload.roombastate;
-
-                        // A roomba can only change its state if the state isn't forced.
-                        if( (current_game_state.roomba_states[roomba_state.roomba_id] & FORCED) == 0) {
-                            current_game_state.roomba_states[roomba_state.roomba_id] = (roomba_state.roomba_state & (DEAD));
-                        }
+                        roomba_state = in_packet.payload.roombareport.roombastate;
+                        Game_Apply_Roombastate(&current_game_state, &roomba_state);
+                        Telemetry_Record(roomba_state.roomba_id, &in_packet.payload.roombareport.telemetry);
                         break;
                     // Ignore everything else.
                     default:
@@ -182,11 +186,7 @@ void user_input() {
         if( !(PINB & (_BV(PB6))) ) {
             // Starts the game if the game isn't currently running.
             if(current_game_state.game_state != GAME_RUNNING) {
-                current_game_state.game_state = GAME_RUNNING;
-                int i;
-                for(i=COP1; i<=ROBBER2; i++) {
-                    current_game_state.roomba_states[i] = 0;
-                }
+                Game_Start(&current_game_state);
             }
         }
 
@@ -199,24 +199,9 @@ void user_input() {
  */
 void update_gamestate() {
     for(;;) {
-        switch(current_game_state.game_state) {
-        case GAME_RUNNING:
-            // Check if both members of one team are dead.
-            if( ( (current_game_state.roomba_states[COP1] & DEAD) != 0 && (current_game_state.roomba_states[COP2] & DEAD) != 0) ||
-                ( (current_game_state.roomba_states[ROBBER1] & DEAD) != 0 && (current_game_state.roomba_states[ROBBER2] & DEAD) != 0)) {
-
-                // End the game, force all roombas into their current state.
-                current_game_state.game_state = GAME_OVER;
-                int i;
-                for(i=COP1; i<=ROBBER2; i++) {
-                    current_game_state.roomba_states[i] = current_game_state.roomba_states[i] | FORCED;
-                }
-
-                // TODO: discuss automatic revive of winning team.
-            }
-        default:
-            break;
-        }
+        // End the game, forcing all roombas into their current state, once a team is dead.
+        // TODO: discuss automatic revive of winning team.
+        Game_Update(&current_game_state);
         Task_Next();
     }
 }
@@ -261,10 +246,10 @@ int r_main(){
     PORTL |= 1 << RADIO_POWER_PIN;
     _delay_ms(500);
 
-    Radio_Init(BASE_FREQUENCY);
+    Radio_Init((uint8_t)Store_Get(CONFIG_CHANNEL, Flash_Read_Byte(&BASE_FREQUENCY)));
 
     // configure the receive settings for radio pipe 0
-    Radio_Configure_Rx(RADIO_PIPE_0, BASE_ADDRESS, ENABLE);
+    Radio_Configure_Rx_P(RADIO_PIPE_0, BASE_ADDRESS, ENABLE);
 
     // configure radio transceiver settings.
     Radio_Configure(RADIO_1MBPS, RADIO_HIGHEST_POWER);
@@ -284,10 +269,12 @@ int r_main(){
 
     Task_Create_System(sendPacket, 0);
     Task_Create_System(receivePacket, 0);
-    Task_Create_Periodic(sendState, 0, 50, 5, 1000); // 4 times a second.
+    Task_Create_Periodic(sendState, 0, (uint16_t)Store_Get(CONFIG_STATE_PERIOD, 50), 5, 1000); // 4 times a second.
     Task_Create_RR(user_input, 0);
     Task_Create_RR(update_gamestate, 0);
     Task_Create_RR(display_gamestate, 0);
+    Shell_Init();
+    Telemetry_Init();
 
     return 0;
 }
@@ -10,10 +10,15 @@ avr-gcc -Wall -O2 -DF_CPU=16000000UL -mmcu=atmega2560 -c cops_and_robbers.c -o c
 avr-gcc -Wall -O2 -DF_CPU=16000000UL -mmcu=atmega2560 -c spi.c -o spi.o
 avr-gcc -Wall -O2 -DF_CPU=16000000UL -mmcu=atmega2560 -c radio.c -o radio.o
 avr-gcc -Wall -O2 -DF_CPU=16000000UL -mmcu=atmega2560 -c os.c -o os.o
+avr-gcc -Wall -O2 -DF_CPU=16000000UL -mmcu=atmega2560 -c store.c -o store.o
+avr-gcc -Wall -O2 -DF_CPU=16000000UL -mmcu=atmega2560 -c shell.c -o shell.o
+avr-gcc -Wall -O2 -DF_CPU=16000000UL -mmcu=atmega2560 -c telemetry.c -o telemetry.o
+avr-gcc -Wall -O2 -DF_CPU=16000000UL -mmcu=atmega2560 -c irq_profile.c -o irq_profile.o
+avr-gcc -Wall -O2 -DF_CPU=16000000UL -mmcu=atmega2560 -c hrtimer.c -o hrtimer.o
 rm -f main.c
 
 echo "Link..."
-avr-gcc -Wall -O2 -DF_CPU=16000000UL -mmcu=atmega2560 -o main.elf os.o cops_and_robbers.o spi.o radio.o main.o
+avr-gcc -Wall -O2 -DF_CPU=16000000UL -mmcu=atmega2560 -o main.elf os.o store.o shell.o telemetry.o irq_profile.o hrtimer.o cops_and_robbers.o spi.o radio.o main.o
 
 echo "Make HEX..."
 avr-objcopy -j .text -j .data -O ihex main.elf main.hex
@@ -14,6 +14,8 @@ cp roomba/roomba_sci.h roomba_sci.h
 cp roomba/roomba.c roomba.c
 cp roomba/ir.h ir.h
 cp roomba/ir.c ir.c
+cp roomba/decision.h decision.h
+cp roomba/decision.c decision.c
 
 echo "Compile: roomba"
 avr-gcc -Wall -O2 -DF_CPU=16000000UL -mmcu=atmega2560 -c main.c -o main.o
@@ -21,12 +23,18 @@ avr-gcc -Wall -O2 -DF_CPU=16000000UL -mmcu=atmega2560 -c cops_and_robbers.c -o c
 avr-gcc -Wall -O2 -DF_CPU=16000000UL -mmcu=atmega2560 -c spi.c -o spi.o
 avr-gcc -Wall -O2 -DF_CPU=16000000UL -mmcu=atmega2560 -c radio.c -o radio.o
 avr-gcc -Wall -O2 -DF_CPU=16000000UL -mmcu=atmega2560 -c os.c -o os.o
+avr-gcc -Wall -O2 -DF_CPU=16000000UL -mmcu=atmega2560 -c store.c -o store.o
+avr-gcc -Wall -O2 -DF_CPU=16000000UL -mmcu=atmega2560 -c shell.c -o shell.o
+avr-gcc -Wall -O2 -DF_CPU=16000000UL -mmcu=atmega2560 -c telemetry.c -o telemetry.o
+avr-gcc -Wall -O2 -DF_CPU=16000000UL -mmcu=atmega2560 -c irq_profile.c -o irq_profile.o
+avr-gcc -Wall -O2 -DF_CPU=16000000UL -mmcu=atmega2560 -c hrtimer.c -o hrtimer.o
 avr-gcc -Wall -O2 -DF_CPU=16000000UL -mmcu=atmega2560 -c uart.c -o uart.o
 avr-gcc -Wall -O2 -DF_CPU=16000000UL -mmcu=atmega2560 -c roomba.c -o roomba.o
 avr-gcc -Wall -O2 -DF_CPU=16000000UL -mmcu=atmega2560 -c ir.c -o ir.o
+avr-gcc -Wall -O2 -DF_CPU=16000000UL -mmcu=atmega2560 -c decision.c -o decision.o
 
 echo "Link..."
-avr-gcc -Wall -O2 -DF_CPU=16000000UL -mmcu=atmega2560 -o main.elf os.o cops_and_robbers.o spi.o radio.o main.o uart.o roomba.o ir.o
+avr-gcc -Wall -O2 -DF_CPU=16000000UL -mmcu=atmega2560 -o main.elf os.o store.o shell.o telemetry.o irq_profile.o hrtimer.o cops_and_robbers.o spi.o radio.o main.o uart.o roomba.o ir.o decision.o
 
 echo "Make HEX..."
 avr-objcopy -j .text -j .data -O ihex main.elf main.hex
@@ -42,6 +50,8 @@ rm -f roomba_sci.h
 rm -f roomba.c
 rm -f ir.h
 rm -f ir.c
+rm -f decision.h
+rm -f decision.c
 
 echo "Uploading..."
 sudo avrdude -p m2560 -c wiring -P /dev/tty.usbmodem1411 -U flash:w:main.hex:i
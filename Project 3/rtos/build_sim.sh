@@ -0,0 +1,3 @@
+echo "Compile: sim"
+gcc -Wall -O2 -pthread -I. -Iroomba -o sim/montecarlo sim/montecarlo.c sim/game.c sim/arena.c sim/pool.c roomba/decision.c cops_and_robbers.c -lm
+gcc -Wall -O2 -I. -Iroomba -o sim/arenabench sim/arenabench.c sim/arena.c roomba/decision.c cops_and_robbers.c -lm
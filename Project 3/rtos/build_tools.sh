@@ -0,0 +1,3 @@
+echo "Compile: tools"
+gcc -Wall -O2 -I. -o tools/rta tools/rta_main.c tools/rta.c tools/taskset.c tools/error_name.c
+gcc -Wall -O2 -I. -o tools/crash tools/crash.c tools/error_name.c
@@ -0,0 +1,39 @@
+# Build the roomba and the base station against tools/wcet/wcet_os.c and measure their
+# PERIODIC tasks under simavr.  SIMAVR is where simavr is installed.
+SIMAVR=${SIMAVR:-/usr/local}
+
+echo "Clean..."
+rm -f *.o
+rm -f *.elf
+
+echo "Compile: wcet"
+gcc -Wall -O2 -I. -Iroomba -Itools/wcet -I$SIMAVR/include/simavr -o tools/wcet/wcet tools/wcet/wcet.c -L$SIMAVR/lib -lsimavr -lelf -lm
+
+echo "Prepare: roomba"
+cp roomba/*.c roomba/*.h .
+mv main.c roomba_main.c
+
+echo "Compile: roomba"
+for f in roomba_main.c cops_and_robbers.c spi.c radio.c store.c shell.c telemetry.c irq_profile.c uart.c roomba.c ir.c decision.c tools/wcet/wcet_os.c; do
+    avr-gcc -Wall -O2 -DF_CPU=16000000UL -mmcu=atmega2560 -I. -Itools/wcet -c $f -o $(basename $f .c).o
+done
+avr-gcc -Wall -O2 -DF_CPU=16000000UL -mmcu=atmega2560 -o tools/wcet/roomba.elf roomba_main.o cops_and_robbers.o spi.o radio.o store.o shell.o telemetry.o irq_profile.o uart.o roomba.o ir.o decision.o wcet_os.o
+
+echo "Clean: roomba"
+rm -f roomba_main.c sensor_struct.h uart.h blocking_uart.h uart.c roomba.h roomba_sci.h roomba.c ir.h ir.c decision.h decision.c c_buffer.h
+rm -f *.o
+
+echo "Compile: base_station"
+cp base_station/main.c base_main.c
+for f in base_main.c cops_and_robbers.c spi.c radio.c store.c shell.c telemetry.c irq_profile.c tools/wcet/wcet_os.c; do
+    avr-gcc -Wall -O2 -DF_CPU=16000000UL -mmcu=atmega2560 -I. -Itools/wcet -c $f -o $(basename $f .c).o
+done
+avr-gcc -Wall -O2 -DF_CPU=16000000UL -mmcu=atmega2560 -o tools/wcet/base_station.elf base_main.o cops_and_robbers.o spi.o radio.o store.o shell.o telemetry.o irq_profile.o wcet_os.o
+rm -f base_main.c
+rm -f *.o
+
+echo "Measure: roomba_interface"
+./tools/wcet/wcet -t roomba_interface tools/wcet/roomba.elf tools/wcet/traffic/roomba.traffic
+
+echo "Measure: sendState"
+./tools/wcet/wcet -t sendState tools/wcet/base_station.elf tools/wcet/traffic/base_station.traffic
@@ -6,15 +6,92 @@
  */
 
 #include "cops_and_robbers.h"
-#include "avr/io.h"
 
-uint8_t BASE_ADDRESS[5] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
-uint8_t ROOMBA_ADDRESSES[4][5] = {
+const uint8_t BASE_ADDRESS[5] FLASH = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+const uint8_t ROOMBA_ADDRESSES[4][5] FLASH = {
 	{0x4A,0x4A,0x4A,0x4A,0x4A},
   {0x4A,0x4A,0x4A,0x4A,0x4A},
   {0x4A,0x4A,0x4A,0x4A,0x4A},
   {0x4A,0x4A,0x4A,0x4A,0x4A}
 };
 
-uint8_t BASE_FREQUENCY = 102;
-uint8_t ROOMBA_FREQUENCIES [4] = {104, 106, 108, 110};
+const uint8_t BASE_FREQUENCY FLASH = 102;
+const uint8_t ROOMBA_FREQUENCIES [4] FLASH = {104, 106, 108, 110};
+
+void Game_Start(pf_gamestate_t* gamestate)
+{
+	int i;
+	gamestate->game_state = GAME_RUNNING;
+	for(i=COP1; i<=ROBBER2; i++) {
+		gamestate->roomba_states[i] = 0;
+	}
+}
+
+uint8_t Game_Update(pf_gamestate_t* gamestate)
+{
+	int i;
+	if(gamestate->game_state != GAME_RUNNING) {
+		return 0;
+	}
+
+	// Check if both members of one team are dead.
+	if( ( (gamestate->roomba_states[COP1] & DEAD) != 0 && (gamestate->roomba_states[COP2] & DEAD) != 0) ||
+		( (gamestate->roomba_states[ROBBER1] & DEAD) != 0 && (gamestate->roomba_states[ROBBER2] & DEAD) != 0)) {
+
+		// End the game, force all roombas into their current state.
+		gamestate->game_state = GAME_OVER;
+		for(i=COP1; i<=ROBBER2; i++) {
+			gamestate->roomba_states[i] = gamestate->roomba_states[i] | FORCED;
+		}
+		return 1;
+	}
+	return 0;
+}
+
+void Game_Apply_Roombastate(pf_gamestate_t* gamestate, const pf_roombastate_t* roombastate)
+{
+	// A roomba can only change its state if the state isn't forced.
+	if( (gamestate->roomba_states[roombastate->roomba_id] & FORCED) == 0) {
+		gamestate->roomba_states[roombastate->roomba_id] = (roombastate->roomba_state & (DEAD));
+	}
+}
+
+uint8_t Game_Sync_Roomba(pf_gamestate_t* gamestate, COPS_AND_ROBBERS identity, uint8_t* roomba_state)
+{
+	// Roomba is in control of their own state.
+	if((gamestate->roomba_states[identity] & FORCED) == 0) {
+		// If previously not in control, copy from gamestate.
+		if((*roomba_state & FORCED) != 0) {
+			*roomba_state = gamestate->roomba_states[identity];
+		}
+		// If gamestate does not match your expectations, update the base station.
+		else if(gamestate->roomba_states[identity] != *roomba_state) {
+			gamestate->roomba_states[identity] = *roomba_state;
+			return 1;
+		}
+	}
+	// Just copy your state from the base station.
+	else {
+		*roomba_state = gamestate->roomba_states[identity];
+	}
+	return 0;
+}
+
+uint8_t Game_Apply_IR(uint8_t ir_value, IR_TEAM_CODE team, IR_TEAM_CODE enemy, uint8_t* roomba_state)
+{
+	// IR only effects the roomba when state is changable.
+	if((*roomba_state & FORCED) != 0) {
+		return 0;
+	}
+	// Revive if shot by a team member.
+	if (ir_value == team) {
+		*roomba_state &= ~DEAD;
+		return 1;
+	}
+	// Kill if shot by an enemy.
+	if (ir_value == enemy) {
+		*roomba_state |= DEAD;
+		return 1;
+	}
+	return 0;
+}
@@ -9,7 +9,8 @@
 #ifndef COPS_AND_ROBBERS_H_
 #define COPS_AND_ROBBERS_H_
 
-#include "avr/io.h"
+#include <stdint.h>
+#include "flash.h"
 
 #define DEAD 1 << 0
 #define FORCED 1 << 1
@@ -45,10 +46,32 @@ typedef struct _roomba_pkt
   uint8_t roomba_state; // DEAD | FORCED
 } pf_roombastate_t;
 
-extern uint8_t BASE_ADDRESS[5];
-extern uint8_t ROOMBA_ADDRESSES[][5];
+/// Radio addresses and channels, in flash: read them with the Flash_Read functions or the
+/// radio's _P functions.
+extern const uint8_t BASE_ADDRESS[5] FLASH;
+extern const uint8_t ROOMBA_ADDRESSES[][5] FLASH;
 
-extern uint8_t BASE_FREQUENCY;
-extern uint8_t ROOMBA_FREQUENCIES[];
+extern const uint8_t BASE_FREQUENCY FLASH;
+extern const uint8_t ROOMBA_FREQUENCIES[] FLASH;
+
+/*
+ * Game rules, shared by the base station, the roombas and the game simulator.
+ */
+
+/// Base station: start a new game with every roomba alive.
+void Game_Start(pf_gamestate_t* gamestate);
+
+/// Base station: end the game once a whole team is dead.  Returns 1 if the game just ended.
+uint8_t Game_Update(pf_gamestate_t* gamestate);
+
+/// Base station: apply a roomba's report of its own state.
+void Game_Apply_Roombastate(pf_gamestate_t* gamestate, const pf_roombastate_t* roombastate);
+
+/// Roomba: merge a gamestate received from the base station with the roomba's own state.
+/// Returns 1 if the base station has to be told about the roomba's state.
+uint8_t Game_Sync_Roomba(pf_gamestate_t* gamestate, COPS_AND_ROBBERS identity, uint8_t* roomba_state);
+
+/// Roomba: apply an IR code received from another roomba.  Returns 1 if the shot counted.
+uint8_t Game_Apply_IR(uint8_t ir_value, IR_TEAM_CODE team, IR_TEAM_CODE enemy, uint8_t* roomba_state);
 
 #endif /* COPS_AND_ROBBERS_H_ */
@@ -50,6 +50,15 @@ ERR_RUN_7_PERIODIC_TASK_SUBSCRIBED,
  * may happen when a task is destroyed and recreated as periodic before a publish occurs. */
 ERR_RUN_8_PERIODIC_TASK_FOUND_SUBSCRIBED,
 
+/** A background job run by the idle task attempted to subscribe to a service */
+ERR_RUN_9_IDLE_JOB_SUBSCRIBED,
+
+/** A PERIODIC task or a background job attempted to wait in Task_Join() */
+ERR_RUN_10_ILLEGAL_JOIN,
+
+/** A PERIODIC task or a background job attempted to wait in Channel_Read() */
+ERR_RUN_11_ILLEGAL_CHANNEL_WAIT,
+
 };
 
 
@@ -0,0 +1,80 @@
+/**
+ * @file   flash.h
+ *
+ * @brief Constant tables kept in program memory.
+ *
+ * The AVR keeps initialised data in RAM, even when it is const: the startup code copies it
+ * from flash into .data before main() runs.  A table declared with FLASH stays in flash and
+ * costs no RAM, but it must be read with the Flash_Read functions below instead of through
+ * a plain pointer.  They read with LPM, which reaches the first 64 KB of flash; the linker
+ * puts every FLASH table there, ahead of the code, even on the ATmega2560, so ELPM is never
+ * needed.
+ *
+ * String literals go in flash with PSTR(), as in avr-libc.
+ *
+ * Off the AVR, as in the simulator, FLASH and PSTR() are empty and the functions read RAM.
+ */
+
+#ifndef FLASH_H_
+#define FLASH_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __AVR__
+
+#include <avr/pgmspace.h>
+
+/** Place a const table in flash. */
+#define FLASH       PROGMEM
+
+static inline uint8_t Flash_Read_Byte(const uint8_t* p)
+{
+    return pgm_read_byte(p);
+}
+
+static inline uint16_t Flash_Read_Word(const uint16_t* p)
+{
+    return pgm_read_word(p);
+}
+
+/** A pointer stored in a FLASH table. */
+static inline const void* Flash_Read_Ptr(const void* const* p)
+{
+    return (const void*)pgm_read_word(p);
+}
+
+/** Copy n bytes out of a FLASH table into RAM. */
+static inline void Flash_Read(void* dst, const void* src, size_t n)
+{
+    memcpy_P(dst, src, n);
+}
+
+#else
+
+#define FLASH
+#define PSTR(s)     (s)
+
+static inline uint8_t Flash_Read_Byte(const uint8_t* p)
+{
+    return *p;
+}
+
+static inline uint16_t Flash_Read_Word(const uint16_t* p)
+{
+    return *p;
+}
+
+static inline const void* Flash_Read_Ptr(const void* const* p)
+{
+    return *p;
+}
+
+static inline void Flash_Read(void* dst, const void* src, size_t n)
+{
+    memcpy(dst, src, n);
+}
+
+#endif
+
+#endif /* FLASH_H_ */
@@ -0,0 +1,190 @@
+/**
+ * @file   hrtimer.c
+ *
+ * @brief One-shot deadlines on Timer 1 OCR1B.  See hrtimer.h.
+ *
+ * Timer 1 runs free, so deadlines are compared by their distance from TCNT1 as signed
+ * numbers, which is right for anything less than half a turn away.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "hrtimer.h"
+#include "kernel.h"
+#include "irq_profile.h"
+
+/** What a deadline's pending holds. */
+#define PENDING         1
+#define DUE             2
+
+static hrtimer_t hrtimers[HRTIMER_MAX];
+static uint8_t hrtimer_count;
+
+/** The pending deadlines, earliest first. */
+static hrtimer_t* queue;
+
+/**
+ * Set OCR1B to the earliest deadline, or stop the interrupt if none is pending.
+ * Interrupts are disabled.
+ */
+static void arm(void)
+{
+    if(queue == NULL)
+    {
+        TIMSK1 &= ~_BV(OCIE1B);
+        return;
+    }
+    OCR1B = queue->deadline;
+    TIFR1 = _BV(OCF1B);
+    TIMSK1 |= _BV(OCIE1B);
+
+    /* A deadline that has come, or comes before OCR1B is set, would wait a whole turn. */
+    if((int16_t)(queue->deadline - TCNT1) <= HRTIMER_MARGIN)
+    {
+        OCR1B = TCNT1 + HRTIMER_MARGIN;
+    }
+}
+
+/**
+ * Take a deadline out of the queue, if it is pending, so it does not fall.  Interrupts are
+ * disabled.
+ */
+static void remove_deadline(hrtimer_t* t)
+{
+    hrtimer_t** link;
+
+    if(t->pending != PENDING)
+    {
+        /* A DUE deadline is already out of the queue; the interrupt handler skips it. */
+        t->pending = 0;
+        return;
+    }
+    for(link = &queue; *link != t; link = &(*link)->next)
+    {
+    }
+    *link = t->next;
+    t->pending = 0;
+}
+
+static hrtimer_t* init(void (*f)(int16_t), int16_t arg, service_t* s)
+{
+    hrtimer_t* t;
+
+    if(hrtimer_count >= HRTIMER_MAX)
+    {
+        return NULL;
+    }
+    t = &hrtimers[hrtimer_count++];
+    t->f = f;
+    t->arg = arg;
+    t->service = s;
+    return t;
+}
+
+hrtimer_t* HrTimer_Init(void (*f)(int16_t), int16_t arg)
+{
+    return init(f, arg, NULL);
+}
+
+hrtimer_t* HrTimer_Init_Publish(service_t* s, int16_t v)
+{
+    return init(NULL, v, s);
+}
+
+void HrTimer_Start(hrtimer_t* t, uint16_t us)
+{
+    uint8_t sreg = SREG;
+    hrtimer_t** link;
+    uint16_t now;
+
+    if(us > HRTIMER_MAX_US)
+    {
+        us = HRTIMER_MAX_US;
+    }
+
+    cli();
+    IRQ_PROFILE_DISABLE();
+    remove_deadline(t);
+
+    now = TCNT1;
+    t->deadline = now + us * US_CYCLES;
+    for(link = &queue; *link != NULL; link = &(*link)->next)
+    {
+        if((int16_t)((*link)->deadline - t->deadline) > 0)
+        {
+            break;
+        }
+    }
+    t->next = *link;
+    *link = t;
+    t->pending = PENDING;
+
+    if(queue == t)
+    {
+        arm();
+    }
+    IRQ_PROFILE_RESTORE(sreg);
+    SREG = sreg;
+}
+
+void HrTimer_Cancel(hrtimer_t* t)
+{
+    uint8_t sreg = SREG;
+    uint8_t first;
+
+    cli();
+    IRQ_PROFILE_DISABLE();
+    first = queue == t;
+    remove_deadline(t);
+    if(first)
+    {
+        arm();
+    }
+    IRQ_PROFILE_RESTORE(sreg);
+    SREG = sreg;
+}
+
+ISR(TIMER1_COMPB_vect)
+{
+    hrtimer_t* due[HRTIMER_MAX];
+    uint8_t count = 0;
+    uint8_t i;
+    hrtimer_t* t;
+
+    IRQ_PROFILE_ISR_ENTER();
+
+    /* Take every deadline that has come and set OCR1B for the next before serving any: a
+     * publish that wakes a SYSTEM task switches to it here, and anything still to do in
+     * this handler would wait until the interrupted task runs again. */
+    while(queue != NULL && (int16_t)(queue->deadline - TCNT1) <= HRTIMER_MARGIN)
+    {
+        t = queue;
+        queue = t->next;
+        t->pending = DUE;
+        due[count++] = t;
+    }
+    arm();
+
+    /* The functions, which do not switch tasks, then the publishes.  A function may start or
+     * cancel a deadline that is DUE, which then is not served. */
+    for(i = 0; i < count; ++i)
+    {
+        t = due[i];
+        if(t->pending == DUE && t->f != NULL)
+        {
+            t->pending = 0;
+            t->f(t->arg);
+        }
+    }
+    for(i = 0; i < count; ++i)
+    {
+        t = due[i];
+        if(t->pending == DUE)
+        {
+            t->pending = 0;
+            Service_Publish(t->service, t->arg);
+        }
+    }
+
+    IRQ_PROFILE_ISR_EXIT();
+}
@@ -0,0 +1,79 @@
+/**
+ * @file   hrtimer.h
+ *
+ * @brief One-shot deadlines to the microsecond, sharing the Timer 1 OCR1B compare channel.
+ *
+ * Timer 1 counts every 0.5 us for the kernel's TICK, which only uses OCR1A.  The pending
+ * deadlines are kept in a queue sorted by when they fall, and OCR1B is set to the earliest;
+ * its interrupt calls the function of each deadline that has come and sets OCR1B to the next.
+ * So any number of drivers can wait for a few microseconds to a few milliseconds without a
+ * timer of their own, or a busy wait.
+ *
+ * A deadline either calls a function in the interrupt handler, which must be short, or
+ * publishes a value to a service, to wake the task waiting for it.  Deadlines that fall within
+ * HRTIMER_MARGIN counts of each other are all served by the same interrupt.  A deadline is at
+ * most HRTIMER_MAX_US ahead, half a turn of Timer 1; wait longer with a software timer
+ * (Timer_Init()).
+ */
+
+#ifndef HRTIMER_H_
+#define HRTIMER_H_
+
+#include <stdint.h>
+#include "os.h"
+
+/** Number of deadlines. */
+#define HRTIMER_MAX         8
+
+/** The longest wait, in us. */
+#define HRTIMER_MAX_US      16000
+
+/** Timer 1 counts: a deadline this close is served now rather than by another interrupt. */
+#define HRTIMER_MARGIN      8
+
+/** A one-shot deadline. */
+typedef struct hrtimer hrtimer_t;
+struct hrtimer
+{
+    /** Called in the interrupt handler, or NULL to publish arg to service. */
+    void (*f)(int16_t);
+    int16_t arg;
+    service_t* service;
+    /** Timer 1 when it falls. */
+    uint16_t deadline;
+    /** Waiting in the queue, or come and waiting to be served by the interrupt handler. */
+    uint8_t pending;
+    hrtimer_t* next;
+};
+
+/**
+ * \param f the function to call in the interrupt handler when the deadline comes
+ * \param arg the argument to pass to \a f
+ * \return a deadline that is not pending, or NULL if HRTIMER_MAX have been made.
+ */
+hrtimer_t* HrTimer_Init(void (*f)(int16_t), int16_t arg);
+
+/**
+ * \param s the service to publish to when the deadline comes
+ * \param v the value to publish
+ * \return a deadline that is not pending, or NULL if HRTIMER_MAX have been made.
+ */
+hrtimer_t* HrTimer_Init_Publish(service_t* s, int16_t v);
+
+/**
+ * \param t a deadline
+ * \param us how long from now it falls, up to HRTIMER_MAX_US
+ *
+ * A pending deadline is moved.  Tasks, interrupt handlers and deadline functions may start and
+ * cancel deadlines.
+ */
+void HrTimer_Start(hrtimer_t* t, uint16_t us);
+
+/**
+ * \param t a deadline
+ *
+ * The deadline no longer falls, if it was pending.
+ */
+void HrTimer_Cancel(hrtimer_t* t);
+
+#endif /* HRTIMER_H_ */
@@ -0,0 +1,138 @@
+/**
+ * @file   irq_profile.c
+ *
+ * @brief Find the longest windows with interrupts disabled.  See irq_profile.h.
+ *
+ * Read and Clear disable interrupts themselves without being profiled, so they do not
+ * record windows of their own.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "irq_profile.h"
+
+#if IRQ_PROFILE
+
+/** The window being measured. */
+static uint8_t open;
+static uint16_t open_start;
+static const char* open_file;
+static uint16_t open_line;
+
+static irq_window_t windows[IRQ_PROFILE_TOP];
+static uint8_t window_count;
+
+void Irq_Profile_Open(uint16_t start, const char* file, uint16_t line)
+{
+    if(open)
+    {
+        return;
+    }
+    open = 1;
+    open_start = start;
+    open_file = file;
+    open_line = line;
+}
+
+void Irq_Profile_Close(void)
+{
+    uint16_t length = TCNT1 - open_start;
+    irq_window_t* shortest = NULL;
+    uint8_t i;
+
+    if(!open)
+    {
+        return;
+    }
+    open = 0;
+
+    for(i = 0; i < window_count; ++i)
+    {
+        if(windows[i].file == open_file && windows[i].line == open_line)
+        {
+            ++windows[i].count;
+            if(length > windows[i].length)
+            {
+                windows[i].length = length;
+            }
+            return;
+        }
+        if(shortest == NULL || windows[i].length < shortest->length)
+        {
+            shortest = &windows[i];
+        }
+    }
+
+    if(window_count < IRQ_PROFILE_TOP)
+    {
+        shortest = &windows[window_count++];
+    }
+    else if(length <= shortest->length)
+    {
+        return;
+    }
+    shortest->length = length;
+    shortest->file = open_file;
+    shortest->line = open_line;
+    shortest->count = 1;
+}
+
+uint8_t Irq_Profile_Read(irq_window_t* copy)
+{
+    uint8_t sreg = SREG;
+    uint8_t count, i, j;
+
+    cli();
+    count = window_count;
+    for(i = 0; i < count; ++i)
+    {
+        copy[i] = windows[i];
+    }
+    SREG = sreg;
+
+    /* Longest first. */
+    for(i = 1; i < count; ++i)
+    {
+        irq_window_t window = copy[i];
+        for(j = i; j > 0 && copy[j - 1].length < window.length; --j)
+        {
+            copy[j] = copy[j - 1];
+        }
+        copy[j] = window;
+    }
+    return count;
+}
+
+void Irq_Profile_Clear(void)
+{
+    uint8_t sreg = SREG;
+
+    cli();
+    window_count = 0;
+    SREG = sreg;
+}
+
+#else
+
+void Irq_Profile_Open(uint16_t start, const char* file, uint16_t line)
+{
+    (void)start;
+    (void)file;
+    (void)line;
+}
+
+void Irq_Profile_Close(void)
+{
+}
+
+uint8_t Irq_Profile_Read(irq_window_t* copy)
+{
+    (void)copy;
+    return 0;
+}
+
+void Irq_Profile_Clear(void)
+{
+}
+
+#endif
@@ -0,0 +1,91 @@
+/**
+ * @file   irq_profile.h
+ *
+ * @brief Find the longest windows with interrupts disabled.
+ *
+ * No interrupt can be served sooner than the longest stretch of code that runs with interrupts
+ * disabled.  Build everything with -DIRQ_PROFILE=1 and each place that disables interrupts (a
+ * cli, or entry to an interrupt handler) notes Timer 1 and its file and line; the place that
+ * enables them again (a sei, restoring SREG, leaving the handler or leaving the kernel) works
+ * out how long they were off.  The IRQ_PROFILE_TOP longest windows are kept, one per place,
+ * and the shell prints them with its 'w' command.
+ *
+ * Times are in Timer 1 counts (0.5 us).  A window starts after the compiler's prologue of an
+ * interrupt handler and ends before the kernel restores a task's registers, so each is a few
+ * us short.  Windows over 32 ms are not measured correctly.
+ *
+ * With IRQ_PROFILE 0 the macros are empty and nothing is measured.
+ */
+
+#ifndef IRQ_PROFILE_H_
+#define IRQ_PROFILE_H_
+
+#include <stdint.h>
+#include <avr/io.h>
+
+#ifndef IRQ_PROFILE
+#define IRQ_PROFILE         0
+#endif
+
+/** Number of windows kept. */
+#define IRQ_PROFILE_TOP     8
+
+/** The longest window that started at one place. */
+typedef struct
+{
+    /** Timer 1 counts (0.5 us). */
+    uint16_t length;
+    /** The file name, in program memory, and line that disabled interrupts. */
+    const char* file;
+    uint16_t line;
+    /** Windows that started here since the last clear. */
+    uint16_t count;
+} irq_window_t;
+
+#if IRQ_PROFILE
+
+#include <avr/pgmspace.h>
+
+/** Just after interrupts are disabled. */
+#define IRQ_PROFILE_DISABLE()       Irq_Profile_Open(TCNT1, PSTR(__FILE__), __LINE__)
+/** Just before SREG is restored to sreg, which may enable interrupts. */
+#define IRQ_PROFILE_RESTORE(sreg)   do { if((sreg) & _BV(SREG_I)) Irq_Profile_Close(); } while(0)
+/** Just before interrupts are enabled. */
+#define IRQ_PROFILE_ENABLE()        Irq_Profile_Close()
+/** First and last thing in an interrupt handler. */
+#define IRQ_PROFILE_ISR_ENTER()     Irq_Profile_Open(TCNT1, PSTR(__FILE__), __LINE__)
+#define IRQ_PROFILE_ISR_EXIT()      Irq_Profile_Close()
+/** Interrupts have been disabled since Timer 1 read start. */
+#define IRQ_PROFILE_SINCE(start)    Irq_Profile_Open((start), PSTR(__FILE__), __LINE__)
+
+#else
+
+#define IRQ_PROFILE_DISABLE()       do { } while(0)
+#define IRQ_PROFILE_RESTORE(sreg)   do { } while(0)
+#define IRQ_PROFILE_ENABLE()        do { } while(0)
+#define IRQ_PROFILE_ISR_ENTER()     do { } while(0)
+#define IRQ_PROFILE_ISR_EXIT()      do { } while(0)
+#define IRQ_PROFILE_SINCE(start)    do { } while(0)
+
+#endif
+
+/**
+ * Start a window, unless one is open already.  Interrupts are disabled.
+ */
+void Irq_Profile_Open(uint16_t start, const char* file, uint16_t line);
+
+/**
+ * End the open window, if any.  Interrupts are still disabled.
+ */
+void Irq_Profile_Close(void);
+
+/**
+ * \param windows where to copy the windows, IRQ_PROFILE_TOP of them
+ * \return the number copied, longest first.
+ */
+uint8_t Irq_Profile_Read(irq_window_t* windows);
+
+/** Forget the windows measured so far. */
+void Irq_Profile_Clear(void);
+
+#endif /* IRQ_PROFILE_H_ */
@@ -43,15 +43,13 @@ extern "C" {
 /** The maximum number of names. Currently the same as the number of tasks. */
 #define 	MAXNAME		MAXPROCESS
 
-/** The RTOS timer's prescaler divisor */
-#define TIMER_PRESCALER 8
+/** Task ids count up by this much each time a descriptor is reused, up to 127. */
+#define ID_STRIDE       (MAXPROCESS + 1)
+/** The number of tasks a descriptor holds before its ids repeat. */
+#define ID_GENERATIONS  (127 / ID_STRIDE)
 
-/** The number of clock cycles in one "tick" or 5 ms */
-#define MS_CYCLES       ((F_CPU / TIMER_PRESCALER) / 1000)
-#define MS_CYCLES2      (MS_CYCLES * 2)
-#define MS_CYCLES3      (MS_CYCLES * 3)
-#define MS_CYCLES4      (MS_CYCLES * 4)
-#define TICK_CYCLES     (((F_CPU / TIMER_PRESCALER) / 1000) * TICK)
+/** Timer 1 counts OCR1A is set ahead of TCNT1 at least, so a match is not missed. */
+#define TIMER_MARGIN    16
 
 /** LEDs for OS_Abort() */
 #define LED_MASK    (_BV(PB7))
@@ -99,13 +97,123 @@ typedef struct
     int arg;
     /** Priority of the new task: RR, PERIODIC, SYSTEM */
     uint8_t level;
-    /** If the new task is PERIODIC, it has some special arguments. */
-    uint16_t period;
-    uint16_t wcet;
-    uint16_t start;
+    /** If the new task is PERIODIC, it has some special arguments, in Timer 1 counts. */
+    uint32_t period;
+    uint32_t wcet;
+    uint32_t wcet_hi;
+    uint32_t start;
+    /** start counts from the last TICK rather than from now. */
+    uint8_t from_tick;
+    /** CRIT_LO or CRIT_HI. */
+    uint8_t criticality;
+    /** The partition of the new task. */
+    uint8_t partition;
+    /** The reservation group of the new task, or 0. */
+    uint8_t group;
 }
 create_args_t;
 
+/**
+ * @brief A background job waiting for the idle task.
+ */
+typedef struct
+{
+    void (*f)(int16_t);
+    int16_t arg;
+}
+idle_job_t;
+
+/**
+ * @brief The tasks of one partition, scheduled as if they had the CPU to themselves.
+ */
+typedef struct
+{
+    /** The ready queue for SYSTEM tasks. Their scheduling is first come, first served. */
+    queue_t system_queue;
+    /** The active queue for PERIODIC tasks. */
+    list_t periodic_list;
+    /** The ready queue for RR tasks. Their scheduling is round-robin. */
+    queue_t rr_queue;
+    /** Timer 1 counts left in the current PERIODIC task's slot. */
+    uint32_t slot_remaining;
+    /** The slot has been stretched from the task's wcet to its wcet_hi. */
+    uint8_t extended;
+    /** The mode: CRIT_HI from a HI task overrunning its wcet until no HI task is ready. */
+    uint8_t criticality;
+#if RR_STRIDE
+    /** The pass of the RR task dispatched last. */
+    uint32_t rr_pass;
+#endif
+}
+partition_t;
+
+/**
+ * @brief A software timer.
+ */
+struct soft_timer
+{
+    void (*f)(int16_t);
+    int16_t arg;
+    /** TICKs from starting until it expires. */
+    uint16_t ticks;
+    uint8_t reload;
+    /** In the list of running timers. */
+    uint8_t running;
+    /** In the queue of expired timers waiting for the daemon. */
+    uint8_t expired;
+    /** TICKs after the timer before it in the list expires. */
+    uint16_t delta;
+    /** The next running timer. */
+    soft_timer_t* next;
+    /** The next expired timer. */
+    soft_timer_t* next_expired;
+};
+
+/**
+ * @brief A channel between pipeline stages: a ring buffer of items, each after its time.
+ */
+struct channel
+{
+    uint8_t* buffer;
+    uint8_t size;
+    uint8_t capacity;
+    uint8_t policy;
+    /** The oldest item, and the number held. */
+    uint8_t head;
+    uint8_t count;
+    /** Tasks waiting for an item, and for room. */
+    queue_t readers;
+    queue_t writers;
+};
+
+/**
+ * @brief A reservation group: a budget of TICKs every period, shared by its RR tasks.
+ */
+typedef struct
+{
+    uint16_t budget;
+    uint16_t period;
+    /** TICKs of the budget left in this period; the members wait while it is 0. */
+    uint16_t remaining;
+    /** TICKs until the next period begins. */
+    uint16_t countdown;
+    /** See group_info_t. */
+    uint16_t used;
+    uint16_t depleted;
+}
+group_t;
+
+/**
+ * @brief A window of the major frame, when one partition has the CPU.
+ */
+typedef struct
+{
+    uint8_t partition;
+    /** Length in TICKs. */
+    uint16_t ticks;
+}
+window_t;
+
 /**
  * @brief All the data needed to describe the task, including its context.
  */
@@ -115,12 +223,14 @@ struct td_struct
     uint8_t                         stack[MAXSTACK];
     /** A variable to save the hardware SP into when the task is suspended. */
     uint8_t*               volatile sp;   /* stack pointer into the "workSpace" */
-    /** PERIODIC tasks need a known period. */
-    uint16_t                        period;
-    /** PERIODIC tasks need a known worst case execution time. */
-    uint16_t                        wcet;
-    /** PERIODIC tasks have a countdown until the next time they run. */
-    int16_t                        countdown;
+    /** PERIODIC tasks need a known period, in Timer 1 counts. */
+    uint32_t                        period;
+    /** PERIODIC tasks need a known worst case execution time, in Timer 1 counts. */
+    uint32_t                        wcet;
+    /** HI PERIODIC tasks may run this long once their partition is in HI mode. */
+    uint32_t                        wcet_hi;
+    /** PERIODIC tasks: the kernel time of the next release. */
+    uint32_t                        next_release;
     /** The state of the task in this descriptor. */
     task_state_t                    state;
     /** The argument passed to Task_Create for this task. */
@@ -133,6 +243,45 @@ struct td_struct
     task_descriptor_t*              next;
     /** A link to the value to store service posts in. */
     int16_t*                        value;
+    /** The partition this task runs in. */
+    uint8_t                         partition;
+    /** The partition of the tasks this task creates. */
+    uint8_t                         child_partition;
+    /** CRIT_LO tasks are put aside while their partition is in HI mode. */
+    uint8_t                         criticality;
+    /** The criticality of the tasks this task creates. */
+    uint8_t                         child_criticality;
+    /** The reservation group of an RR task, or 0. */
+    uint8_t                         group;
+    /** The reservation group of the RR tasks this task creates. */
+    uint8_t                         child_group;
+    /** Set by Task_Suspend(): the task stays out of the ready queues until Task_Resume(). */
+    uint8_t                         suspended;
+    /** The number of tasks that have terminated in this descriptor, modulo ID_GENERATIONS. */
+    uint8_t                         generation;
+    /** The task a task WAITING in Task_Join() waits for, or NULL. */
+    task_descriptor_t*              joining;
+    /** Set by Task_Set_Priority(): the order tasks waiting together are woken in. */
+    uint8_t                         priority;
+    /** The time of the channel item the task read last, if it has read one. */
+    uint8_t                         stamped;
+    uint32_t                        stamp;
+#if RR_STRIDE
+    /** RR tasks: STRIDE1 / weight, and the sum of the strides of the quanta started. */
+    uint16_t                        stride;
+    uint32_t                        pass;
+#endif
+#if OS_STATS
+    /** Time this task has run, in Timer 1 counts. */
+    uint32_t                        run_time;
+    /** PERIODIC tasks: the kernel time the current activation was released. */
+    uint32_t                        release;
+    /** The service whose publish woke the task, until it is dispatched, and TCNT1 then. */
+    service_t*                      woken_by;
+    uint16_t                        woken_at;
+    /** Bytes of the stack still painted when it was last looked at. */
+    uint16_t                        stack_free;
+#endif
 };
 
 #ifdef __cplusplus
@@ -13,34 +13,70 @@
 #include <avr/interrupt.h>
 #include <util/delay.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "os.h"
 #include "kernel.h"
 #include "error_code.h"
 #include "port_map.h"
+#include "store.h"
+#include "irq_profile.h"
 
-#define USE_AVR2560_GREATER 1
-
-/* The stack grows down in memory, so the stack pointer is going to end up
-     * pointing to the location 32 + 1 + 2 + 2 = 37 bytes above the bottom, to make
-     * room for (from bottom to top):
-     *   the address of Task_Terminate() to destroy the task if it ever returns,
-     *   the address of the start of the task to "return" to the first time it runs,
-     *   register 31,
-     *   the stored EIND (for 2560), and
-     *   the stored SREG, and
-     *   registers 30 to 0.
-     */
-#if USE_AVR2560_GREATER
-    #define STACKCONTEXTSIZE (32 + 1 + 1 + 3 + 3)
-    #define KERNELARG_STACKOFFSET (32 + 1 + 1 + 1)
+#if CRASH_SNAPSHOT
+#include <avr/eeprom.h>
+#endif
+
+/*
+ * The context frame a task's stack holds while it is not running, from the top of the stack
+ * (the lowest address) down:
+ *   registers 0 to 30,
+ *   the stored SREG,
+ *   the stored RAMPZ, if the MCU has one (ELPM on parts with more than 64 KB of flash),
+ *   the stored EIND, if the MCU has one (EICALL and EIJMP on parts with a 3 byte PC),
+ *   register 31,
+ *   the address to return to: the start of the task the first time it runs, and
+ *   below that, for a new task, the address of Task_Terminate() to destroy it if it returns.
+ *
+ * Addresses are 2 or 3 bytes, as wide as the MCU's PC.  The compiler says which registers and
+ * how wide a PC the target MCU has, so each one saves only what it needs:
+ *
+ *   MCU          PC  RAMPZ  EIND  frame  cycles per switch
+ *   ATmega328P    2    -     -     37 B     286
+ *   ATmega1284P   2    x     -     38 B     298
+ *   ATmega2560    3    x     x     41 B     314
+ *
+ * A switch is a task entering the kernel and the kernel leaving to a task: two calls, two
+ * saves, two restores and two returns (CTX_SWITCH_CYCLES), not counting moving SP.
+ */
+#if defined(__AVR_3_BYTE_PC__)
+    #define CTX_PC_BYTES        3
 #else
-    #define STACKCONTEXTSIZE (32 + 1 + 2 + 2)
-    #define KERNELARG_STACKOFFSET (32 + 1 + 1)
+    #define CTX_PC_BYTES        2
+#endif
+#if defined(__AVR_HAVE_RAMPZ__)
+    #define CTX_HAVE_RAMPZ      1
+#else
+    #define CTX_HAVE_RAMPZ      0
+#endif
+#if defined(__AVR_HAVE_EIJMP_EICALL__)
+    #define CTX_HAVE_EIND       1
+#else
+    #define CTX_HAVE_EIND       0
 #endif
 
-/* Needed for memset */
-/* #include <string.h> */
+/* Offsets into the frame from the stack pointer, which points at the byte above it. */
+#define CTX_R0              1
+#define CTX_SREG            32
+#define CTX_RAMPZ           (CTX_SREG + 1)
+#define CTX_EIND            (CTX_RAMPZ + CTX_HAVE_RAMPZ)
+#define CTX_R31             (CTX_EIND + CTX_HAVE_EIND)
+#define CTX_RETURN          (CTX_R31 + 1)
+#define STACKCONTEXTSIZE    (CTX_RETURN + 2 * CTX_PC_BYTES - 1)
+
+/* 2 cycles a push or pop, 1 an in, out or cli; call and ret take a cycle more with a 3 byte PC. */
+#define CTX_SAVE_CYCLES     (2 + 1 + 1 + 2 * 32 + 3 * (CTX_HAVE_RAMPZ + CTX_HAVE_EIND))
+#define CTX_RESTORE_CYCLES  (2 * 31 + 2 + 1 + 2 + 3 * (CTX_HAVE_RAMPZ + CTX_HAVE_EIND))
+#define CTX_SWITCH_CYCLES   (2 * (CTX_SAVE_CYCLES + CTX_RESTORE_CYCLES + 2 * (CTX_PC_BYTES + 2)))
 
 /** @brief main function provided by user application. The first task to run. */
 extern int r_main();
@@ -69,21 +105,56 @@ static volatile int kernel_request_retval;
 /** Pool of unallocated tasks to pull from. */
 static queue_t dead_pool_queue;
 
-/** The ready queue for RR tasks. Their scheduling is round-robin. */
-static queue_t rr_queue;
-
-/** The active queue for PERIODIC tasks. Their scheduling is based on dynamically set periods and delays. */
-static list_t periodic_list;
-
-/** The ready queue for SYSTEM tasks. Their scheduling is first come, first served. */
-static queue_t system_queue;
-
-/** Timing data */
-static volatile uint16_t previous_tick_time = 0;
-static volatile uint16_t current_tick_multiplied = 0;
+/** The ready queues of each partition.  Without windows everything is in partition 0. */
+static partition_t partitions[MAXPARTITIONS];
+
+/** The partition whose window it is. */
+static partition_t* cur_partition = partitions;
+
+/** The software timers made so far. */
+static soft_timer_t timers[MAXTIMERS];
+static uint8_t timer_count;
+/** The running timers, sorted by when they expire. */
+static soft_timer_t* timer_list;
+/** The expired timers waiting for the daemon, in the order they expired. */
+static soft_timer_t* timer_expired_head;
+static soft_timer_t* timer_expired_tail;
+/** The timer daemon, once it has started. */
+static task_descriptor_t* timer_daemon_task;
+static uint8_t timer_daemon_created;
+
+static group_t groups[MAXGROUPS];
+static uint8_t group_count;
+
+#if RR_STRIDE
+/** The stride of an RR task of weight 1. */
+#define STRIDE1 4096
+#endif
 
-/** time remaining in current slot */
-static volatile uint8_t ticks_remaining = 0;
+/** The reservation group of an RR task in one; groups are numbered from 1. */
+#define GROUP(task) (&groups[(task)->group - 1])
+
+/** The major frame: the windows, the current one and the TICKs left in it. */
+static window_t windows[MAXWINDOWS];
+static uint8_t window_count;
+static uint8_t cur_window = 0xFF;
+static uint16_t window_ticks = 1;
+
+/** The partition a task runs in. */
+#define PARTITION(task)     (&partitions[(task)->partition])
+
+/** Timing data, in Timer 1 counts: the time at the last entry to the kernel, and TCNT1 then. */
+static uint32_t kernel_time;
+static uint16_t kernel_time_tcnt;
+/** The length of a TICK, set by OS_Init(), and when the next one ends. */
+static uint16_t tick_us;
+static uint16_t tick_cycles;
+static uint32_t next_tick;
+/** The value OCR1A was last set to. */
+static volatile uint16_t timer_match;
+/** Milliseconds since OS_Init(), and TCNT1 when the last one began. */
+static volatile uint16_t now_ms;
+static volatile uint16_t now_ms_tcnt;
 
 /** Error message used in OS_Abort() */
 static uint8_t volatile error_msg = ERR_RUN_1_USER_CALLED_OS_ABORT;
@@ -91,6 +162,41 @@ static uint8_t volatile error_msg = ERR_RUN_1_USER_CALLED_OS_ABORT;
 static service_t services[MAXSERVICES];
 static uint8_t service_count;
 
+static channel_t channels[MAXCHANNELS];
+static uint8_t channel_count;
+
+/** Background jobs for the idle task, a ring buffer. */
+static idle_job_t idle_jobs[MAXIDLEJOBS];
+static volatile uint8_t idle_job_head;
+static volatile uint8_t idle_job_count;
+
+#if CRASH_SNAPSHOT
+/** Marks a valid snapshot in EEPROM. */
+#define CRASH_MAGIC         0xC5
+/** The snapshot sits at the end of EEPROM. */
+#define CRASH_EEPROM        ((crash_snapshot_t*)(E2END + 1 - sizeof(crash_snapshot_t)))
+
+/** The last kernel events, a ring buffer. */
+static crash_event_t trace[CRASH_TRACE_LENGTH];
+static uint8_t trace_head;
+#endif
+
+#if CRASH_SNAPSHOT || OS_STATS
+/** Fill for unused stack, to find each task's high-water mark. */
+#define STACK_PAINT         0xA5
+#endif
+
+#if OS_STATS
+/** Timer 1 when the kernel last charged the running task for its time. */
+static uint16_t accounted_time;
+
+/** See periodic_stats_t. */
+static uint32_t worst_response;
+static uint16_t overruns;
+static uint16_t mode_switches;
+static uint16_t shed;
+#endif
+
 
 /*
  * ================================================================================
@@ -106,6 +212,7 @@ static uint8_t service_count;
 /* kernel */
 static void kernel_main_loop(void);
 static void kernel_dispatch(void);
+static task_descriptor_t* kernel_select(void);
 static task_descriptor_t* kernel_find_periodic(void);
 static void kernel_handle_request(void);
 /* context switching */
@@ -116,6 +223,7 @@ extern /*"C"*/ void TIMER1_COMPA_vect(void) __attribute__ ((signal, naked));
 static int kernel_create_task();
 static void kernel_terminate_task(void);
 static void kernel_interrupt_task(void);
+static int8_t task_id(task_descriptor_t* p);
 
 /* lists */
 static void list_add(list_t* list_ptr, task_descriptor_t* task_to_add);
@@ -124,10 +232,33 @@ static void list_remove(list_t* list_ptr, task_descriptor_t* task_to_remove);
 /* queues */
 static void enqueue(queue_t* queue_ptr, task_descriptor_t* task_to_add);
 static void push_queue(queue_t* queue_ptr, task_descriptor_t* task_to_add);
+static void insert_after(queue_t* queue_ptr, task_descriptor_t* after, task_descriptor_t* task_to_add);
+static void wait_insert(queue_t* queue_ptr, task_descriptor_t* task_to_add);
+static void ready_insert(queue_t* queue_ptr, task_descriptor_t** last, task_descriptor_t* task_to_add);
 static task_descriptor_t* dequeue(queue_t* queue_ptr);
+static void queue_remove(queue_t* queue_ptr, task_descriptor_t* task_to_remove);
+static task_descriptor_t* dequeue_eligible(queue_t* queue_ptr);
 
+static void kernel_update_clock(void);
 static void kernel_update_ticker(void);
+static void kernel_update_periodic(void);
+static void kernel_set_timer(void);
+static void kernel_update_window(void);
+static void kernel_update_groups(void);
+static void kernel_update_timers(void);
+
+/* timers */
+static void timer_insert(soft_timer_t* timer);
 static void idle (void);
+
+#if CRASH_SNAPSHOT
+static void kernel_trace(uint8_t event, task_descriptor_t* task);
+static void kernel_save_crash(void);
+#endif
+#if OS_STATS
+static void kernel_account(void);
+static void kernel_periodic_done(void);
+#endif
 static void _delay_25ms(void);
 
 /*
@@ -141,12 +272,29 @@ static void _delay_25ms(void);
  */
 
 /**
- *  @brief The idle task does nothing but busy loop.
+ *  @brief The idle task runs the background jobs, and busy loops when there are none.
  */
 static void idle (void)
 {
+    idle_job_t job;
+
     for(;;)
-    {};
+    {
+        if(idle_job_count == 0)
+        {
+            continue;
+        }
+
+        Disable_Interrupt();
+        IRQ_PROFILE_DISABLE();
+        job = idle_jobs[idle_job_head];
+        idle_job_head = (idle_job_head + 1) % MAXIDLEJOBS;
+        --idle_job_count;
+        IRQ_PROFILE_ENABLE();
+        Enable_Interrupt();
+
+        job.f(job.arg);
+    }
 }
 
 
@@ -180,7 +328,11 @@ static void kernel_main_loop(void)
     for(;;)
     {
         kernel_dispatch();
+        kernel_set_timer();
 
+        /* The kernel runs with interrupts disabled; the window ends as the next task is
+         * restored, not counting the fixed cost of restoring its registers. */
+        IRQ_PROFILE_ENABLE();
         exit_kernel();
 
         /* if this task makes a system call, or is interrupted,
@@ -201,40 +353,108 @@ static void kernel_main_loop(void)
  */
 static void kernel_dispatch(void)
 {
+    task_descriptor_t* previous_task = cur_task;
+
     /* If the current state is RUNNING, then select it to run again.
      * kernel_handle_request() has already determined it should be selected.
      */
 
     if(cur_task->state != RUNNING || cur_task == idle_task)
     {
-		if(system_queue.head != NULL)
+        cur_task = kernel_select();
+        if(cur_task == NULL && cur_partition->criticality == CRIT_HI)
+        {
+            /* No HI task is ready, so the LO tasks may run again. */
+            cur_partition->criticality = CRIT_LO;
+            cur_task = kernel_select();
+        }
+        if(cur_task == NULL)
+        {
+            /* No task available, so idle. */
+            cur_task = idle_task;
+        }
+
+        cur_task->state = RUNNING;
+    }
+
+#if OS_STATS
+    /* The first dispatch since a publish woke the task. */
+    if(cur_task->woken_by != NULL)
+    {
+        uint16_t latency = TCNT1 - cur_task->woken_at;
+        if(latency > cur_task->woken_by->worst_latency)
+        {
+            cur_task->woken_by->worst_latency = latency;
+        }
+        cur_task->woken_by = NULL;
+    }
+#endif
+
+    if(cur_task != previous_task)
+    {
+#if CRASH_SNAPSHOT
+        kernel_trace(CRASH_EVENT_DISPATCH, cur_task);
+#endif
+        Store_Add(STORE_KEY_DISPATCHES, 1);
+    }
+}
+
+/**
+ * @fn kernel_select
+ *
+ *@brief Takes the next task of the current partition to run: SYSTEM, then PERIODIC, then RR.
+ *
+ * In HI mode the LO tasks are passed over, and the activation of a LO PERIODIC task is
+ * skipped.  RR tasks are passed over while their group has no budget.  Returns null if no
+ * task is available.
+ */
+static task_descriptor_t* kernel_select(void)
+{
+    task_descriptor_t* task;
+
+    task = dequeue_eligible(&cur_partition->system_queue);
+    if(task != NULL)
+    {
+        return task;
+    }
+
+    task = kernel_find_periodic();
+    if(task != NULL)
+    {
+        if(cur_partition->criticality == CRIT_HI && task->criticality == CRIT_LO)
         {
-            cur_task = dequeue(&system_queue);
+            task->next_release += task->period;
+#if OS_STATS
+            ++shed;
+#endif
         }
         else
         {
-            task_descriptor_t* periodic_task = kernel_find_periodic();
-            if(periodic_task != NULL)
-            {
-                cur_task = periodic_task;
-                cur_task->countdown += cur_task->period;
-                if(ticks_remaining == 0) {
-                    ticks_remaining = cur_task->wcet;
-                }
-            }
-            else if(rr_queue.head != NULL)
-            {
-                cur_task = dequeue(&rr_queue);
-            }
-            else
-            {
-                /* No task available, so idle. */
-                cur_task = idle_task;
+#if OS_STATS
+            task->release = task->next_release;
+#endif
+            task->next_release += task->period;
+            if(cur_partition->slot_remaining == 0) {
+                cur_partition->slot_remaining = task->wcet;
+                cur_partition->extended = 0;
             }
+            return task;
         }
+    }
 
-        cur_task->state = RUNNING;
+    task = dequeue_eligible(&cur_partition->rr_queue);
+#if RR_STRIDE
+    if(task != NULL)
+    {
+        /* A task that was waiting or held back starts level with the last one. */
+        if((int32_t)(task->pass - cur_partition->rr_pass) < 0)
+        {
+            task->pass = cur_partition->rr_pass;
+        }
+        cur_partition->rr_pass = task->pass;
     }
+#endif
+    return task;
 }
 
 /**
@@ -247,10 +467,10 @@ static void kernel_dispatch(void)
 static task_descriptor_t* kernel_find_periodic(void)
 {
     task_descriptor_t* ret_val = NULL;
-    task_descriptor_t* periodic_task = periodic_list.head;
+    task_descriptor_t* periodic_task = cur_partition->periodic_list.head;
     while(periodic_task != NULL)
     {
-        if(periodic_task->countdown <= 0) {
+        if((int32_t)(kernel_time - periodic_task->next_release) >= 0) {
             if(ret_val != NULL) {
                 error_msg = ERR_RUN_6_PERIODIC_TASK_COLLISION;
                 OS_Abort();
@@ -274,6 +494,23 @@ static task_descriptor_t* kernel_find_periodic(void)
  */
 static void kernel_handle_request(void)
 {
+    kernel_update_clock();
+
+#if OS_STATS
+    kernel_account();
+#endif
+
+#if CRASH_SNAPSHOT
+    switch(kernel_request)
+    {
+    case TASK_CREATE:       kernel_trace(CRASH_EVENT_CREATE, cur_task); break;
+    case TASK_TERMINATE:    kernel_trace(CRASH_EVENT_TERMINATE, cur_task); break;
+    case TASK_NEXT:         kernel_trace(CRASH_EVENT_NEXT, cur_task); break;
+    case TASK_INTERRUPT:    kernel_trace(CRASH_EVENT_INTERRUPT, cur_task); break;
+    default:                break;
+    }
+#endif
+
    switch(kernel_request)
     {
     case NONE:
@@ -281,17 +518,44 @@ static void kernel_handle_request(void)
         break;
 
     case TIMER_EXPIRED:
+        /* Interrupts have been disabled since the compare match. */
+        IRQ_PROFILE_SINCE(timer_match);
+        kernel_update_periodic();
+
+        if((int32_t)(kernel_time - next_tick) < 0)
+        {
+            /* A PERIODIC task's release or the end of its slot, between TICKs: a running
+             * RR task keeps the rest of its quantum. */
+            if(cur_task->level == RR && cur_task->state == RUNNING)
+            {
+                cur_task->state = READY;
+                push_queue(&PARTITION(cur_task)->rr_queue, cur_task);
+            }
+            break;
+        }
+
+        next_tick += tick_cycles;
         kernel_update_ticker();
+        kernel_update_groups();
+        kernel_update_timers();
 
         /* Round robin tasks get pre-empted on every tick. */
         if(cur_task->level == RR && cur_task->state == RUNNING)
         {
             cur_task->state = READY;
-            enqueue(&rr_queue, cur_task);
+#if RR_STRIDE
+            cur_task->pass += cur_task->stride;
+#endif
+            enqueue(&PARTITION(cur_task)->rr_queue, cur_task);
         }
+
+        kernel_update_window();
         break;
 
     case TASK_CREATE:
+        kernel_request_create_args.partition = cur_task->child_partition;
+        kernel_request_create_args.criticality = cur_task->child_criticality;
+        kernel_request_create_args.group = cur_task->child_group;
         kernel_request_retval = kernel_create_task();
 
         /* Check if new task has higer priority, and that it wasn't an ISR
@@ -300,19 +564,20 @@ static void kernel_handle_request(void)
         if(kernel_request_retval != (int)NULL)
         {
             /* If new task is SYSTEM and cur is not, then don't run old one */
-            if(kernel_request_create_args.level == SYSTEM && cur_task->level != SYSTEM)
+            if(kernel_request_create_args.level == SYSTEM && cur_task->level != SYSTEM &&
+               kernel_request_create_args.partition == cur_task->partition)
             {
                 cur_task->state = READY;
                 if(cur_task->level == PERIODIC) {
-                    cur_task->countdown -= cur_task->period;
-                    ticks_remaining++; // TODO: This should be smarter.
+                    cur_task->next_release -= cur_task->period;
                 }
             }
 
             /* If cur is RR, it might be pre-empted by a new PERIODIC. */
             if(cur_task->level == RR &&
                kernel_request_create_args.level == PERIODIC &&
-               kernel_request_create_args.start == 0)
+               kernel_request_create_args.start == 0 &&
+               kernel_request_create_args.partition == cur_task->partition)
             {
                 cur_task->state = READY;
             }
@@ -320,7 +585,7 @@ static void kernel_handle_request(void)
             /* enqueue READY RR tasks. */
             if(cur_task->level == RR && cur_task->state == READY)
             {
-                enqueue(&rr_queue, cur_task);
+                enqueue(&PARTITION(cur_task)->rr_queue, cur_task);
             }
         } else {
             error_msg = ERR_RUN_2_TOO_MANY_TASKS;
@@ -342,31 +607,41 @@ static void kernel_handle_request(void)
             {
                 cur_task->state = READY;
                 if(cur_task->level == PERIODIC) {
-                    cur_task->countdown -= cur_task->period;
-                    ticks_remaining++; // TODO: This should be smarter.
+                    cur_task->next_release -= cur_task->period;
                 }
-                else {
-                    push_queue(&rr_queue, cur_task);
+                else if(cur_task != idle_task) {
+                    push_queue(&PARTITION(cur_task)->rr_queue, cur_task);
                 }
             }
         }
         break;
 
     case TASK_NEXT:
-        if(cur_task->state == RUNNING)
+        /* A task suspending itself stays out of the ready queues until Task_Resume(). */
+        if(cur_task->state == RUNNING && cur_task->suspended)
+        {
+            cur_task->state = READY;
+        }
+        else if(cur_task->state == RUNNING)
         {
     		switch(cur_task->level)
     		{
     	    case SYSTEM:
-    	        enqueue(&system_queue, cur_task); // Do not enqueue when subscribed.
+    	        enqueue(&PARTITION(cur_task)->system_queue, cur_task); // Do not enqueue when subscribed.
     			break;
 
             case PERIODIC:
-                ticks_remaining = 0;
+                PARTITION(cur_task)->slot_remaining = 0;
+#if OS_STATS
+                kernel_periodic_done();
+#endif
                 break;
 
     	    case RR:
-    	        enqueue(&rr_queue, cur_task); // Do not enqueue when subscribed.
+#if RR_STRIDE
+    	        cur_task->pass += cur_task->stride;
+#endif
+    	        enqueue(&PARTITION(cur_task)->rr_queue, cur_task); // Do not enqueue when subscribed.
     	        break;
 
     	    default: /* idle or periodic task */
@@ -408,23 +683,33 @@ static void kernel_handle_request(void)
  * in reverse. Also, when a new task is created, it is important to
  * initialize its "initial" context in the same order as a saved context.
  *
- * Save r31 and SREG on stack, disable interrupts, then save
- * the rest of the registers on the stack. In the locations this macro
+ * Save r31, EIND and RAMPZ (if the MCU has them) and SREG on stack, disable
+ * interrupts, then save the rest of the registers on the stack. In the locations this macro
  * is used, the interrupts need to be disabled, or they already are disabled.
  */
-#if USE_AVR2560_GREATER
-#define    SAVE_CTX_TOP()       asm volatile (\
-    "push   r31             \n\t"\
-    "in     r31,0X3C        \n\t"\
-    "push   r31             \n\t"\
-    "in     r31,__SREG__    \n\t"\
-    "cli                    \n\t"::); /* Disable interrupt */
+/* RAMPZ and EIND are at I/O addresses 0x3B and 0x3C on every part that has them. */
+#if CTX_HAVE_RAMPZ
+#define    SAVE_RAMPZ           "in     r31,0X3B        \n\t" "push   r31             \n\t"
+#define    RESTORE_RAMPZ        "pop    r31             \n\t" "out    0X3B, r31       \n\t"
+#else
+#define    SAVE_RAMPZ
+#define    RESTORE_RAMPZ
+#endif
+
+#if CTX_HAVE_EIND
+#define    SAVE_EIND            "in     r31,0X3C        \n\t" "push   r31             \n\t"
+#define    RESTORE_EIND         "pop    r31             \n\t" "out    0X3C, r31       \n\t"
 #else
+#define    SAVE_EIND
+#define    RESTORE_EIND
+#endif
+
 #define    SAVE_CTX_TOP()       asm volatile (\
     "push   r31             \n\t"\
+    SAVE_EIND\
+    SAVE_RAMPZ\
     "in     r31,__SREG__    \n\t"\
     "cli                    \n\t"::); /* Disable interrupt */
-#endif
 
 #define STACK_SREG_SET_I_BIT()    asm volatile (\
     "ori    r31, 0x80        \n\t"::);
@@ -501,19 +786,12 @@ static void kernel_handle_request(void)
     "pop    r29             \n\t"\
     "pop    r30             \n\t"::);
 
-#if USE_AVR2560_GREATER
 #define    RESTORE_CTX_TOP()    asm volatile (\
     "pop    r31             \n\t"\
     "out    __SREG__, r31   \n\t"\
-    "pop    r31             \n\t"\
-    "out    0X3C, r31       \n\t"\
-    "pop    r31             \n\t"::);
-#else
-#define    RESTORE_CTX_TOP()    asm volatile (\
-    "pop    r31             \n\t"\
-    "out    __SREG__, r31    \n\t"\
+    RESTORE_RAMPZ\
+    RESTORE_EIND\
     "pop    r31             \n\t"::);
-#endif
 
 /**
  * @brief Pop all registers and the status register.
@@ -661,13 +939,6 @@ void TIMER1_COMPA_vect(void)
      */
     kernel_request = TIMER_EXPIRED;
 
-    /*
-     * Prepare for next tick interrupt.
-     */
-    OCR1A += TICK_CYCLES;
-    previous_tick_time += TICK_CYCLES;
-    current_tick_multiplied += 5;
-
     /*
      * Restore the kernel context. (The stack pointer is restored again.)
      */
@@ -700,6 +971,18 @@ void TIMER1_COMPA_vect(void)
  */
 
 
+/**
+ * Write a code address the way call pushes it, for ret to pop it.
+ */
+static void kernel_put_address(uint8_t* frame, voidfuncvoid_ptr f)
+{
+#if CTX_PC_BYTES == 3
+    *frame++ = 0;
+#endif
+    frame[0] = (uint8_t)((uint16_t)f >> 8);
+    frame[1] = (uint8_t)(uint16_t)f;
+}
+
 /**
  *  @brief Kernel function to create a new task.
  *
@@ -721,8 +1004,13 @@ static int kernel_create_task()
         return 0;
     }
 
+    if(kernel_request_create_args.wcet_hi < kernel_request_create_args.wcet)
+    {
+        kernel_request_create_args.wcet_hi = kernel_request_create_args.wcet;
+    }
+
     if(kernel_request_create_args.level == PERIODIC &&
-       kernel_request_create_args.period < kernel_request_create_args.wcet)
+       kernel_request_create_args.period < kernel_request_create_args.wcet_hi)
     {
         error_msg = ERR_1_WORST_CASE_GT_PERIOD;
         OS_Abort();
@@ -742,58 +1030,53 @@ static int kernel_create_task()
     stack_bottom = &(p->stack[MAXSTACK-1]);
 
     /* The stack grows down in memory, so the stack pointer is going to end up
-     * pointing to the location 32 + 1 + 2 + 2 = 37 bytes above the bottom, to make
-     * room for (from bottom to top):
-     *   the address of Task_Terminate() to destroy the task if it ever returns,
-     *   the address of the start of the task to "return" to the first time it runs,
-     *   register 31,
-     *   the stored SREG, and
-     *   registers 30 to 0.
+     * pointing to the location STACKCONTEXTSIZE bytes above the bottom, to make
+     * room for a context frame as described at the top of this file.
      */
     uint8_t* stack_top = stack_bottom - STACKCONTEXTSIZE;
 
+#if CRASH_SNAPSHOT || OS_STATS
+    memset(p->stack, STACK_PAINT, stack_top - p->stack);
+#endif
+#if OS_STATS
+    p->run_time = 0;
+    p->stack_free = stack_top - p->stack;
+    p->woken_by = NULL;
+#endif
+
+    /* Each register starts with its own number, to tell them apart when debugging. */
     int i = 0;
     for( i=0; i < 31; i++ )
     {
-        stack_top[i] = i;
+        stack_top[CTX_R0 + i] = i;
     }
-    stack_top[31] = 0x55;
-    stack_top[32] = 0xEE;
-    stack_top[33] = 31;
+    stack_top[CTX_R31] = 31;
 
     /* Not necessary to clear the task descriptor. */
     /* memset(p,0,sizeof(task_descriptor_t)); */
 
-    /* stack_top[0] is the byte above the stack.
-     * stack_top[1] is r0. */
-    stack_top[2] = (uint8_t) 0; /* r1 is the "zero" register. */
-    /* stack_top[31] is r30. */
-    stack_top[33] = (uint8_t) _BV(SREG_I); /* set SREG_I bit in stored SREG. */
-    /* stack_top[33] is r31. */
+    stack_top[CTX_R0 + 1] = (uint8_t) 0; /* r1 is the "zero" register. */
+    stack_top[CTX_SREG] = (uint8_t) _BV(SREG_I); /* set SREG_I bit in stored SREG. */
+#if CTX_HAVE_RAMPZ
+    stack_top[CTX_RAMPZ] = 0;
+#endif
+#if CTX_HAVE_EIND
+    stack_top[CTX_EIND] = 0; /* The compiler expects EIND to stay 0. */
+#endif
 
     /* We are placing the address (16-bit) of the functions
      * onto the stack in reverse byte order (least significant first, followed
      * by most significant).  This is because the "return" assembly instructions
      * (ret and reti) pop addresses off in BIG ENDIAN (most sig. first, least sig.
-     * second), even though the AT90 is LITTLE ENDIAN machine.
+     * second), even though the AT90 is LITTLE ENDIAN machine.  A 3 byte PC has
+     * a 0 on top, as word addresses of code fit in 16 bits.
      */
-#if USE_AVR2560_GREATER
-    stack_top[KERNELARG_STACKOFFSET+0] = (uint8_t)(0);
-    stack_top[KERNELARG_STACKOFFSET+1] = (uint8_t)((uint16_t)(kernel_request_create_args.f) >> 8);
-    stack_top[KERNELARG_STACKOFFSET+2] = (uint8_t)(uint16_t)(kernel_request_create_args.f);
-    stack_top[KERNELARG_STACKOFFSET+3] = (uint8_t)(0);
-    stack_top[KERNELARG_STACKOFFSET+4] = (uint8_t)((uint16_t)Task_Terminate >> 8);
-    stack_top[KERNELARG_STACKOFFSET+5] = (uint8_t)(uint16_t)Task_Terminate;
-#else
-    stack_top[KERNELARG_STACKOFFSET+0] = (uint8_t)((uint16_t)(kernel_request_create_args.f) >> 8);
-    stack_top[KERNELARG_STACKOFFSET+1] = (uint8_t)(uint16_t)(kernel_request_create_args.f);
-    stack_top[KERNELARG_STACKOFFSET+2] = (uint8_t)((uint16_t)Task_Terminate >> 8);
-    stack_top[KERNELARG_STACKOFFSET+3] = (uint8_t)(uint16_t)Task_Terminate;
-#endif
+    kernel_put_address(&stack_top[CTX_RETURN], (voidfuncvoid_ptr)kernel_request_create_args.f);
+    kernel_put_address(&stack_top[CTX_RETURN + CTX_PC_BYTES], (voidfuncvoid_ptr)Task_Terminate);
 
     /*
      * Make stack pointer point to cell above stack (the top).
-     * Make room for 32 registers, SREG and two return addresses.
+     * Make room for the registers and two return addresses.
      */
     p->sp = stack_top;
 
@@ -802,23 +1085,46 @@ static int kernel_create_task()
     p->level = kernel_request_create_args.level;
     p->period = kernel_request_create_args.period;
     p->wcet = kernel_request_create_args.wcet;
-    p->countdown = kernel_request_create_args.start;
+    p->wcet_hi = kernel_request_create_args.wcet_hi;
+    if(kernel_request_create_args.from_tick)
+    {
+        /* TICKs from the one that began last, as if counted down at each TICK. */
+        p->next_release = next_tick - tick_cycles + kernel_request_create_args.start;
+    }
+    else
+    {
+        p->next_release = kernel_time + kernel_request_create_args.start;
+    }
+    p->partition = kernel_request_create_args.partition;
+    p->child_partition = p->partition;
+    p->criticality = kernel_request_create_args.criticality;
+    p->child_criticality = p->criticality;
+    p->group = p->level == RR ? kernel_request_create_args.group : 0;
+    p->child_group = kernel_request_create_args.group;
+    p->suspended = 0;
+    p->joining = NULL;
+    p->priority = 0;
+    p->stamped = 0;
+#if RR_STRIDE
+    p->stride = STRIDE1;
+    p->pass = 0;
+#endif
 
 	switch(kernel_request_create_args.level)
 	{
     case SYSTEM:
     	/* Put SYSTEM and Round Robin tasks on a queue. */
-        enqueue(&system_queue, p);
+        enqueue(&PARTITION(p)->system_queue, p);
 		break;
 
     case PERIODIC:
         /* Put this newly created Periodic task into the periodic task list. */
-        list_add(&periodic_list, p);
+        list_add(&PARTITION(p)->periodic_list, p);
         break;
 
     case RR:
 		/* Put SYSTEM and Round Robin tasks on a queue. */
-        enqueue(&rr_queue, p);
+        enqueue(&PARTITION(p)->rr_queue, p);
 		break;
 
 	default:
@@ -826,7 +1132,7 @@ static int kernel_create_task()
 		break;
 	}
 
-    return 1;
+    return task_id(p);
 }
 
 
@@ -835,13 +1141,42 @@ static int kernel_create_task()
  */
 static void kernel_terminate_task(void)
 {
+    task_descriptor_t* task;
+    task_descriptor_t* last;
+
     /* deallocate all resources used by this task */
     cur_task->state = DEAD;
+    cur_task->generation = (cur_task->generation + 1) % ID_GENERATIONS;
     if(cur_task->level == PERIODIC)
     {
-        list_remove(&periodic_list, cur_task);
+        list_remove(&PARTITION(cur_task)->periodic_list, cur_task);
+        PARTITION(cur_task)->slot_remaining = 0;
     }
     enqueue(&dead_pool_queue, cur_task);
+
+    /* Wake the tasks joining it.  They are found in descriptor order, not priority order,
+     * so each goes ahead of the ready tasks of its priority on its own. */
+    for(task = task_desc; task < &task_desc[MAXPROCESS]; ++task)
+    {
+        if(task->state == WAITING && task->joining == cur_task)
+        {
+            task->joining = NULL;
+            task->state = READY;
+            if(task->suspended)
+            {
+                continue;
+            }
+            last = NULL;
+            if(task->level == SYSTEM)
+            {
+                ready_insert(&PARTITION(task)->system_queue, &last, task);
+            }
+            else
+            {
+                ready_insert(&PARTITION(task)->rr_queue, &last, task);
+            }
+        }
+    }
 }
 
 static void kernel_interrupt_task(void)
@@ -850,10 +1185,12 @@ static void kernel_interrupt_task(void)
 
     sreg = SREG;
     Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
 
     kernel_request = TASK_INTERRUPT;
     enter_kernel();
 
+    IRQ_PROFILE_RESTORE(sreg);
     SREG = sreg;
 }
 
@@ -951,6 +1288,7 @@ static void enqueue(queue_t* queue_ptr, task_descriptor_t* task_to_add)
     {
         /* put task at the back of the queue */
         queue_ptr->tail->next = task_to_add;
+        task_to_add->prev = queue_ptr->tail;
         queue_ptr->tail = task_to_add;
     }
 }
@@ -978,6 +1316,77 @@ static void push_queue(queue_t* queue_ptr, task_descriptor_t* task_to_add)
     }
 }
 
+/**
+ * @brief Add a task to the queue behind another
+ *
+ * @param queue_ptr the queue to insert in
+ * @param after the task to insert behind, or NULL for the head of the queue
+ * @param task_to_add the task descriptor to add
+ */
+static void insert_after(queue_t* queue_ptr, task_descriptor_t* after, task_descriptor_t* task_to_add)
+{
+    if(after == NULL)
+    {
+        push_queue(queue_ptr, task_to_add);
+        return;
+    }
+
+    task_to_add->next = after->next;
+    task_to_add->prev = after;
+    if(after->next != NULL)
+    {
+        after->next->prev = task_to_add;
+    }
+    else
+    {
+        queue_ptr->tail = task_to_add;
+    }
+    after->next = task_to_add;
+}
+
+/**
+ * @brief Add a task to a queue of waiting tasks, behind the tasks of its priority and above.
+ *
+ * @param queue_ptr the queue to insert in
+ * @param task_to_add the task descriptor to add
+ */
+static void wait_insert(queue_t* queue_ptr, task_descriptor_t* task_to_add)
+{
+    task_descriptor_t* after = NULL;
+    task_descriptor_t* task_ptr;
+
+    for(task_ptr = queue_ptr->head; task_ptr != NULL && task_ptr->priority >= task_to_add->priority;
+        task_ptr = task_ptr->next)
+    {
+        after = task_ptr;
+    }
+    insert_after(queue_ptr, after, task_to_add);
+}
+
+/**
+ * @brief Add a task that was just woken to a ready queue.
+ *
+ * It goes ahead of the ready tasks of its priority and below, but behind the tasks woken
+ * before it by the same call, which are taken from the waiting queue in priority order.
+ *
+ * @param queue_ptr the queue to insert in
+ * @param last the task the same call last added to this queue, or NULL; set to task_to_add
+ * @param task_to_add the task descriptor to add
+ */
+static void ready_insert(queue_t* queue_ptr, task_descriptor_t** last, task_descriptor_t* task_to_add)
+{
+    task_descriptor_t* after = *last;
+    task_descriptor_t* task_ptr = after == NULL ? queue_ptr->head : after->next;
+
+    while(task_ptr != NULL && task_ptr->priority > task_to_add->priority)
+    {
+        after = task_ptr;
+        task_ptr = task_ptr->next;
+    }
+    insert_after(queue_ptr, after, task_to_add);
+    *last = task_to_add;
+}
+
 /**
  * @brief Pops head of queue and returns it.
  *
@@ -991,96 +1400,350 @@ static task_descriptor_t* dequeue(queue_t* queue_ptr)
     if(queue_ptr->head != NULL)
     {
         queue_ptr->head = queue_ptr->head->next;
+        if(queue_ptr->head != NULL)
+        {
+            queue_ptr->head->prev = NULL;
+        }
         task_ptr->next = NULL;
     }
 
     return task_ptr;
 }
 
-
-/*
- * ================================================================================
- * ================================================================================
- * ====================                                        ====================
- * ====================             Periodic Tasks             ====================
- * ====================                                        ====================
- * ================================================================================
- * ================================================================================
+/**
+ * @brief Takes a task out of a queue, wherever it is.
+ *
+ * @param queue_ptr the queue the task is in
+ * @param task_to_remove the task descriptor to remove
  */
-
+static void queue_remove(queue_t* queue_ptr, task_descriptor_t* task_to_remove)
+{
+    list_remove(queue_ptr, task_to_remove);
+    task_to_remove->next = NULL;
+    task_to_remove->prev = NULL;
+}
 
 /**
- * @brief Update the current time.
+ * @brief Takes the first task that may run now out of the queue and returns it.
  *
- * Perhaps start a periodic task?
+ * In HI mode only CRIT_HI tasks may run, and a task in a reservation group only while the
+ * group has budget.  With RR_STRIDE, of the RR tasks that may run it takes the first
+ * with the smallest pass.
+ *
+ * @param queue_ptr the queue to search
+ * @return the task descriptor, or null if no task in the queue may run
  */
-static void kernel_update_ticker(void)
+static task_descriptor_t* dequeue_eligible(queue_t* queue_ptr)
 {
-    /* PORTD ^= LED_D5_RED; */
+    task_descriptor_t* task_ptr = NULL;
+    task_descriptor_t* candidate;
 
-    if(periodic_list.head != NULL)
+    for(candidate = queue_ptr->head; candidate != NULL; candidate = candidate->next)
     {
-        if(cur_task->level != SYSTEM)
-        {
-            --ticks_remaining; // TODO: This is kind of odd... Might want to make smarter.
-        }
-
-        if(ticks_remaining == 0)
+        if((cur_partition->criticality == CRIT_LO || candidate->criticality == CRIT_HI) &&
+           (candidate->group == 0 || GROUP(candidate)->remaining > 0))
         {
-            /* If Periodic task still running then error */
-            if(cur_task->level == PERIODIC)
+#if RR_STRIDE
+            if(candidate->level == RR)
             {
-                /* error handling */
-                error_msg = ERR_RUN_3_PERIODIC_TOOK_TOO_LONG;
-                OS_Abort();
-            }
-        }
-
-        task_descriptor_t* periodic_task = periodic_list.head;
-        while(periodic_task != NULL)
-        {
-            periodic_task->countdown--;
-            if(periodic_task->countdown == 0 && cur_task->level == PERIODIC && cur_task != periodic_task) {
-                error_msg = ERR_RUN_6_PERIODIC_TASK_COLLISION;
-                OS_Abort();
+                if(task_ptr == NULL || (int32_t)(candidate->pass - task_ptr->pass) < 0)
+                {
+                    task_ptr = candidate;
+                }
+                continue;
             }
-            periodic_task = periodic_task->next;
+#endif
+            task_ptr = candidate;
+            break;
         }
     }
-}
 
-#undef SLOW_CLOCK
+    if(task_ptr != NULL)
+    {
+        queue_remove(queue_ptr, task_ptr);
+    }
 
-#ifdef SLOW_CLOCK
-/**
- * @brief For DEBUGGING to make the clock run slower
- *
- * Divide CLKI/O by 64 on timer 1 to run at 125 kHz  CS3[210] = 011
- * 1 MHz CS3[210] = 010
- */
-static void kernel_slow_clock(void)
-{
-    TCCR1B &= ~(_BV(CS12) | _BV(CS10));
-    TCCR1B |= (_BV(CS11));
+    return task_ptr;
 }
-#endif
 
 
 /*
  * ================================================================================
  * ================================================================================
  * ====================                                        ====================
- * ====================                Services                ====================
+ * ====================             Periodic Tasks             ====================
  * ====================                                        ====================
  * ================================================================================
  * ================================================================================
  */
 
 
-//TODO: WHY AM I USING DYNAMIC MEMORY?! I THINK THIS WILL BREAK THINGS!
+/**
+ * @brief Advance the kernel's time to now, and charge the time since the kernel last ran
+ * to the slot of the PERIODIC task that was running.
+ *
+ * The kernel runs at least every TICK, well within one turn of Timer 1.
+ */
+static void kernel_update_clock(void)
+{
+    uint16_t now = TCNT1;
+    uint16_t elapsed = now - kernel_time_tcnt;
 
+    kernel_time += elapsed;
+    kernel_time_tcnt = now;
 
-service_t *Service_Init()
+    while((uint16_t)(now - now_ms_tcnt) >= MS_CYCLES)
+    {
+        now_ms_tcnt += MS_CYCLES;
+        ++now_ms;
+    }
+
+    if(cur_task->level == PERIODIC && cur_task->state == RUNNING)
+    {
+        partition_t* partition = PARTITION(cur_task);
+        partition->slot_remaining = partition->slot_remaining > elapsed ? partition->slot_remaining - elapsed : 0;
+    }
+}
+
+/**
+ * @brief At the end of a TICK.
+ */
+static void kernel_update_ticker(void)
+{
+    /* PORTD ^= LED_D5_RED; */
+
+    Store_Tick();
+}
+
+/**
+ * @brief Check the running PERIODIC task against its slot and the releases of the others.
+ */
+static void kernel_update_periodic(void)
+{
+    partition_t* partition;
+    task_descriptor_t* periodic_task;
+
+    if(cur_task->level != PERIODIC || cur_task->state != RUNNING)
+    {
+        return;
+    }
+    partition = PARTITION(cur_task);
+
+    if(partition->slot_remaining == 0)
+    {
+        /* A HI task past its wcet switches to HI mode, once per activation. */
+        if(cur_task->criticality == CRIT_HI && cur_task->wcet_hi > cur_task->wcet &&
+           !partition->extended)
+        {
+            partition->criticality = CRIT_HI;
+            partition->slot_remaining = cur_task->wcet_hi - cur_task->wcet;
+            partition->extended = 1;
+#if OS_STATS
+            ++mode_switches;
+#endif
+        }
+        else
+        {
+            /* error handling */
+            error_msg = ERR_RUN_3_PERIODIC_TOOK_TOO_LONG;
+            OS_Abort();
+        }
+    }
+
+    /* In HI mode a LO activation is skipped rather than colliding. */
+    for(periodic_task = partition->periodic_list.head; periodic_task != NULL; periodic_task = periodic_task->next)
+    {
+        if(periodic_task != cur_task && (int32_t)(kernel_time - periodic_task->next_release) >= 0 &&
+           (partition->criticality == CRIT_LO || periodic_task->criticality == CRIT_HI)) {
+            error_msg = ERR_RUN_6_PERIODIC_TASK_COLLISION;
+            OS_Abort();
+        }
+    }
+}
+
+/**
+ * @brief Set Timer 1 to enter the kernel at the end of the TICK, or before it at the next
+ * release of a PERIODIC task of the current partition or the end of the running one's slot.
+ */
+static void kernel_set_timer(void)
+{
+    uint32_t next = next_tick;
+    task_descriptor_t* periodic_task;
+    uint16_t now;
+
+    for(periodic_task = cur_partition->periodic_list.head; periodic_task != NULL; periodic_task = periodic_task->next)
+    {
+        if((int32_t)(periodic_task->next_release - kernel_time) > 0 &&
+           (int32_t)(periodic_task->next_release - next) < 0)
+        {
+            next = periodic_task->next_release;
+        }
+    }
+    if(cur_task->level == PERIODIC && (int32_t)(kernel_time + cur_partition->slot_remaining - next) < 0)
+    {
+        next = kernel_time + cur_partition->slot_remaining;
+    }
+
+    /* A time that has come, or comes before OCR1A is set, would wait a whole turn. */
+    timer_match = (uint16_t)(next - kernel_time) + kernel_time_tcnt;
+    now = TCNT1;
+    if((int16_t)(timer_match - now) <= TIMER_MARGIN)
+    {
+        timer_match = now + TIMER_MARGIN;
+    }
+    OCR1A = timer_match;
+    /* A match while the kernel ran was for a time dealt with already. */
+    TIFR1 = _BV(OCF1A);
+}
+
+/**
+ * @brief At the end of a window, preempt the running task and switch to the next partition.
+ *
+ * The major frame starts at the first tick after Partition_Add_Window() is first called.
+ */
+static void kernel_update_window(void)
+{
+    if(window_count == 0 || --window_ticks > 0)
+    {
+        return;
+    }
+
+    /* The running task resumes first when its partition's next window begins. */
+    if(cur_task->state == RUNNING && cur_task != idle_task)
+    {
+        cur_task->state = READY;
+        if(cur_task->level == SYSTEM) {
+            push_queue(&PARTITION(cur_task)->system_queue, cur_task);
+        }
+        else if(cur_task->level == PERIODIC) {
+            cur_task->next_release -= cur_task->period;
+        }
+    }
+
+    if(++cur_window >= window_count)
+    {
+        cur_window = 0;
+    }
+    window_ticks = windows[cur_window].ticks;
+    cur_partition = &partitions[windows[cur_window].partition];
+}
+
+/**
+ * @brief Charge the TICK to the running RR task's group, and start new periods.
+ */
+static void kernel_update_groups(void)
+{
+    group_t* group;
+
+    if(cur_task->level == RR && cur_task->group != 0)
+    {
+        group = GROUP(cur_task);
+        ++group->used;
+        if(group->remaining > 0 && --group->remaining == 0)
+        {
+            ++group->depleted;
+        }
+    }
+
+    for(group = groups; group < &groups[group_count]; group++)
+    {
+        if(--group->countdown == 0)
+        {
+            group->countdown = group->period;
+            group->remaining = group->budget;
+        }
+    }
+}
+
+/**
+ * @brief Count down the first running timer, and hand the timers that expire to the daemon.
+ *
+ * Wakes the daemon if it is waiting.  It preempts a PERIODIC task of its partition; a
+ * running RR task is preempted on every tick anyway.
+ */
+static void kernel_update_timers(void)
+{
+    soft_timer_t* timer;
+
+    if(timer_list == NULL)
+    {
+        return;
+    }
+
+    --timer_list->delta;
+    while(timer_list != NULL && timer_list->delta == 0)
+    {
+        timer = timer_list;
+        timer_list = timer->next;
+        timer->running = 0;
+        if(timer->reload)
+        {
+            timer_insert(timer);
+        }
+
+        if(!timer->expired)
+        {
+            timer->expired = 1;
+            timer->next_expired = NULL;
+            if(timer_expired_head == NULL)
+            {
+                timer_expired_head = timer;
+            }
+            else
+            {
+                timer_expired_tail->next_expired = timer;
+            }
+            timer_expired_tail = timer;
+        }
+    }
+
+    if(timer_expired_head != NULL && timer_daemon_task != NULL && timer_daemon_task->state == WAITING &&
+       !timer_daemon_task->suspended)
+    {
+        timer_daemon_task->state = READY;
+        enqueue(&PARTITION(timer_daemon_task)->system_queue, timer_daemon_task);
+
+        if(cur_task->level == PERIODIC && cur_task->state == RUNNING &&
+           cur_task->partition == timer_daemon_task->partition)
+        {
+            cur_task->state = READY;
+            cur_task->next_release -= cur_task->period;
+        }
+    }
+}
+
+#undef SLOW_CLOCK
+
+#ifdef SLOW_CLOCK
+/**
+ * @brief For DEBUGGING to make the clock run slower
+ *
+ * Divide CLKI/O by 64 on timer 1 to run at 125 kHz  CS3[210] = 011
+ * 1 MHz CS3[210] = 010
+ */
+static void kernel_slow_clock(void)
+{
+    TCCR1B &= ~(_BV(CS12) | _BV(CS10));
+    TCCR1B |= (_BV(CS11));
+}
+#endif
+
+
+/*
+ * ================================================================================
+ * ================================================================================
+ * ====================                                        ====================
+ * ====================                Services                ====================
+ * ====================                                        ====================
+ * ================================================================================
+ * ================================================================================
+ */
+
+
+//TODO: WHY AM I USING DYNAMIC MEMORY?! I THINK THIS WILL BREAK THINGS!
+
+
+service_t *Service_Init()
 {
     if(service_count >= MAXSERVICES) {
         error_msg = ERR_2_MAX_SERVICES_REACHED;
@@ -1089,6 +1752,14 @@ service_t *Service_Init()
     service_t* retval = &services[service_count++];
     retval->subscribers.head = NULL;
     retval->subscribers.tail = NULL;
+#if OS_STATS
+    retval->publishes = 0;
+    retval->lost = 0;
+    retval->wakeups = 0;
+    retval->waiting = 0;
+    retval->max_subscribers = 0;
+    retval->worst_latency = 0;
+#endif
     return retval;
 }
 
@@ -1098,10 +1769,20 @@ void Service_Subscribe( service_t *s, int16_t *v )
         error_msg = ERR_RUN_7_PERIODIC_TASK_SUBSCRIBED;
         OS_Abort();
     }
+    if(cur_task == idle_task) {
+        error_msg = ERR_RUN_9_IDLE_JOB_SUBSCRIBED;
+        OS_Abort();
+    }
 
-    enqueue(&(s->subscribers), cur_task);
+    wait_insert(&(s->subscribers), cur_task);
     cur_task->state = WAITING;
     cur_task->value = v;
+#if OS_STATS
+    if(++s->waiting > s->max_subscribers)
+    {
+        s->max_subscribers = s->waiting;
+    }
+#endif
 
     Task_Next();
 }
@@ -1109,6 +1790,17 @@ void Service_Subscribe( service_t *s, int16_t *v )
 void Service_Publish( service_t *s, int16_t v )
 {
     int interrupt = 0;
+    task_descriptor_t* last_system = NULL;
+    task_descriptor_t* last_rr = NULL;
+
+#if OS_STATS
+    ++s->publishes;
+    if(s->subscribers.head == NULL)
+    {
+        ++s->lost;
+    }
+    s->waiting = 0;
+#endif
 
     task_descriptor_t* subscriber = dequeue(&(s->subscribers));
     while(subscriber != NULL)
@@ -1116,14 +1808,22 @@ void Service_Publish( service_t *s, int16_t v )
         if(subscriber->state == WAITING) {
             *(subscriber->value) = v;
             subscriber->state = READY;
-            if(subscriber->level == SYSTEM) {
-                if(cur_task->level != SYSTEM) {
+#if OS_STATS
+            ++s->wakeups;
+            subscriber->woken_by = s;
+            subscriber->woken_at = TCNT1;
+#endif
+            if(subscriber->suspended) {
+                /* Task_Resume() queues it. */
+            }
+            else if(subscriber->level == SYSTEM) {
+                if(cur_task->level != SYSTEM && subscriber->partition == cur_task->partition) {
                     interrupt = 1;
                 }
-                push_queue(&system_queue, subscriber);
+                ready_insert(&PARTITION(subscriber)->system_queue, &last_system, subscriber);
             }
             else if(subscriber->level == RR) {
-                push_queue(&rr_queue, subscriber);
+                ready_insert(&PARTITION(subscriber)->rr_queue, &last_rr, subscriber);
             } else {
                 error_msg = ERR_RUN_8_PERIODIC_TASK_FOUND_SUBSCRIBED;
                 OS_Abort();
@@ -1142,7 +1842,7 @@ void Service_Publish( service_t *s, int16_t v )
  * ================================================================================
  * ================================================================================
  * ====================                                        ====================
- * ====================              OS Functions              ====================
+ * ====================               Pipelines                ====================
  * ====================                                        ====================
  * ================================================================================
  * ================================================================================
@@ -1150,110 +1850,674 @@ void Service_Publish( service_t *s, int16_t v )
 
 
 /**
- * @brief Setup the RTOS and create main() as the first SYSTEM level task.
+ * @brief Wake the first task waiting in a channel's queue.
  *
- * Point of entry from the C runtime crt0.S.
+ * @return non-zero if it should run before the calling task.
  */
-void OS_Init()
+static uint8_t channel_wake(queue_t* queue_ptr)
 {
-    int i;
+    task_descriptor_t* task = dequeue(queue_ptr);
+    task_descriptor_t* last = NULL;
 
-    /* Set up the clocks */
+    if(task == NULL || task->state != WAITING)
+    {
+        return 0;
+    }
 
-    TCCR1B |= (_BV(CS11));
+    task->state = READY;
+    if(task->suspended)
+    {
+        return 0;
+    }
+    if(task->level == SYSTEM)
+    {
+        ready_insert(&PARTITION(task)->system_queue, &last, task);
+        return cur_task->level != SYSTEM && task->partition == cur_task->partition;
+    }
+    ready_insert(&PARTITION(task)->rr_queue, &last, task);
+    return 0;
+}
 
-#ifdef SLOW_CLOCK
-    kernel_slow_clock();
-#endif
+/**
+ * @brief The slot of the item n places after the oldest.
+ */
+static uint8_t* channel_slot(channel_t* c, uint8_t n)
+{
+    return c->buffer + ((c->head + n) % c->capacity) * (c->size + sizeof(uint32_t));
+}
 
-    /*
-     * Initialize dead pool to contain all but last task descriptor.
-     *
-     * DEAD == 0, already set in .init4
-     */
-    for (i = 0; i < MAXPROCESS - 1; i++)
+channel_t* Channel_Init(void* buffer, uint8_t size, uint8_t capacity, uint8_t policy)
+{
+    channel_t* c;
+
+    if(channel_count >= MAXCHANNELS || buffer == NULL || size == 0 || capacity == 0)
     {
-        task_desc[i].state = DEAD;
-        task_desc[i].next = &task_desc[i + 1];
+        return NULL;
     }
-    task_desc[MAXPROCESS - 1].next = NULL;
-    dead_pool_queue.head = &task_desc[0];
-    dead_pool_queue.tail = &task_desc[MAXPROCESS - 1];
 
-	/* Create idle "task" */
-    kernel_request_create_args.f = (voidfuncvoid_ptr)idle;
-    kernel_request_create_args.level = (int)NULL;
-    kernel_create_task();
+    c = &channels[channel_count++];
+    c->buffer = (uint8_t*)buffer;
+    c->size = size;
+    c->capacity = capacity;
+    c->policy = policy;
+    c->head = 0;
+    c->count = 0;
+    c->readers.head = NULL;
+    c->readers.tail = NULL;
+    c->writers.head = NULL;
+    c->writers.tail = NULL;
+    return c;
+}
 
-    /* Create "main" task as SYSTEM level. */
-    kernel_request_create_args.f = (voidfuncvoid_ptr)r_main;
-    kernel_request_create_args.level = SYSTEM;
-    kernel_create_task();
+uint8_t Channel_Write(channel_t* c, const void* item)
+{
+    uint8_t sreg;
+    uint8_t* slot;
+    uint32_t stamp;
 
-    /* First time through. Select "main" task to run first. */
-    cur_task = task_desc;
-    cur_task->state = RUNNING;
-    dequeue(&system_queue);
+    stamp = cur_task->stamped ? cur_task->stamp : OS_Time();
 
-    current_tick_multiplied = 0;
+    sreg = SREG;
+    Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
 
-    /* Set up Timer 1 Output Compare interrupt,the TICK clock. */
-    TIMSK1 |= _BV(OCIE1A);
-    previous_tick_time = TCNT1;
-    OCR1A = previous_tick_time + TICK_CYCLES;
+    while(c->count == c->capacity)
+    {
+        if(c->policy == CHANNEL_OVERWRITE)
+        {
+            c->head = (c->head + 1) % c->capacity;
+            --c->count;
+            break;
+        }
+        if(cur_task->level == PERIODIC || cur_task == idle_task)
+        {
+            IRQ_PROFILE_RESTORE(sreg);
+            SREG = sreg;
+            return 0;
+        }
 
-    /* Clear flag. */
-    TIFR1 = _BV(OCF1A);
+        wait_insert(&c->writers, cur_task);
+        cur_task->state = WAITING;
+        Task_Next();
+    }
 
-    service_count=0;
+    slot = channel_slot(c, c->count);
+    memcpy(slot, &stamp, sizeof(uint32_t));
+    memcpy(slot + sizeof(uint32_t), item, c->size);
+    ++c->count;
 
-    /*
-     * The main loop of the RTOS kernel.
-     */
-    kernel_main_loop();
-}
+    if(channel_wake(&c->readers))
+    {
+        kernel_interrupt_task();
+    }
 
-/**
- *  @Brief return time since operation began in millis.
- */
-uint16_t Now()
-{
-    uint16_t retval = current_tick_multiplied-5;
-    uint16_t cur_time = TCNT1 - previous_tick_time;
-    if(cur_time < MS_CYCLES)
-        return retval;
-    if(cur_time < MS_CYCLES2)
-        return retval+1;
-    if(cur_time < MS_CYCLES3)
-        return retval+2;
-    if(cur_time < MS_CYCLES4)
-        return retval+3;
-    return retval+4;
+    IRQ_PROFILE_RESTORE(sreg);
+    SREG = sreg;
+    return 1;
 }
 
 /**
- *  @brief Delay function adapted from <util/delay.h>
+ * @brief Take the oldest item out of a channel that has one.
  */
-static void _delay_25ms(void)
+static uint32_t channel_take(channel_t* c, void* item)
 {
-    //uint16_t i;
+    uint8_t* slot = channel_slot(c, 0);
+    uint32_t stamp;
 
-    /* 4 * 50000 CPU cycles = 25 ms */
-    //asm volatile ("1: sbiw %0,1" "\n\tbrne 1b" : "=w" (i) : "0" (50000));
-    _delay_ms(25);
-}
+    memcpy(&stamp, slot, sizeof(uint32_t));
+    memcpy(item, slot + sizeof(uint32_t), c->size);
+    c->head = (c->head + 1) % c->capacity;
+    --c->count;
 
+    cur_task->stamped = 1;
+    cur_task->stamp = stamp;
 
-/** @brief Abort the execution of this RTOS due to an unrecoverable erorr.
- */
-void OS_Abort(void)
+    if(channel_wake(&c->writers))
+    {
+        kernel_interrupt_task();
+    }
+    return stamp;
+}
+
+uint32_t Channel_Read(channel_t* c, void* item)
 {
-    uint8_t i, j;
-    uint8_t flashes;
+    uint8_t sreg;
+    uint32_t stamp;
 
+    sreg = SREG;
     Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
 
-    /* Initialize port for output */
+    while(c->count == 0)
+    {
+        if(cur_task->level == PERIODIC || cur_task == idle_task)
+        {
+            error_msg = ERR_RUN_11_ILLEGAL_CHANNEL_WAIT;
+            OS_Abort();
+        }
+
+        wait_insert(&c->readers, cur_task);
+        cur_task->state = WAITING;
+        Task_Next();
+    }
+    stamp = channel_take(c, item);
+
+    IRQ_PROFILE_RESTORE(sreg);
+    SREG = sreg;
+    return stamp;
+}
+
+uint8_t Channel_Try_Read(channel_t* c, void* item, uint32_t* stamp)
+{
+    uint8_t sreg;
+    uint32_t taken;
+
+    sreg = SREG;
+    Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
+
+    if(c->count == 0)
+    {
+        IRQ_PROFILE_RESTORE(sreg);
+        SREG = sreg;
+        return 0;
+    }
+    taken = channel_take(c, item);
+    if(stamp != NULL)
+    {
+        *stamp = taken;
+    }
+
+    IRQ_PROFILE_RESTORE(sreg);
+    SREG = sreg;
+    return 1;
+}
+
+
+/*
+ * ================================================================================
+ * ================================================================================
+ * ====================                                        ====================
+ * ====================            Software Timers             ====================
+ * ====================                                        ====================
+ * ================================================================================
+ * ================================================================================
+ */
+
+
+/**
+ * @brief Put a timer in the list of running timers, to expire in its ticks TICKs.
+ *
+ * Timers due at the same TICK expire in the order they were started.
+ */
+static void timer_insert(soft_timer_t* timer)
+{
+    soft_timer_t** link = &timer_list;
+    uint16_t delta = timer->ticks;
+
+    while(*link != NULL && (*link)->delta <= delta)
+    {
+        delta -= (*link)->delta;
+        link = &(*link)->next;
+    }
+
+    timer->delta = delta;
+    timer->next = *link;
+    if(*link != NULL)
+    {
+        (*link)->delta -= delta;
+    }
+    *link = timer;
+    timer->running = 1;
+}
+
+/**
+ * @brief Take a timer out of the list of running timers, if it is in it.
+ */
+static void timer_remove(soft_timer_t* timer)
+{
+    soft_timer_t** link;
+
+    if(!timer->running)
+    {
+        return;
+    }
+
+    for(link = &timer_list; *link != timer; link = &(*link)->next)
+    {
+    }
+    *link = timer->next;
+    if(timer->next != NULL)
+    {
+        timer->next->delta += timer->delta;
+    }
+    timer->running = 0;
+}
+
+/**
+ * @brief Take a timer out of the queue of expired timers, if it is in it.
+ */
+static void timer_cancel(soft_timer_t* timer)
+{
+    soft_timer_t** link;
+    soft_timer_t* previous = NULL;
+
+    if(!timer->expired)
+    {
+        return;
+    }
+
+    for(link = &timer_expired_head; *link != timer; link = &(*link)->next_expired)
+    {
+        previous = *link;
+    }
+    *link = timer->next_expired;
+    if(timer_expired_tail == timer)
+    {
+        timer_expired_tail = previous;
+    }
+    timer->expired = 0;
+}
+
+/**
+ * @brief The timer daemon calls the functions of the expired timers, and waits when there are none.
+ *
+ * It waits with interrupts disabled, so a TICK cannot find it WAITING before it has left the CPU.
+ */
+static void timer_daemon(void)
+{
+    soft_timer_t* timer;
+    void (*f)(int16_t);
+    int16_t arg;
+
+    Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
+    timer_daemon_task = cur_task;
+
+    for(;;)
+    {
+        timer = timer_expired_head;
+        if(timer == NULL)
+        {
+            cur_task->state = WAITING;
+            Task_Next();
+            IRQ_PROFILE_DISABLE();
+            continue;
+        }
+
+        timer_expired_head = timer->next_expired;
+        timer->expired = 0;
+        f = timer->f;
+        arg = timer->arg;
+
+        IRQ_PROFILE_ENABLE();
+        Enable_Interrupt();
+        f(arg);
+        Disable_Interrupt();
+        IRQ_PROFILE_DISABLE();
+    }
+}
+
+soft_timer_t* Timer_Init(void (*f)(int16_t), int16_t arg, uint16_t ticks, uint8_t reload)
+{
+    soft_timer_t* timer;
+
+    if(timer_count >= MAXTIMERS || ticks == 0)
+    {
+        return NULL;
+    }
+
+    if(!timer_daemon_created)
+    {
+        timer_daemon_created = Task_Create_System(timer_daemon, 0);
+        if(!timer_daemon_created)
+        {
+            return NULL;
+        }
+    }
+
+    timer = &timers[timer_count++];
+    timer->f = f;
+    timer->arg = arg;
+    timer->ticks = ticks;
+    timer->reload = reload;
+    return timer;
+}
+
+void Timer_Start(soft_timer_t* t)
+{
+    uint8_t sreg;
+
+    sreg = SREG;
+    Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
+
+    if(!t->running)
+    {
+        timer_insert(t);
+    }
+
+    IRQ_PROFILE_RESTORE(sreg);
+    SREG = sreg;
+}
+
+void Timer_Stop(soft_timer_t* t)
+{
+    uint8_t sreg;
+
+    sreg = SREG;
+    Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
+
+    timer_remove(t);
+    timer_cancel(t);
+
+    IRQ_PROFILE_RESTORE(sreg);
+    SREG = sreg;
+}
+
+void Timer_Reset(soft_timer_t* t)
+{
+    uint8_t sreg;
+
+    sreg = SREG;
+    Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
+
+    timer_remove(t);
+    timer_insert(t);
+
+    IRQ_PROFILE_RESTORE(sreg);
+    SREG = sreg;
+}
+
+
+/*
+ * ================================================================================
+ * ================================================================================
+ * ====================                                        ====================
+ * ====================               Partitions               ====================
+ * ====================                                        ====================
+ * ================================================================================
+ * ================================================================================
+ */
+
+
+int8_t Partition_Add_Window(uint8_t partition, uint16_t ticks)
+{
+    uint8_t sreg;
+    int8_t retval = 0;
+
+    if(partition >= MAXPARTITIONS || ticks == 0)
+    {
+        return 0;
+    }
+
+    sreg = SREG;
+    Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
+
+    if(window_count < MAXWINDOWS)
+    {
+        windows[window_count].partition = partition;
+        windows[window_count].ticks = ticks;
+        ++window_count;
+        retval = 1;
+    }
+
+    IRQ_PROFILE_RESTORE(sreg);
+    SREG = sreg;
+
+    return retval;
+}
+
+int8_t Partition_Select(uint8_t partition)
+{
+    if(partition >= MAXPARTITIONS)
+    {
+        return 0;
+    }
+    cur_task->child_partition = partition;
+    return 1;
+}
+
+
+/*
+ * ================================================================================
+ * ================================================================================
+ * ====================                                        ====================
+ * ====================           Reservation Groups           ====================
+ * ====================                                        ====================
+ * ================================================================================
+ * ================================================================================
+ */
+
+
+uint8_t Group_Init(uint16_t budget, uint16_t period)
+{
+    uint8_t sreg;
+    uint8_t retval = 0;
+
+    if(budget == 0 || period < budget)
+    {
+        return 0;
+    }
+
+    sreg = SREG;
+    Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
+
+    if(group_count < MAXGROUPS)
+    {
+        groups[group_count].budget = budget;
+        groups[group_count].period = period;
+        groups[group_count].remaining = budget;
+        groups[group_count].countdown = period;
+        ++group_count;
+        retval = group_count;
+    }
+
+    IRQ_PROFILE_RESTORE(sreg);
+    SREG = sreg;
+
+    return retval;
+}
+
+int8_t Group_Select(uint8_t group)
+{
+    if(group > group_count)
+    {
+        return 0;
+    }
+    cur_task->child_group = group;
+    return 1;
+}
+
+
+/*
+ * ================================================================================
+ * ================================================================================
+ * ====================                                        ====================
+ * ====================           Mixed Criticality            ====================
+ * ====================                                        ====================
+ * ================================================================================
+ * ================================================================================
+ */
+
+
+int8_t Criticality_Select(uint8_t criticality)
+{
+    if(criticality > CRIT_HI)
+    {
+        return 0;
+    }
+    cur_task->child_criticality = criticality;
+    return 1;
+}
+
+
+/*
+ * ================================================================================
+ * ================================================================================
+ * ====================                                        ====================
+ * ====================              OS Functions              ====================
+ * ====================                                        ====================
+ * ================================================================================
+ * ================================================================================
+ */
+
+
+/**
+ * @brief Setup the RTOS and create main() as the first SYSTEM level task.
+ *
+ * Point of entry from the C runtime crt0.S.
+ */
+void OS_Init()
+{
+    int i;
+
+    /* Set up the clocks */
+
+    TCCR1B |= (_BV(CS11));
+
+#ifdef SLOW_CLOCK
+    kernel_slow_clock();
+#endif
+
+    /*
+     * Initialize dead pool to contain all but last task descriptor.
+     *
+     * DEAD == 0, already set in .init4
+     */
+    for (i = 0; i < MAXPROCESS - 1; i++)
+    {
+        task_desc[i].state = DEAD;
+        task_desc[i].next = &task_desc[i + 1];
+    }
+    task_desc[MAXPROCESS - 1].next = NULL;
+    dead_pool_queue.head = &task_desc[0];
+    dead_pool_queue.tail = &task_desc[MAXPROCESS - 1];
+
+	/* Create idle "task" */
+    kernel_request_create_args.f = (voidfuncvoid_ptr)idle;
+    kernel_request_create_args.level = (int)NULL;
+    kernel_create_task();
+
+    /* Create "main" task as SYSTEM level. */
+    kernel_request_create_args.f = (voidfuncvoid_ptr)r_main;
+    kernel_request_create_args.level = SYSTEM;
+    kernel_request_create_args.criticality = CRIT_HI;
+    kernel_create_task();
+
+    /* First time through. Select "main" task to run first. */
+    cur_task = task_desc;
+    cur_task->state = RUNNING;
+    dequeue(&partitions[0].system_queue);
+
+    kernel_time = 0;
+    now_ms = 0;
+
+    /* Settings and statistics, before r_main() reads them. */
+    Store_Init();
+
+    /* The length of a TICK is a setting. */
+    tick_us = (uint16_t)Store_Get(STORE_KEY_TICK_US, TICK * 1000L);
+    if(tick_us < TICK_MIN_US || tick_us > TICK_MAX_US)
+    {
+        tick_us = TICK * 1000;
+    }
+    tick_cycles = tick_us * US_CYCLES;
+
+    /* Set up Timer 1 Output Compare interrupt,the TICK clock. */
+    TIMSK1 |= _BV(OCIE1A);
+    kernel_time_tcnt = TCNT1;
+    now_ms_tcnt = kernel_time_tcnt;
+#if OS_STATS
+    accounted_time = kernel_time_tcnt;
+#endif
+    next_tick = tick_cycles;
+    timer_match = kernel_time_tcnt + tick_cycles;
+    OCR1A = timer_match;
+
+    /* Clear flag. */
+    TIFR1 = _BV(OCF1A);
+
+    service_count=0;
+
+    /*
+     * The main loop of the RTOS kernel.
+     */
+    kernel_main_loop();
+}
+
+/**
+ *  @Brief return time since operation began in millis.
+ */
+uint16_t Now()
+{
+    uint8_t sreg;
+    uint16_t ms;
+    uint16_t since;
+
+    sreg = SREG;
+    Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
+    ms = now_ms;
+    since = TCNT1 - now_ms_tcnt;
+    IRQ_PROFILE_RESTORE(sreg);
+    SREG = sreg;
+
+    /* The kernel counts the milliseconds at least every TICK. */
+    return ms + since / MS_CYCLES;
+}
+
+uint16_t OS_Tick_Us(void)
+{
+    return tick_us;
+}
+
+uint32_t OS_Time(void)
+{
+    uint8_t sreg;
+    uint32_t time;
+
+    sreg = SREG;
+    Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
+    time = kernel_time + (uint16_t)(TCNT1 - kernel_time_tcnt);
+    IRQ_PROFILE_RESTORE(sreg);
+    SREG = sreg;
+
+    return time;
+}
+
+/**
+ *  @brief Delay function adapted from <util/delay.h>
+ */
+static void _delay_25ms(void)
+{
+    //uint16_t i;
+
+    /* 4 * 50000 CPU cycles = 25 ms */
+    //asm volatile ("1: sbiw %0,1" "\n\tbrne 1b" : "=w" (i) : "0" (50000));
+    _delay_ms(25);
+}
+
+
+/** @brief Abort the execution of this RTOS due to an unrecoverable erorr.
+ */
+void OS_Abort(void)
+{
+    uint8_t i, j;
+    uint8_t flashes;
+
+    Disable_Interrupt();
+
+#if CRASH_SNAPSHOT
+    kernel_save_crash();
+#endif
+
+    /* Initialize port for output */
     DDRB |= LED_MASK;
 
     if(error_msg < ERR_RUN_1_USER_CALLED_OS_ABORT)
@@ -1292,160 +2556,801 @@ void OS_Abort(void)
             PORTB = LED_MASK;
             for(i = 0; i < 40; ++i)
             {
-                _delay_25ms();
+                _delay_25ms();
+            }
+        }
+
+        PORTB = (uint8_t) 0;
+        for(i = 0; i < 60; ++i)
+        {
+            _delay_25ms();
+        }
+
+
+        for(j = 0; j < flashes; ++j)
+        {
+            PORTB = LED_MASK;
+            for(i = 0; i < 10; ++i)
+            {
+                _delay_25ms();
+            }
+
+            PORTB = (uint8_t) 0;
+            for(i = 0; i < 10; ++i)
+            {
+                _delay_25ms();
+            }
+        }
+
+        for(i = 0; i < 20; ++i)
+        {
+            _delay_25ms();
+        }
+    }
+}
+
+
+int8_t Task_Create_System(void (*f)(void), int16_t arg)
+{
+    int retval;
+    uint8_t sreg;
+
+    sreg = SREG;
+    Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
+
+    kernel_request_create_args.f = (voidfuncvoid_ptr)f;
+    kernel_request_create_args.arg = arg;
+    kernel_request_create_args.level = (uint8_t)SYSTEM;
+
+    kernel_request = TASK_CREATE;
+    enter_kernel();
+
+    retval = kernel_request_retval;
+    IRQ_PROFILE_RESTORE(sreg);
+    SREG = sreg;
+
+    return retval;
+}
+
+
+int8_t Task_Create_RR(void (*f)(void), int16_t arg)
+{
+    int retval;
+    uint8_t sreg;
+
+    sreg = SREG;
+    Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
+
+    kernel_request_create_args.f = (voidfuncvoid_ptr)f;
+    kernel_request_create_args.arg = arg;
+    kernel_request_create_args.level = (uint8_t)RR;
+
+    kernel_request = TASK_CREATE;
+    enter_kernel();
+
+    retval = kernel_request_retval;
+    IRQ_PROFILE_RESTORE(sreg);
+    SREG = sreg;
+
+    return retval;
+}
+
+
+int8_t Task_Create_Periodic(void(*f)(void), int16_t arg, uint16_t period, uint16_t wcet, uint16_t start)
+{
+    int retval;
+    uint8_t sreg;
+
+    sreg = SREG;
+    Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
+
+    kernel_request_create_args.f = (voidfuncvoid_ptr)f;
+    kernel_request_create_args.arg = arg;
+    kernel_request_create_args.level = (uint8_t)PERIODIC;
+    kernel_request_create_args.period = (uint32_t)period * tick_cycles;
+    kernel_request_create_args.wcet = (uint32_t)wcet * tick_cycles;
+    kernel_request_create_args.wcet_hi = kernel_request_create_args.wcet;
+    kernel_request_create_args.start = (uint32_t)start * tick_cycles;
+    kernel_request_create_args.from_tick = 1;
+
+    kernel_request = TASK_CREATE;
+    enter_kernel();
+
+    retval = kernel_request_retval;
+    IRQ_PROFILE_RESTORE(sreg);
+    SREG = sreg;
+
+    return retval;
+}
+
+
+int8_t Task_Create_Periodic_MC(void(*f)(void), int16_t arg, uint16_t period, uint16_t wcet, uint16_t wcet_hi, uint16_t start)
+{
+    int retval;
+    uint8_t sreg;
+
+    sreg = SREG;
+    Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
+
+    kernel_request_create_args.f = (voidfuncvoid_ptr)f;
+    kernel_request_create_args.arg = arg;
+    kernel_request_create_args.level = (uint8_t)PERIODIC;
+    kernel_request_create_args.period = (uint32_t)period * tick_cycles;
+    kernel_request_create_args.wcet = (uint32_t)wcet * tick_cycles;
+    kernel_request_create_args.wcet_hi = (uint32_t)wcet_hi * tick_cycles;
+    kernel_request_create_args.start = (uint32_t)start * tick_cycles;
+    kernel_request_create_args.from_tick = 1;
+
+    kernel_request = TASK_CREATE;
+    enter_kernel();
+
+    retval = kernel_request_retval;
+    IRQ_PROFILE_RESTORE(sreg);
+    SREG = sreg;
+
+    return retval;
+}
+
+
+int8_t Task_Create_Periodic_Us(void(*f)(void), int16_t arg, uint32_t period, uint32_t wcet, uint32_t start)
+{
+    int retval;
+    uint8_t sreg;
+
+    sreg = SREG;
+    Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
+
+    kernel_request_create_args.f = (voidfuncvoid_ptr)f;
+    kernel_request_create_args.arg = arg;
+    kernel_request_create_args.level = (uint8_t)PERIODIC;
+    kernel_request_create_args.period = period * US_CYCLES;
+    kernel_request_create_args.wcet = wcet * US_CYCLES;
+    kernel_request_create_args.wcet_hi = kernel_request_create_args.wcet;
+    kernel_request_create_args.start = start * US_CYCLES;
+    kernel_request_create_args.from_tick = 0;
+
+    kernel_request = TASK_CREATE;
+    enter_kernel();
+
+    retval = kernel_request_retval;
+    IRQ_PROFILE_RESTORE(sreg);
+    SREG = sreg;
+
+    return retval;
+}
+
+
+int8_t Task_Set_Weight(uint8_t weight)
+{
+#if RR_STRIDE
+    uint8_t sreg;
+
+    if(weight == 0)
+    {
+        return 0;
+    }
+
+    sreg = SREG;
+    Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
+    cur_task->stride = STRIDE1 / weight;
+    IRQ_PROFILE_RESTORE(sreg);
+    SREG = sreg;
+    return 1;
+#else
+    (void)weight;
+    return 0;
+#endif
+}
+
+
+void Task_Set_Priority(uint8_t priority)
+{
+    uint8_t sreg;
+
+    sreg = SREG;
+    Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
+    cur_task->priority = priority;
+    IRQ_PROFILE_RESTORE(sreg);
+    SREG = sreg;
+}
+
+
+/**
+  * @brief The calling task gives up its share of the processor voluntarily.
+  */
+void Task_Next()
+{
+    uint8_t volatile sreg;
+
+    sreg = SREG;
+    Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
+
+    kernel_request = TASK_NEXT;
+    enter_kernel();
+
+    IRQ_PROFILE_RESTORE(sreg);
+    SREG = sreg;
+}
+
+
+/**
+  * @brief The calling task terminates itself.
+  */
+void Task_Terminate()
+{
+    uint8_t sreg;
+
+    sreg = SREG;
+    Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
+
+    kernel_request = TASK_TERMINATE;
+    enter_kernel();
+
+    IRQ_PROFILE_RESTORE(sreg);
+    SREG = sreg;
+}
+
+
+/**
+  * @brief A task's id: its descriptor plus 1, plus ID_STRIDE for each task the descriptor held before.
+  *
+  * The idle task's id is MAXPROCESS + 1, which names no task.
+  */
+static int8_t task_id(task_descriptor_t* p)
+{
+    return p->generation * ID_STRIDE + (p - task_desc) + 1;
+}
+
+
+/**
+  * @brief The descriptor of a task id, or NULL if there is no such task.
+  *
+  * The id of a task that has terminated names no task, even once its descriptor is reused.
+  */
+static task_descriptor_t* task_from_id(int8_t task)
+{
+    task_descriptor_t* p;
+
+    if(task < 1)
+    {
+        return NULL;
+    }
+    p = &task_desc[(uint8_t)(task - 1) % ID_STRIDE];
+    if(p == idle_task || p->state == DEAD || p->generation != (uint8_t)(task - 1) / ID_STRIDE)
+    {
+        return NULL;
+    }
+    return p;
+}
+
+
+int8_t Task_Id(void)
+{
+    return task_id(cur_task);
+}
+
+
+int8_t Task_Suspend(int8_t task)
+{
+    uint8_t sreg;
+    task_descriptor_t* p;
+
+    sreg = SREG;
+    Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
+
+    p = task_from_id(task);
+    if(p == NULL)
+    {
+        IRQ_PROFILE_RESTORE(sreg);
+        SREG = sreg;
+        return 0;
+    }
+
+    if(!p->suspended)
+    {
+        p->suspended = 1;
+        if(p->level == PERIODIC)
+        {
+            list_remove(&PARTITION(p)->periodic_list, p);
+            /* A preempted activation gives up the rest of its slot. */
+            if(p != cur_task && (int32_t)(kernel_time - p->next_release) >= 0)
+            {
+                PARTITION(p)->slot_remaining = 0;
             }
         }
-
-        PORTB = (uint8_t) 0;
-        for(i = 0; i < 60; ++i)
+        else if(p->state == READY && p != cur_task)
         {
-            _delay_25ms();
+            queue_remove(p->level == SYSTEM ? &PARTITION(p)->system_queue : &PARTITION(p)->rr_queue, p);
         }
+    }
 
+    /* Give up the CPU; the kernel does not queue the task again until it is resumed. */
+    if(p == cur_task)
+    {
+        Task_Next();
+    }
 
-        for(j = 0; j < flashes; ++j)
-        {
-            PORTB = LED_MASK;
-            for(i = 0; i < 10; ++i)
-            {
-                _delay_25ms();
-            }
+    IRQ_PROFILE_RESTORE(sreg);
+    SREG = sreg;
+    return 1;
+}
 
-            PORTB = (uint8_t) 0;
-            for(i = 0; i < 10; ++i)
-            {
-                _delay_25ms();
-            }
-        }
 
-        for(i = 0; i < 20; ++i)
+int8_t Task_Resume(int8_t task)
+{
+    uint8_t sreg;
+    task_descriptor_t* p;
+    task_descriptor_t* last = NULL;
+    uint32_t late;
+
+    sreg = SREG;
+    Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
+
+    p = task_from_id(task);
+    if(p == NULL || !p->suspended)
+    {
+        IRQ_PROFILE_RESTORE(sreg);
+        SREG = sreg;
+        return 0;
+    }
+
+    p->suspended = 0;
+    if(p->level == PERIODIC)
+    {
+        /* Skip the releases missed while suspended. */
+        late = kernel_time - p->next_release;
+        if((int32_t)late >= 0)
         {
-            _delay_25ms();
+            p->next_release += (late / p->period + 1) * p->period;
         }
+        list_add(&PARTITION(p)->periodic_list, p);
     }
+    else if(p->state == READY)
+    {
+        ready_insert(p->level == SYSTEM ? &PARTITION(p)->system_queue : &PARTITION(p)->rr_queue, &last, p);
+    }
+
+    /* Let the kernel dispatch it, or set the timer for its release. */
+    if(p->partition == cur_task->partition &&
+       (p->level == PERIODIC || (p->level == SYSTEM && p->state == READY)))
+    {
+        kernel_interrupt_task();
+    }
+
+    IRQ_PROFILE_RESTORE(sreg);
+    SREG = sreg;
+    return 1;
 }
 
 
-int8_t Task_Create_System(void (*f)(void), int16_t arg)
+void Task_Join(int8_t task)
 {
-    int retval;
     uint8_t sreg;
+    task_descriptor_t* p;
 
     sreg = SREG;
     Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
 
-    kernel_request_create_args.f = (voidfuncvoid_ptr)f;
-    kernel_request_create_args.arg = arg;
-    kernel_request_create_args.level = (uint8_t)SYSTEM;
+    p = task_from_id(task);
+    if(p != NULL && p != cur_task)
+    {
+        if(cur_task->level == PERIODIC || cur_task == idle_task)
+        {
+            error_msg = ERR_RUN_10_ILLEGAL_JOIN;
+            OS_Abort();
+        }
 
-    kernel_request = TASK_CREATE;
-    enter_kernel();
+        cur_task->joining = p;
+        cur_task->state = WAITING;
+        Task_Next();
+    }
 
-    retval = kernel_request_retval;
+    IRQ_PROFILE_RESTORE(sreg);
     SREG = sreg;
-
-    return retval;
 }
 
 
-int8_t Task_Create_RR(void (*f)(void), int16_t arg)
+/**
+  * @brief Queue a background job for the idle task.
+  */
+int8_t Idle_Submit(void (*f)(int16_t), int16_t arg)
 {
-    int retval;
     uint8_t sreg;
+    int8_t retval = 0;
 
     sreg = SREG;
     Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
 
-    kernel_request_create_args.f = (voidfuncvoid_ptr)f;
-    kernel_request_create_args.arg = arg;
-    kernel_request_create_args.level = (uint8_t)RR;
-
-    kernel_request = TASK_CREATE;
-    enter_kernel();
+    if(idle_job_count < MAXIDLEJOBS)
+    {
+        idle_jobs[(idle_job_head + idle_job_count) % MAXIDLEJOBS].f = f;
+        idle_jobs[(idle_job_head + idle_job_count) % MAXIDLEJOBS].arg = arg;
+        ++idle_job_count;
+        retval = 1;
+    }
 
-    retval = kernel_request_retval;
+    IRQ_PROFILE_RESTORE(sreg);
     SREG = sreg;
 
     return retval;
 }
 
 
-int8_t Task_Create_Periodic(void(*f)(void), int16_t arg, uint16_t period, uint16_t wcet, uint16_t start)
+/** @brief Retrieve the assigned parameter.
+ */
+int Task_GetArg(void)
 {
-    int retval;
+    int arg;
     uint8_t sreg;
 
     sreg = SREG;
     Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
 
-    kernel_request_create_args.f = (voidfuncvoid_ptr)f;
-    kernel_request_create_args.arg = arg;
-    kernel_request_create_args.level = (uint8_t)PERIODIC;
-    kernel_request_create_args.period = period;
-    kernel_request_create_args.wcet = wcet;
-    kernel_request_create_args.start = start;
-
-    kernel_request = TASK_CREATE;
-    enter_kernel();
+    arg = cur_task->arg;
 
-    retval = kernel_request_retval;
+    IRQ_PROFILE_RESTORE(sreg);
     SREG = sreg;
 
-    return retval;
+    return arg;
+}
+
+/*
+ * ================================================================================
+ * ================================================================================
+ * ====================                                        ====================
+ * ====================               Statistics               ====================
+ * ====================                                        ====================
+ * ================================================================================
+ * ================================================================================
+ */
+
+#if OS_STATS
+/**
+ * @brief Charge the time since the kernel last ran to the task that was running.
+ *
+ * The kernel runs at least every TICK, well within one turn of Timer 1.
+ */
+static void kernel_account(void)
+{
+    uint16_t now = TCNT1;
+    cur_task->run_time += (uint16_t)(now - accounted_time);
+    accounted_time = now;
 }
 
+/**
+ * @brief Measure the response time of the PERIODIC task finishing its activation.
+ */
+static void kernel_periodic_done(void)
+{
+    uint32_t response = kernel_time - cur_task->release;
+
+    if(response > worst_response)
+    {
+        worst_response = response;
+    }
+    if(response > cur_task->wcet)
+    {
+        ++overruns;
+    }
+}
 
 /**
-  * @brief The calling task gives up its share of the processor voluntarily.
-  */
-void Task_Next()
+ * @brief Bytes of a task's stack never used, looking only below the last mark.
+ *
+ * The stack grows down without gaps, so anything the task has used since the last
+ * look is just below the old mark.  A pushed byte equal to STACK_PAINT stops the
+ * search early; the crash snapshot scans the whole stack instead.
+ */
+static uint16_t kernel_stack_mark(task_descriptor_t* task)
 {
-    uint8_t volatile sreg;
+    while(task->stack_free > 0 && task->stack[task->stack_free - 1] != STACK_PAINT)
+    {
+        --task->stack_free;
+    }
+    return task->stack_free;
+}
+#endif
+
+uint8_t OS_Task_Info(uint8_t task, task_info_t* info)
+{
+    uint8_t sreg;
+
+    if(task > MAXPROCESS)
+    {
+        return 0;
+    }
 
     sreg = SREG;
     Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
+    info->level = task_desc[task].level;
+    info->state = task_desc[task].state;
+#if OS_STATS
+    info->run_time = task_desc[task].run_time;
+    info->stack_free = task_desc[task].state == DEAD ? MAXSTACK : kernel_stack_mark(&task_desc[task]);
+#else
+    info->run_time = 0;
+    info->stack_free = 0;
+#endif
+    IRQ_PROFILE_RESTORE(sreg);
+    SREG = sreg;
+    return 1;
+}
 
-    kernel_request = TASK_NEXT;
-    enter_kernel();
+void OS_Periodic_Stats(periodic_stats_t* stats)
+{
+    uint8_t sreg = SREG;
 
+    Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
+#if OS_STATS
+    stats->worst_response = worst_response / MS_CYCLES;
+    stats->overruns = overruns;
+    stats->mode_switches = mode_switches;
+    stats->shed = shed;
+    worst_response = 0;
+#else
+    stats->worst_response = 0;
+    stats->overruns = 0;
+    stats->mode_switches = 0;
+    stats->shed = 0;
+#endif
+    IRQ_PROFILE_RESTORE(sreg);
     SREG = sreg;
 }
 
-
-/**
-  * @brief The calling task terminates itself.
-  */
-void Task_Terminate()
+uint8_t OS_Service_Info(uint8_t service, service_info_t* info)
 {
+    task_descriptor_t* subscriber;
     uint8_t sreg;
 
+    if(service >= service_count)
+    {
+        return 0;
+    }
+
     sreg = SREG;
     Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
+    info->subscribers = 0;
+    for(subscriber = services[service].subscribers.head; subscriber != NULL; subscriber = subscriber->next)
+    {
+        ++info->subscribers;
+    }
+#if OS_STATS
+    info->publishes = services[service].publishes;
+    info->lost = services[service].lost;
+    info->wakeups = services[service].wakeups;
+    info->max_subscribers = services[service].max_subscribers;
+    info->worst_latency = services[service].worst_latency / US_CYCLES;
+#else
+    info->publishes = 0;
+    info->lost = 0;
+    info->wakeups = 0;
+    info->max_subscribers = 0;
+    info->worst_latency = 0;
+#endif
+    IRQ_PROFILE_RESTORE(sreg);
+    SREG = sreg;
+    return 1;
+}
 
-    kernel_request = TASK_TERMINATE;
-    enter_kernel();
+uint8_t OS_Group_Info(uint8_t group, group_info_t* info)
+{
+    uint8_t sreg;
+
+    if(group == 0 || group > group_count)
+    {
+        return 0;
+    }
 
+    sreg = SREG;
+    Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
+    info->budget = groups[group - 1].budget;
+    info->period = groups[group - 1].period;
+    info->remaining = groups[group - 1].remaining;
+    info->used = groups[group - 1].used;
+    info->depleted = groups[group - 1].depleted;
+    IRQ_PROFILE_RESTORE(sreg);
     SREG = sreg;
+    return 1;
 }
 
+/*
+ * ================================================================================
+ * ================================================================================
+ * ====================                                        ====================
+ * ====================             Crash Snapshot             ====================
+ * ====================                                        ====================
+ * ================================================================================
+ * ================================================================================
+ */
+
+#if CRASH_SNAPSHOT
 
-/** @brief Retrieve the assigned parameter.
+static uint8_t task_index(task_descriptor_t* task)
+{
+    if(task == NULL || task == idle_task)
+    {
+        return CRASH_NO_TASK;
+    }
+    return task - task_desc;
+}
+
+/**
+ * @brief Bytes at the bottom of a task's stack still holding the paint.
  */
-int Task_GetArg(void)
+static uint16_t stack_free(task_descriptor_t* task)
+{
+    uint16_t free;
+    for(free = 0; free < MAXSTACK && task->stack[free] == STACK_PAINT; ++free);
+    return free;
+}
+
+/**
+ * @brief Record a kernel event for the crash snapshot.
+ */
+static void kernel_trace(uint8_t event, task_descriptor_t* task)
+{
+    crash_event_t* entry = &trace[trace_head];
+
+    entry->event = event;
+    entry->task = task_index(task);
+    entry->time = now_ms;
+    trace_head = (trace_head + 1) % CRASH_TRACE_LENGTH;
+}
+
+/**
+ * @brief Write len bytes of the snapshot to EEPROM, adding them to the checksum.
+ */
+static void crash_write(void* eeprom, const void* data, uint8_t len, uint8_t* checksum)
+{
+    const uint8_t* bytes = data;
+    uint8_t i;
+
+    for(i = 0; i < len; ++i)
+    {
+        *checksum += bytes[i];
+    }
+    eeprom_update_block(data, eeprom, len);
+}
+
+/**
+ * @brief Save the state of the kernel to EEPROM.
+ *
+ * Called from OS_Abort() with interrupts disabled, possibly on a nearly full task
+ * stack, so the snapshot is written field by field rather than built in RAM.  The
+ * magic byte is cleared first and written last, so a snapshot cut short by a reset
+ * is never read back.
+ */
+static void kernel_save_crash(void)
+{
+    crash_snapshot_t* ee = CRASH_EEPROM;
+    uint8_t checksum = 0;
+    uint8_t value;
+    uint16_t word;
+    crash_task_t task;
+    uint8_t i;
+
+    eeprom_update_byte(&ee->magic, 0);
+
+    value = error_msg;
+    crash_write(&ee->error, &value, 1, &checksum);
+    value = task_index(cur_task);
+    crash_write(&ee->task, &value, 1, &checksum);
+    word = Now();
+    crash_write(&ee->now, &word, 2, &checksum);
+    word = SP;
+    crash_write(&ee->sp, &word, 2, &checksum);
+
+    for(i = 0; i < MAXPROCESS; ++i)
+    {
+        task.level = task_desc[i].level;
+        task.state = task_desc[i].state;
+        task.sp = (uint16_t)task_desc[i].sp;
+        task.stack_free = stack_free(&task_desc[i]);
+        crash_write(&ee->tasks[i], &task, sizeof(task), &checksum);
+    }
+
+    /* Oldest event first. */
+    for(i = 0; i < CRASH_TRACE_LENGTH; ++i)
+    {
+        crash_write(&ee->trace[i], &trace[(trace_head + i) % CRASH_TRACE_LENGTH], sizeof(crash_event_t), &checksum);
+    }
+
+    eeprom_update_byte(&ee->checksum, -checksum);
+    eeprom_update_byte(&ee->magic, CRASH_MAGIC);
+}
+
+/**
+ * @brief Disable interrupts once the EEPROM is ready.
+ *
+ * Store_Tick() writes the EEPROM from the tick interrupt, so a task must not be interrupted
+ * part way through an access.  The write in progress is waited for with interrupts enabled.
+ *
+ * @return SREG as it was, to restore when the access is done.
+ */
+static uint8_t crash_eeprom_lock(void)
 {
-    int arg;
     uint8_t sreg;
 
-    sreg = SREG;
-    Disable_Interrupt();
+    for(;;)
+    {
+        eeprom_busy_wait();
+        sreg = SREG;
+        Disable_Interrupt();
+        IRQ_PROFILE_DISABLE();
+        if(eeprom_is_ready())
+        {
+            return sreg;
+        }
+        IRQ_PROFILE_RESTORE(sreg);
+        SREG = sreg;
+    }
+}
 
-    arg = cur_task->arg;
+uint8_t OS_Crash_Read(crash_snapshot_t* snapshot)
+{
+    const uint8_t* bytes = (const uint8_t*)snapshot;
+    uint8_t checksum = 0;
+    uint16_t i;
+    uint8_t sreg;
 
+    sreg = crash_eeprom_lock();
+    eeprom_read_block(snapshot, CRASH_EEPROM, sizeof(crash_snapshot_t));
+    IRQ_PROFILE_RESTORE(sreg);
     SREG = sreg;
 
-    return arg;
+    if(snapshot->magic != CRASH_MAGIC)
+    {
+        return 0;
+    }
+    for(i = 1; i < sizeof(crash_snapshot_t); ++i)
+    {
+        checksum += bytes[i];
+    }
+    return checksum == 0;
 }
 
+void OS_Crash_Clear(void)
+{
+    uint8_t sreg;
+
+    sreg = crash_eeprom_lock();
+    eeprom_update_byte(&CRASH_EEPROM->magic, 0xFF);
+    IRQ_PROFILE_RESTORE(sreg);
+    SREG = sreg;
+}
+
+#else
+
+uint8_t OS_Crash_Read(crash_snapshot_t* snapshot)
+{
+    (void)snapshot;
+    return 0;
+}
+
+void OS_Crash_Clear(void)
+{
+}
+
+#endif
+
 /**
  * Runtime entry point into the program; just start the RTOS.  The application layer must define r_main() for its entry point.
  */
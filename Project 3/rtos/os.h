@@ -31,6 +31,10 @@ extern "C" {
  *   Our RTOS scheduler timer resolution is defined by TICK. Hence, all timing parameters must
  *   be defined in multiples of TICKs. For PERIODIC tasks, its period, wcet and start time
  *   must be a multiple of TICKs. For RR tasks, its quantum is also defined in terms of TICKs.
+ *   PERIODIC tasks created by Task_Create_Periodic_Us() are the exception; see \ref periodic.
+ *
+ *   A TICK is TICK msec unless the setting STORE_KEY_TICK_US holds another length in usec,
+ *   from TICK_MIN_US to TICK_MAX_US, when OS_Init() runs.  OS_Tick_Us() returns it.
  *
  *
  * \section policy SCHEDULING POLICY
@@ -89,9 +93,16 @@ extern "C" {
  *
  *   When a PERIODIC task is preempted, its worst-case execution time will be stretched.
  *   In a similar way, when a RR task is preempted, its allowed quantum will be stretched.
- *   In theory, the RTOS should only accumulate the actual execution time; but in practice,
- *   the actual execution time could only be approximated due to the limitation of the
- *   scheduling timer resolution (1 TICK).
+ *   The RTOS accumulates the actual execution time of a PERIODIC task from Timer 1, along with
+ *   the time the kernel spends on its behalf, and ends its slot on a Timer 1 match rather
+ *   than at a TICK.
+ *
+ *   Task_Create_Periodic_Us() takes the period, wcet and start in usec instead of TICKs, for
+ *   control loops faster than a TICK or with periods that are not a multiple of one.  The
+ *   kernel sets the Timer 1 match to the earliest of the next TICK, the next release of a
+ *   PERIODIC task of the running partition and the end of the running task's slot, so each
+ *   release happens within a few tens of usec of its time, whatever the TICK.  The start
+ *   counts from the call, not from a TICK.
  *
  *   It is an error if a PERIODIC task waits on an Event.
  *
@@ -105,9 +116,32 @@ extern "C" {
  *   However, if a RR task is preempted before its quantum expires, it re-enters at the
  *   front of its queue.
  *
+ *   Built with RR_STRIDE, RR tasks share the CPU in proportion to their weights instead of
+ *   taking turns (stride scheduling).  Each task has a pass that advances by STRIDE1 divided
+ *   by its weight for every quantum it starts, whether it uses all of it or calls Task_Next(),
+ *   and the RR task with the smallest pass runs next.  A task given weight 4 with
+ *   Task_Set_Weight() then runs 4 quanta for each quantum of a task of weight 1.  A task that
+ *   was waiting, or held back by its group, starts level with the task that ran last rather
+ *   than catching up on the time it missed.  Tasks of equal weight take turns as before.
+ *
  *   Only SYSTEM and RR tasks may wait for a service. Any task can send notifications over a service.
  *
  *
+ * \section groups RESERVATION GROUPS
+ *
+ *   RR tasks share the CPU left to them per task, so a subsystem with more tasks gets more of
+ *   it.  A reservation group made by Group_Init() has a budget of TICKs every period TICKs,
+ *   shared by its RR tasks.  Each TICK a member is running at is charged to the group, and
+ *   once the budget is used up the members are passed over until the next period begins.
+ *   RR tasks outside any group are never held back, so a group caps a subsystem rather than
+ *   guaranteeing it time: give the spinning tasks a group and leave the ones they would
+ *   starve out of it, or give each subsystem a group.  Budgets left over do not carry on to
+ *   the next period.
+ *
+ *   Tasks join the group of the task that created them, set with Group_Select(); r_main() is
+ *   in no group.  Only RR tasks are in a group.  OS_Group_Info() reports each group's use.
+ *
+ *
  * \section ipc services
  *
  *   Services are used to transfer data safely between tasks.  Any number of tasks can wait on a
@@ -125,6 +159,11 @@ extern "C" {
  *   the message.  Only the latest notificaton is stored.  If a new notification comes in it overwrites
  *   the previous notification.
  *
+ *   Subscribers are woken in order of their Task_Set_Priority(), the most urgent first, and in the
+ *   order they subscribed among equals.  Each goes ahead of the READY tasks at its level that are
+ *   no more urgent, so the most urgent subscriber runs first.  With RR_STRIDE the pass still
+ *   decides between RR tasks; priority only breaks ties.
+ *
  *   Example:
  *   - A RR task that sends sensor values over a radio subscribes to a service
  *   - Three PERIODIC tasks read from three different ultrasonic range finders on a schedule
@@ -134,6 +173,75 @@ extern "C" {
  *   (this concept can be extended to RPC across several agents, but this feature is not required
  *   for project 2)
  *
+ * \section timers SOFTWARE TIMERS
+ *
+ *   A software timer calls a function after a number of TICKs, once or over and over, without
+ *   a task of its own.  Timer_Init() makes one, Timer_Start() and Timer_Stop() start and stop
+ *   it, and Timer_Reset() starts its count again, to time out unless something keeps putting
+ *   it off.  The running timers are kept in a list sorted by when they expire, each holding
+ *   the TICKs after the one before it, so a TICK only counts down the first.  The functions
+ *   of the timers that expired are called one at a time, in the order they expired, by a
+ *   SYSTEM task, the timer daemon, created by the first Timer_Init() in the caller's
+ *   partition.  So they run soon after the TICK, may publish to services and start or stop
+ *   timers, but must be short and must not wait for a service, or the other timers are late.
+ *   A timer that expires again before its function has been called is called only once.
+ *
+ *
+ * \section pipelines PIPELINES
+ *
+ *   A pipeline is a chain of stages, each a SYSTEM or RR task, joined by channels.  A channel
+ *   holds up to a fixed number of items of a fixed size, oldest first.  A stage waits in
+ *   Channel_Read() until its input channel has an item, works on it and passes its result on
+ *   with Channel_Write().  When the output channel is full, a CHANNEL_BLOCK channel makes the
+ *   writer wait for room, which slows the stages before a slow one; a CHANNEL_OVERWRITE
+ *   channel drops its oldest item instead, so the next stage always gets the freshest data.
+ *
+ *   Every item carries the time, from OS_Time(), its data entered the pipeline.  A task that
+ *   has read an item writes its time with the items it writes; a task that has not, such as
+ *   a PERIODIC source, writes the current time.  The last stage finds the age of its data,
+ *   from source to sink, as OS_Time() less the time Channel_Read() returns.
+ *
+ *   Only tasks use channels.  PERIODIC tasks must not wait: they read with Channel_Try_Read(),
+ *   and their writes to a full CHANNEL_BLOCK channel are dropped.
+ *
+ *
+ * \section criticality MIXED CRITICALITY
+ *
+ *   Every task is CRIT_HI or CRIT_LO.  A HI PERIODIC task created by Task_Create_Periodic_MC()
+ *   has two budgets: an optimistic wcet that it normally keeps to, and a pessimistic wcet_hi
+ *   that it may need now and then.  When it runs past its wcet, it is not an error: its
+ *   partition switches to HI mode and the task may run on up to its wcet_hi.  In HI mode the
+ *   LO tasks of the partition are put aside: LO SYSTEM and RR tasks stay in their queues, and
+ *   the activations of LO PERIODIC tasks released in HI mode are skipped.  The partition
+ *   returns to LO mode the first time no HI task is ready.  Overrunning wcet_hi, or a LO task
+ *   overrunning its wcet, is still an error.
+ *
+ *   So the wcets can be set for the average case, as long as the LO tasks can go without.
+ *   Tasks are HI unless they were created after Criticality_Select(CRIT_LO); an RR task that
+ *   is always ready should be LO, or HI mode lasts until it waits.
+ *
+ *
+ * \section partitions PARTITIONS
+ *
+ *   Partitions keep subsystems from starving each other.  The major frame is a fixed cycle of
+ *   windows added with Partition_Add_Window(), each a number of TICKs given to one partition.
+ *   Each partition has its own SYSTEM, PERIODIC and RR tasks, scheduled by the policies above
+ *   as if they had the CPU to themselves, but only during its own windows.  At the end of a
+ *   window the running task is preempted whatever its level, and resumes first when its
+ *   partition's next window begins.  If no task of the partition is ready, the idle task runs:
+ *   a partition never gets time left over by another.  So a task can only delay tasks of its
+ *   own partition, and a partition given w TICKs in a frame of f TICKs waits at most f - w
+ *   TICKs for the CPU.
+ *
+ *   Tasks run in the partition of the task that created them, r_main() in partition 0.  A task
+ *   calls Partition_Select() to create tasks in another.  PERIODIC tasks count down in every
+ *   window, so their releases should fall inside their partition's windows.  A PERIODIC task
+ *   released outside them runs when the next one begins.  Publishing wakes subscribers in
+ *   every partition, but only the publisher's partition is preempted.
+ *
+ *   Without any windows every task is in partition 0 and scheduled as before.
+ *
+ *
  * \section clock CLOCK AND HIGH RESOLUTION TIMER
  *
  *   Every RTOS should maintain a "clock" for simple timing services, e.g., measuring timing
@@ -180,19 +288,78 @@ extern "C" {
   */
 /* limits */
 
-/** max. number of processes supported */
+/** max. number of processes supported; fewer with -DMAXPROCESS to fit a 2 KB ATmega328P */
+#ifndef MAXPROCESS
 #define MAXPROCESS		8 // 7 processes available to user.
+#endif
 
 /** time resolution */
-#define TICK			    5     // resolution of system clock in milliseconds
+#define TICK			    5     // default resolution of system clock in milliseconds
+/** Limits of the setting STORE_KEY_TICK_US. */
+#define TICK_MIN_US   1000
+#define TICK_MAX_US   16000
 #define QUANTUM       5     // a quantum for RR tasks
 
+/** The RTOS timer's prescaler divisor */
+#define TIMER_PRESCALER 8
+
+/** The number of Timer 1 counts in one ms, and in one us, the unit of OS_Time(). */
+#define MS_CYCLES       ((F_CPU / TIMER_PRESCALER) / 1000)
+#define US_CYCLES       ((F_CPU / TIMER_PRESCALER) / 1000000)
+
 /** thread runtime stack */
+#ifndef MAXSTACK
 #define MAXSTACK      256   // bytes
+#endif
 
 /** service runtime pool */
 #define MAXSERVICES  8
 
+/** partitions, and windows in the major frame
+ * \sa \ref partitions, Partition_Add_Window().
+ */
+#define MAXPARTITIONS  4
+#define MAXWINDOWS     8
+
+/** background jobs that can wait for the idle task
+ * \sa Idle_Submit().
+ */
+#define MAXIDLEJOBS  8
+
+/** software timers
+ * \sa \ref timers, Timer_Init().
+ */
+#define MAXTIMERS  8
+
+/** reservation groups for RR tasks
+ * \sa \ref groups, Group_Init().
+ */
+#define MAXGROUPS  4
+
+/** channels between pipeline stages
+ * \sa \ref pipelines, Channel_Init().
+ */
+#define MAXCHANNELS  4
+
+/** save a crash snapshot to EEPROM in OS_Abort()
+ * \sa OS_Crash_Read().
+ */
+#define CRASH_SNAPSHOT      1
+/** kernel events kept for the crash snapshot */
+#define CRASH_TRACE_LENGTH  16
+
+/** share the CPU among RR tasks by weight rather than in turn
+ * \sa \ref roundrobin, Task_Set_Weight().
+ */
+#ifndef RR_STRIDE
+#define RR_STRIDE           0
+#endif
+
+/** measure the time each task runs and how busy each service is
+ * \sa OS_Task_Info(), OS_Service_Info().
+ */
+#define OS_STATS            1
+
 /* scheduling levels */
 
 /** a scheduling level: system tasks with first-come-first-served policy
@@ -216,6 +383,12 @@ extern "C" {
 
 #define IDLE     0
 
+/** criticality levels
+ * \sa \ref criticality, Criticality_Select().
+ */
+#define CRIT_LO   0
+#define CRIT_HI   1
+
 
 /*================
   *    T Y P E S
@@ -245,8 +418,138 @@ queue_t, list_t;
 typedef struct service service_t;
 struct service {
     queue_t subscribers;
+#if OS_STATS
+    /** See service_info_t; worst_latency is in Timer 1 counts. */
+    uint16_t publishes;
+    uint16_t lost;
+    uint16_t wakeups;
+    uint8_t waiting;
+    uint8_t max_subscribers;
+    uint16_t worst_latency;
+#endif
 };
 
+/** A software timer
+ * \sa Timer_Init().
+ */
+typedef struct soft_timer soft_timer_t;
+
+/** A channel between pipeline stages
+ * \sa Channel_Init().
+ */
+typedef struct channel channel_t;
+
+/** What a write to a full channel does.
+ * \sa \ref pipelines.
+ */
+#define CHANNEL_BLOCK       0
+#define CHANNEL_OVERWRITE   1
+
+/** The bytes of buffer a channel needs, for its items and their times. */
+#define CHANNEL_BYTES(size, capacity)   ((uint16_t)(capacity) * ((size) + sizeof(uint32_t)))
+
+/** What OS_Task_Info() reports about one task descriptor. */
+typedef struct {
+    /** SYSTEM, PERIODIC, RR or IDLE. */
+    uint8_t level;
+    /** DEAD, RUNNING, READY or WAITING. */
+    uint8_t state;
+    /** Time the task has run, in Timer 1 counts (0.5 us), wrapping around. */
+    uint32_t run_time;
+    /** Bytes of the stack never used since the task was created; MAXSTACK if DEAD. */
+    uint16_t stack_free;
+} task_info_t;
+
+/** What OS_Periodic_Stats() reports about PERIODIC tasks. */
+typedef struct {
+    /** Longest time from the release of an activation to its Task_Next(), in ms,
+     *  since the last call to OS_Periodic_Stats(). */
+    uint16_t worst_response;
+    /** Activations that took longer than their wcet to finish because SYSTEM tasks
+     *  preempted them or they used their wcet_hi, since OS_Init(), wrapping around. */
+    uint16_t overruns;
+    /** Switches to HI mode, and activations of LO tasks skipped in HI mode, since
+     *  OS_Init(), wrapping around.  \sa \ref criticality. */
+    uint16_t mode_switches;
+    uint16_t shed;
+} periodic_stats_t;
+
+/** What OS_Service_Info() reports about one service. */
+typedef struct {
+    /** Tasks waiting on the service. */
+    uint8_t subscribers;
+    /** Times the service was published, times that found no subscriber, and subscribers
+     *  woken, since OS_Init(), wrapping around. */
+    uint16_t publishes;
+    uint16_t lost;
+    uint16_t wakeups;
+    /** The most tasks ever waiting on the service at once. */
+    uint8_t max_subscribers;
+    /** The longest time in us from a publish to the dispatch of a subscriber it woke.
+     *  Latencies over 32 ms are not measured correctly. */
+    uint16_t worst_latency;
+} service_info_t;
+
+/** What OS_Group_Info() reports about one reservation group. */
+typedef struct {
+    /** The budget in TICKs every period TICKs. */
+    uint16_t budget;
+    uint16_t period;
+    /** TICKs of the budget left in this period. */
+    uint16_t remaining;
+    /** TICKs charged to the group, and periods in which it used up its budget,
+     *  since OS_Init(), wrapping around. */
+    uint16_t used;
+    uint16_t depleted;
+} group_info_t;
+
+/** Kernel events in a crash snapshot's trace. */
+#define CRASH_EVENT_CREATE      1   /* a task created a task */
+#define CRASH_EVENT_TERMINATE   2   /* a task terminated */
+#define CRASH_EVENT_NEXT        3   /* a task called Task_Next(), or subscribed */
+#define CRASH_EVENT_INTERRUPT   4   /* a task was preempted by a publish */
+#define CRASH_EVENT_DISPATCH    5   /* a different task started running */
+
+/** No task: the kernel or the idle task was running. */
+#define CRASH_NO_TASK           0xFF
+
+/** One task descriptor at the time of the crash. */
+typedef struct {
+    /** SYSTEM, PERIODIC, RR or IDLE. */
+    uint8_t level;
+    /** DEAD, RUNNING, READY or WAITING. */
+    uint8_t state;
+    /** The saved stack pointer. */
+    uint16_t sp;
+    /** Bytes of the stack never used since the task was created. */
+    uint16_t stack_free;
+} __attribute__((packed)) crash_task_t;
+
+/** One kernel event: what happened, to which task, and when (ms since OS_Init()). */
+typedef struct {
+    uint8_t event;
+    uint8_t task;
+    uint16_t time;
+} __attribute__((packed)) crash_event_t;
+
+/** The state of the RTOS when OS_Abort() was called.
+ * \sa OS_Crash_Read().
+ */
+typedef struct {
+    uint8_t magic;
+    /** The error_code.h value OS_Abort() was called with. */
+    uint8_t error;
+    /** The descriptor of the running task, or CRASH_NO_TASK. */
+    uint8_t task;
+    /** Now() at the crash, and the stack pointer OS_Abort() was called with. */
+    uint16_t now;
+    uint16_t sp;
+    crash_task_t tasks[MAXPROCESS];
+    /** The last kernel events, oldest first; unused entries have event 0. */
+    crash_event_t trace[CRASH_TRACE_LENGTH];
+    uint8_t checksum;
+} __attribute__((packed)) crash_snapshot_t;
+
 /*================
   *    G L O B A L S
   *================
@@ -274,19 +577,68 @@ void OS_Init(void);
  */
 void OS_Abort();
 
+/**
+ * \param snapshot where to copy the snapshot saved by the last OS_Abort()
+ * \return non-zero if there is a snapshot; 0 otherwise.
+ *
+ * Call from r_main() to find out how the last run ended.  The snapshot stays
+ * in EEPROM until OS_Crash_Clear() is called or the next crash replaces it.
+ * \sa CRASH_SNAPSHOT.
+ */
+uint8_t OS_Crash_Read(crash_snapshot_t* snapshot);
+
+/** Forget the saved crash snapshot. */
+void OS_Crash_Clear(void);
+
+/**
+ * \param task a task descriptor, 0 to MAXPROCESS - 1, or MAXPROCESS for the idle task
+ * \param info where to copy what is known about it
+ * \return 0 if there is no such descriptor; otherwise non-zero.
+ *
+ * The kernel charges the time since it last ran to the running task each time
+ * it is entered, so time in the kernel counts against the task that entered it.
+ * Take the difference of two readings to get a task's share of the CPU.
+ * \sa OS_STATS.
+ */
+uint8_t OS_Task_Info(uint8_t task, task_info_t* info);
+
+/**
+ * \param service a service, in the order they were created by Service_Init()
+ * \param info where to copy what is known about it
+ * \return 0 if there is no such service; otherwise non-zero.
+ */
+uint8_t OS_Service_Info(uint8_t service, service_info_t* info);
+
+/**
+ * \param group a reservation group, 1 to the number made by Group_Init()
+ * \param info where to copy what is known about it
+ * \return 0 if there is no such group; otherwise non-zero.
+ */
+uint8_t OS_Group_Info(uint8_t group, group_info_t* info);
+
+/**
+ * \param stats where to copy the response times of PERIODIC tasks
+ *
+ * Starts a new measurement of the worst response time.
+ * \sa OS_STATS.
+ */
+void OS_Periodic_Stats(periodic_stats_t* stats);
+
 
   /*=====  Task API ===== */
 
  /**
    * \param f  a parameterless function to be created as a process instance
    * \param arg an integer argument to be assigned to this process instanace
-   * \return 0 if not successful; otherwise non-zero.
+   * \return 0 if not successful; otherwise the new task's id.
    * \sa Task_GetArg()
    *
    *  A new process is created to execute the parameterless
    *  function \a f with an initial parameter \a arg, which is retrieved
    *  by a call to Task_GetArg().  If a new process cannot be
-   *  created, 0 is returned; otherwise, it returns non-zero.
+   *  created, 0 is returned; otherwise, it returns the id Task_Suspend(),
+   *  Task_Resume() and Task_Join() take.  The id names no task once the
+   *  task terminates.
    *
    * \sa \ref policy
    */
@@ -299,18 +651,51 @@ int8_t   Task_Create_RR(    void (*f)(void), int16_t arg);
    * \param period its execution period in TICKs
    * \param wcet its worst-case execution time in TICKs, must be less than "period"
    * \param start its start time in TICKs
-   * \return 0 if not successful; otherwise non-zero.
+   * \return 0 if not successful; otherwise the new task's id.
    * \sa Task_GetArg()
    *
    *  A new process is created to execute the parameterless
    *  function \a f with an initial parameter \a arg, which is retrieved
    *  by a call to Task_GetArg().  If a new process cannot be
-   *  created, 0 is returned; otherwise, it returns non-zero.
+   *  created, 0 is returned; otherwise, it returns the id Task_Suspend(),
+   *  Task_Resume() and Task_Join() take.  The id names no task once the
+   *  task terminates.
    *
    * \sa \ref policy
    */
 int8_t   Task_Create_Periodic(void(*f)(void), int16_t arg, uint16_t period, uint16_t wcet, uint16_t start);
 
+ /**
+   * \param wcet its optimistic worst-case execution time in TICKs
+   * \param wcet_hi its pessimistic worst-case execution time in TICKs, at least "wcet" and
+   *   less than "period"
+   *
+   *  As Task_Create_Periodic(), for a HI task that switches its partition to HI mode
+   *  instead of failing when it runs past "wcet".
+   *
+   * \sa \ref criticality
+   */
+int8_t   Task_Create_Periodic_MC(void(*f)(void), int16_t arg, uint16_t period, uint16_t wcet, uint16_t wcet_hi, uint16_t start);
+
+ /**
+   * \param period its execution period in usec
+   * \param wcet its worst-case execution time in usec, must be less than "period"
+   * \param start usec from now to its first release
+   *
+   *  As Task_Create_Periodic(), with times in usec, rounded to 0.5 usec.
+   *
+   * \sa \ref periodic
+   */
+int8_t   Task_Create_Periodic_Us(void(*f)(void), int16_t arg, uint32_t period, uint32_t wcet, uint32_t start);
+
+/**
+  * \param criticality CRIT_LO or CRIT_HI
+  * \return 0 if there is no such level; otherwise non-zero.
+  *
+  * Tasks the calling task creates from now on have this criticality.
+  */
+int8_t Criticality_Select(uint8_t criticality);
+
 /**
  * Terminate the calling process
  *
@@ -322,12 +707,122 @@ void Task_Terminate();
 /** Voluntarily relinquish the processor. */
 void Task_Next();
 
+/** \return the calling task's id. */
+int8_t Task_Id(void);
+
+/**
+  * \param task a task's id
+  * \return 0 if there is no such task; otherwise non-zero.
+  *
+  * The task keeps its context, and any service it waits for, but leaves the ready queues
+  * until Task_Resume().  A PERIODIC task misses the releases in between.
+  * A task may suspend itself.
+  */
+int8_t Task_Suspend(int8_t task);
+
+/**
+  * \param task a suspended task's id
+  * \return 0 if there is no such task or it is not suspended; otherwise non-zero.
+  *
+  * A PERIODIC task is next released at the first of its release times still to come.  A
+  * SYSTEM or RR task that is ready rejoins its queue ahead of the tasks of its priority.
+  */
+int8_t Task_Resume(int8_t task);
+
+/**
+  * \param task a task's id
+  *
+  * Wait until the task terminates; return at once if there is no such task.  The tasks
+  * created in a terminated task's descriptor get new ids, until the ids wrap around after
+  * 127 / (MAXPROCESS + 1) tasks.  PERIODIC tasks and background jobs must not join.
+  */
+void Task_Join(int8_t task);
+
+/**
+  * \param weight the calling RR task's share of the CPU relative to other RR tasks, 1 to 255
+  * \return 0 if weight is 0 or the OS is built without RR_STRIDE; otherwise non-zero.
+  *
+  * Tasks start with weight 1.  Without RR_STRIDE the weight is ignored.
+  * \sa \ref roundrobin
+  */
+int8_t Task_Set_Weight(uint8_t weight);
+
+/**
+  * \param priority higher is more urgent; tasks start with 0
+  *
+  * Sets the order in which the calling task is woken among the tasks waiting with it on a
+  * service or channel.  A woken task goes ahead of the READY tasks at its level with its
+  * priority or lower, so of the tasks one publish wakes, the most urgent runs first.
+  * \sa \ref ipc
+  */
+void Task_Set_Priority(uint8_t priority);
+
 /** Retrieve the assigned parameter.
   * \sa Task_Create().
   */
 int16_t Task_GetArg();
 
 
+  /*=====  Partitions API ===== */
+
+/**
+  * \param partition 0 to MAXPARTITIONS - 1
+  * \param ticks the length of the window in TICKs
+  * \return 0 if the window is not valid or there are already MAXWINDOWS; otherwise non-zero.
+  *
+  * Add a window at the end of the major frame.  The frame starts at the next TICK after the
+  * first window is added, so add the windows last in r_main().
+  * \sa \ref partitions
+  */
+int8_t Partition_Add_Window(uint8_t partition, uint16_t ticks);
+
+/**
+  * \param partition 0 to MAXPARTITIONS - 1
+  * \return 0 if there is no such partition; otherwise non-zero.
+  *
+  * Tasks the calling task creates from now on run in this partition.
+  */
+int8_t Partition_Select(uint8_t partition);
+
+
+  /*=====  Reservation Groups API ===== */
+
+/**
+  * \param budget TICKs the group's RR tasks may run every period, at least 1
+  * \param period the replenishment period in TICKs, at least "budget"
+  * \return the new group, 1 to MAXGROUPS; 0 if the arguments are not valid or there are
+  *   already MAXGROUPS groups.
+  *
+  * The first period starts at the next TICK.
+  * \sa \ref groups
+  */
+uint8_t Group_Init(uint16_t budget, uint16_t period);
+
+/**
+  * \param group a group made by Group_Init(), or 0 for none
+  * \return 0 if there is no such group; otherwise non-zero.
+  *
+  * RR tasks the calling task creates from now on are in this group.
+  */
+int8_t Group_Select(uint8_t group);
+
+
+  /*=====  Idle Jobs API ===== */
+
+/**
+  * \param f a function to run with the idle task's stack when nothing else is ready
+  * \param arg the argument to pass to \a f
+  * \return 0 if MAXIDLEJOBS jobs are already waiting; otherwise non-zero.
+  *
+  * Jobs run one at a time, in the order they were submitted, whenever no SYSTEM,
+  * PERIODIC or RR task is ready.  Any task or interrupt may submit one.  A job can be
+  * preempted at any point like the idle task, so it may be as long as it likes, but it
+  * shares the idle task's MAXSTACK bytes and must not wait for a service.  A job that
+  * wants to run again submits itself.  The time jobs run counts as idle time.
+  */
+int8_t Idle_Submit(void (*f)(int16_t), int16_t arg);
+
+
   /*=====  Events API ===== */
 
 /**
@@ -351,11 +846,92 @@ void Service_Subscribe( service_t *s, int16_t *v );
   * \param e a Service descriptor
   *
   * The calling task publishes a new value "v" to service "s". All waiting tasks on
-  * service "s" will be resumed and receive a copy of this value "v".
+  * service "s" will be resumed, most urgent first, and receive a copy of this value "v".
   * Values generated by services without subscribers will be lost.
   */
 void Service_Publish( service_t *s, int16_t v );
 
+  /*=====  Software Timers API ===== */
+
+/**
+ * \param f the function to call when the timer expires
+ * \param arg the argument to pass to \a f
+ * \param ticks TICKs from starting the timer until it expires, at least 1
+ * \param reload non-zero to expire every \a ticks TICKs until stopped; 0 to expire once
+ * \return a stopped timer, or NULL if MAXTIMERS have been made or \a ticks is 0.
+ *
+ * Call from a task; the first call creates the timer daemon.
+ * \sa \ref timers
+ */
+soft_timer_t* Timer_Init(void (*f)(int16_t), int16_t arg, uint16_t ticks, uint8_t reload);
+
+/**
+ * \param t a timer
+ *
+ * Start a stopped timer; a running timer carries on as it was.  Tasks and interrupts may
+ * start, stop and reset timers.
+ */
+void Timer_Start(soft_timer_t* t);
+
+/**
+ * \param t a timer
+ *
+ * Stop a timer.  Its function is not called, even if it has expired and is waiting for the
+ * daemon.
+ */
+void Timer_Stop(soft_timer_t* t);
+
+/**
+ * \param t a timer
+ *
+ * Start a timer's count again from now, whether it was running or not.  If it has expired
+ * and is waiting for the daemon, its function is still called.
+ */
+void Timer_Reset(soft_timer_t* t);
+
+  /*=====  Pipelines API ===== */
+
+/**
+ * \param buffer CHANNEL_BYTES(size, capacity) bytes for the channel's items
+ * \param size bytes in an item, at least 1
+ * \param capacity items the channel holds, at least 1
+ * \param policy CHANNEL_BLOCK or CHANNEL_OVERWRITE
+ * \return an empty channel, or NULL if MAXCHANNELS have been made or an argument is 0.
+ * \sa \ref pipelines
+ */
+channel_t* Channel_Init(void* buffer, uint8_t size, uint8_t capacity, uint8_t policy);
+
+/**
+ * \param c a channel
+ * \param item the item to copy in
+ * \return 0 if the item was dropped; otherwise non-zero.
+ *
+ * Add an item, stamped with the time of the item the calling task read last, or the
+ * current time if it has read none, and wake a task waiting to read.  When the channel is
+ * full, wait for room or drop the oldest item, as its policy says; a PERIODIC task's item
+ * is dropped instead of waiting.
+ */
+uint8_t Channel_Write(channel_t* c, const void* item);
+
+/**
+ * \param c a channel
+ * \param item where to copy the oldest item
+ * \return the time the item's data entered the pipeline, from OS_Time().
+ *
+ * Wait until the channel has an item and take it.  PERIODIC tasks must not call it.
+ */
+uint32_t Channel_Read(channel_t* c, void* item);
+
+/**
+ * \param c a channel
+ * \param item where to copy the oldest item
+ * \param stamp where to copy the item's time, or NULL
+ * \return 0 if the channel was empty; otherwise non-zero.
+ *
+ * As Channel_Read(), without waiting.
+ */
+uint8_t Channel_Try_Read(channel_t* c, void* item, uint32_t* stamp);
+
   /*=====  System Clock API ===== */
 
 /**
@@ -374,6 +950,15 @@ void Service_Publish( service_t *s, int16_t v );
   */
 uint16_t Now();  // number of milliseconds since the RTOS boots.
 
+/** \return the length of a TICK in usec. */
+uint16_t OS_Tick_Us(void);
+
+/**
+  * Returns the time since OS_Init() in Timer 1 counts (0.5 usec), wrapping around after
+  * about 35 minutes.  Take differences, as with Now().
+  */
+uint32_t OS_Time(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -33,6 +33,26 @@ typedef struct _msg
 	uint8_t messagecontent[24];
 } pf_message_t;
 
+/// The health of a roomba's kernel and radio, carried in the spare bytes of its ROOMBASTATE_PACKETs.  See telemetry.h.
+typedef struct _telemetry
+{
+	uint8_t sequence;			// counts digests, so the base station can tell a new one from a repeat or a lost one.
+	uint8_t cpu_load;			// percentage of the CPU used by tasks since the last digest.
+	uint16_t worst_response;	// longest PERIODIC response since the last digest, in ms.
+	uint16_t overruns;			// PERIODIC activations stretched past their wcet since boot.
+	uint8_t radio_resent;		// retransmissions per 100 packets since the last digest.
+	uint8_t radio_dropped;		// percentage of packets dropped since the last digest.
+	uint8_t stack_margin;		// fewest stack bytes any task has never used, at most 255.
+	uint8_t stack_task;			// the task with that margin.
+} pf_telemetry_t;
+
+/// A ROOMBASTATE_PACKET: the roomba's state, followed by a telemetry digest the base station may ignore.
+typedef struct _roombareport
+{
+	pf_roombastate_t roombastate;
+	pf_telemetry_t telemetry;
+} pf_roombareport_t;
+
 /*****							Add format structures to the union							*****/
 
 /// The application-dependent packet format.  Add structures to the union that correspond to the packet types defined
@@ -43,6 +63,7 @@ typedef union _pf
 	uint8_t _filler[29];	// makes sure the packet is exactly 32 bytes long - this array should not be accessed directly.
 	pf_gamestate_t gamestate;
 	pf_roombastate_t roombastate;
+	pf_roombareport_t roombareport;
 	pf_message_t message;
 } payloadformat_t;
 
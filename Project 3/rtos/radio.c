@@ -6,6 +6,8 @@
  */
 #include "radio.h"
 #include "port_map.h"
+#include "store.h"
+#include "irq_profile.h"
 
 // debug
 #define DEBUG_1_HIGH	PORTH |= _BV(PH3)
@@ -200,7 +202,8 @@ static void configure_registers(uint8_t channel)
 
 	// set Enhanced Shockburst retry to every 586 us, up to 5 times.  If packet collisions are a problem even with AA enabled,
 	// then consider changing the retry delay to be different on the different stations so that they do not keep colliding on each retry.
-	value = 0x15;
+	// The setting can be changed in the store, see store.h.
+	value = (uint8_t)Store_Get(STORE_KEY_RADIO_RETRY, 0x15);
 	//value = 0x10;
 	set_register(SETUP_RETR, &value, 1);
 
@@ -324,6 +327,22 @@ void Radio_Set_Tx_Addr(uint8_t* address)
 	set_register(TX_ADDR, address, ADDRESS_LENGTH);
 }
 
+void Radio_Configure_Rx_P(RADIO_PIPE pipe, const uint8_t* address, ON_OFF enable)
+{
+	uint8_t copy[ADDRESS_LENGTH];
+
+	Flash_Read(copy, address, ADDRESS_LENGTH);
+	Radio_Configure_Rx(pipe, copy, enable);
+}
+
+void Radio_Set_Tx_Addr_P(const uint8_t* address)
+{
+	uint8_t copy[ADDRESS_LENGTH];
+
+	Flash_Read(copy, address, ADDRESS_LENGTH);
+	Radio_Set_Tx_Addr(copy);
+}
+
 void Radio_Configure(RADIO_DATA_RATE dr, RADIO_TX_POWER power)
 {
 	uint8_t value;
@@ -458,6 +477,7 @@ ISR(INT4_vect)
     uint8_t status;
     uint8_t pipe_number;
 
+    IRQ_PROFILE_ISR_ENTER();
 	DEBUG_2_LOW;
     CE_LOW();
 
@@ -467,8 +487,16 @@ ISR(INT4_vect)
     {
     	pipe_number =  (status & 0xE) >> 1;
     	radio_rxhandler(pipe_number);
+    	Store_Add(STORE_KEY_RADIO_RX, 1);
     }
     // We can get the TX_DS or the MAX_RT interrupt, but not both.
+    if (status & (_BV(TX_DS) | _BV(MAX_RT)))
+    {
+    	// count the retransmissions of the packet, before FLUSH_TX resets the count.
+    	uint8_t observe;
+    	get_register(OBSERVE_TX, &observe, 1);
+    	Store_Add(STORE_KEY_RADIO_RESENT, (observe >> ARC_CNT) & 0x0F);
+    }
     if (status & _BV(TX_DS))
     {
         // if there's nothing left to transmit, switch back to receive mode.
@@ -481,6 +509,7 @@ ISR(INT4_vect)
     	tx_history |= 1;
 
     	tx_last_status = RADIO_TX_SUCCESS;
+    	Store_Add(STORE_KEY_RADIO_TX, 1);
     }
     else if (status & _BV(MAX_RT))
     {
@@ -493,6 +522,7 @@ ISR(INT4_vect)
     	tx_history <<= 1;
 
     	tx_last_status = RADIO_TX_MAX_RT;
+    	Store_Add(STORE_KEY_RADIO_TX_FAILED, 1);
     }
 
     // clear the interrupt flags.
@@ -501,5 +531,6 @@ ISR(INT4_vect)
 	DEBUG_2_HIGH;
 
     CE_HIGH();
+    IRQ_PROFILE_ISR_EXIT();
 }
 
@@ -23,6 +23,7 @@
 #include "nRF24L01.h"
 #include "packet.h"
 #include "spi.h"
+#include "flash.h"
 
 #define RADIO_ADDRESS_LENGTH 5
 
@@ -110,6 +111,11 @@ void Radio_Init(uint8_t channel);
  */
 void Radio_Configure_Rx(RADIO_PIPE pipe, uint8_t* address, ON_OFF enable);
 
+/**
+ * As Radio_Configure_Rx(), with the address in a FLASH table.
+ */
+void Radio_Configure_Rx_P(RADIO_PIPE pipe, const uint8_t* address, ON_OFF enable);
+
 /**
  * Configure the radio transceiver.
  * \param dr The data rate at which the radio will transmit and receive data (1 Mbps or 2 Mbps).
@@ -123,6 +129,11 @@ void Radio_Configure(RADIO_DATA_RATE dr, RADIO_TX_POWER power);
  */
 void Radio_Set_Tx_Addr(uint8_t* address);
 
+/**
+ * As Radio_Set_Tx_Addr(), with the address in a FLASH table.
+ */
+void Radio_Set_Tx_Addr_P(const uint8_t* address);
+
 /**
  * Transmit some data to another station.
  * \param payload The data packet to transmit.
@@ -0,0 +1,110 @@
+/*
+ * decision.c
+ *
+ * The roomba's automation state machine.
+ */
+
+#include "decision.h"
+
+void Decision_Init(decision_t* decision, automation_data_t* automation) {
+    decision->automation_state = STRAIGHT;
+    decision->rotating = 0;
+    automation->distance = 0;
+    automation->rotation = 0;
+}
+
+void Decision_Update_Odometry(automation_data_t* automation, const roomba_sensor_data_t* sensors) {
+    automation->distance += 120;// sensors->distance.value; Doesn't work on our firmware
+    automation->rotation += sensors->angle.value*3;
+}
+
+void Decision_Step(decision_t* decision, const decision_params_t* params,
+                   uint8_t game_state, uint8_t roomba_state,
+                   const roomba_sensor_data_t* sensors,
+                   automation_data_t* automation, control_state_t* controls) {
+    switch(game_state) {
+        case GAME_STARTING:
+            decision->automation_state = STRAIGHT;
+            controls->turn_radius = 0x8000; // Straight
+            controls->drive_velocity = 0; //500 max;
+            controls->shooting = 0;
+            break;
+        case GAME_RUNNING:
+            decision->rotating = 0;
+            // Handle death globally from any state.
+            if((roomba_state & DEAD) != 0) {
+                decision->automation_state = IS_DEAD;
+            }
+            switch(decision->automation_state) {
+                // Drive in a straight line for approximately 1 meter.
+                case STRAIGHT:
+                    controls->turn_radius = 0x8000; // Straight
+                    controls->drive_velocity = params->straight_velocity; //500 max;
+                    controls->shooting = 0;
+                    if(automation->distance > params->straight_distance || (sensors->bumps_wheeldrops & 0x3) > 0 || sensors->light_bumber > 0) {
+                        decision->automation_state = ORBIT;
+                        automation->rotation = 0;
+                        automation->distance = 0;
+                    }
+                    break;
+                // Rotate 270 degrees clockwise.
+                case ORBIT:
+                    controls->drive_velocity = params->orbit_velocity;
+                    controls->turn_radius = 1; // On spot clockwise.
+                    controls->shooting = 1;
+                    if(automation->rotation <= params->orbit_rotation) {
+                        decision->automation_state = STRAIGHT;
+                        automation->rotation = 0;
+                        automation->distance = 0;
+                    }
+                    break;
+                // Cannot move, stay in place.
+                case IS_DEAD:
+                    controls->drive_velocity = 0;
+                    controls->turn_radius = 0;
+                    controls->shooting = 0;
+                    if((roomba_state & DEAD) == 0) {
+                        decision->automation_state = IS_REVIVED;
+                        automation->rotation = 0;
+                        automation->distance = 0;
+                    }
+                    break;
+                // Revent spree! Rotate 720 degrees counter clockwise spamming shoost!
+                case IS_REVIVED:
+                    controls->drive_velocity = params->revived_velocity;
+                    controls->turn_radius = -1; // On spot cclockwise.
+                    controls->shooting = 1;
+                    if(automation->rotation >= params->revived_rotation) {
+                        decision->automation_state = STRAIGHT;
+                        automation->rotation = 0;
+                        automation->distance = 0;
+                    }
+            }
+            break;
+        case GAME_OVER:
+            decision->automation_state = STRAIGHT;
+            // Victory dance! (rotate on the spot)
+            if((roomba_state & DEAD) == 0) {
+                controls->turn_radius = -1; // Clockwise
+                controls->drive_velocity = 200; //500 max;
+            // Loosers corner! (shake head back and forth.)
+            } else {
+                if(decision->rotating == 0) {
+                    decision->rotating = 1;
+                    controls->turn_radius = 1; // Clockwise
+                    controls->drive_velocity = 100;
+                    break;
+                }
+
+                if(automation->rotation >= 10) {
+                    controls->turn_radius = 1; // cClockwise
+                    controls->drive_velocity = 100;
+                } else if(automation->rotation <= -10) {
+                    controls->turn_radius = -1; // Clockwise
+                    controls->drive_velocity = 100;
+                }
+            }
+            controls->shooting = 0;
+            break;
+    }
+}
@@ -0,0 +1,77 @@
+/*
+ * decision.h
+ *
+ * The roomba's automation state machine, kept free of any hardware access so that the same
+ * code drives the real roomba and the host-side game simulator.
+ */
+
+#ifndef DECISION_H_
+#define DECISION_H_
+
+#include <stdint.h>
+#include "cops_and_robbers.h"
+#include "sensor_struct.h"
+
+typedef struct _control_state {
+    uint8_t shooting;
+    int16_t drive_velocity; // Forwards/backwards speed roomba
+    int16_t turn_radius; // Turning speed roomba
+} control_state_t;
+
+typedef enum _automation_state {
+    STRAIGHT,
+    ORBIT,
+    IS_DEAD,
+    IS_REVIVED
+} automation_state_t;
+
+typedef struct _automation_data {
+    int16_t distance;
+    int16_t rotation;
+} automation_data_t;
+
+/**
+ * Tuning constants of the automation state machine.
+ */
+typedef struct _decision_params {
+    int16_t straight_velocity;  // Drive speed while going straight.
+    int16_t straight_distance;  // Distance to drive before orbiting.
+    int16_t orbit_velocity;     // Spin speed while orbiting.
+    int16_t orbit_rotation;     // Rotation (negative, clockwise) to orbit before going straight again.
+    int16_t revived_velocity;   // Spin speed after being revived.
+    int16_t revived_rotation;   // Rotation (counter clockwise) to spin after being revived.
+} decision_params_t;
+
+/** The constants the roombas play with. */
+#define DECISION_PARAMS_DEFAULT { 300, 1000, 100, -260, 250, 710 }
+
+/**
+ * State carried by the automation state machine between steps.
+ */
+typedef struct _decision {
+    automation_state_t automation_state;
+    uint8_t rotating;
+} decision_t;
+
+/**
+ * Reset the state machine and the distance/rotation it works from.
+ */
+void Decision_Init(decision_t* decision, automation_data_t* automation);
+
+/**
+ * Accumulate the distance and rotation reported by a chassis sensor update.
+ */
+void Decision_Update_Odometry(automation_data_t* automation, const roomba_sensor_data_t* sensors);
+
+/**
+ * Evaluate the state machine once and update the roomba's controls.
+ *
+ * \param game_state the GAME_STATE last received from the base station.
+ * \param roomba_state the roomba's own DEAD | FORCED flags.
+ */
+void Decision_Step(decision_t* decision, const decision_params_t* params,
+                   uint8_t game_state, uint8_t roomba_state,
+                   const roomba_sensor_data_t* sensors,
+                   automation_data_t* automation, control_state_t* controls);
+
+#endif /* DECISION_H_ */
@@ -12,6 +12,7 @@
 #include <avr/io.h>
 #include <util/delay.h>
 #include <avr/interrupt.h>
+#include "irq_profile.h"
 
 extern void ir_rxhandler();
 
@@ -73,6 +74,7 @@ void IR_init() {
 
 //Receiving a signal.
 ISR(INT5_vect) {
+	IRQ_PROFILE_ISR_ENTER();
 	if(!is_receiving) {
 		//Start a new byte, start the timers.
 		is_receiving = 1;
@@ -88,10 +90,12 @@ ISR(INT5_vect) {
 		// enable timer 3 interrupts
 		TIMSK3 |= (1<<OCIE3A);
 	}
+	IRQ_PROFILE_ISR_EXIT();
 }
 
 //Read a new arriving signal.
 ISR(TIMER3_COMPA_vect) {
+	IRQ_PROFILE_ISR_ENTER();
 	if(is_receiving) {
 
 		// check to see if the input pin is HIGH ( digital pin 3)
@@ -121,6 +125,7 @@ ISR(TIMER3_COMPA_vect) {
 	}else if (is_transmitting) {
 
 	}
+	IRQ_PROFILE_ISR_EXIT();
 }
 
 
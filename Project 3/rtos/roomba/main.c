@@ -5,6 +5,10 @@
 // OPERATING SYSTEM
 #include "port_map.h"
 #include "os.h"
+#include "irq_profile.h"
+#include "store.h"
+#include "shell.h"
+#include "telemetry.h"
 
 // RADIO COMMUNICATION
 #include "radio.h"
@@ -15,31 +19,21 @@
 #include "roomba_sci.h"
 #include "sensor_struct.h"
 
+// AUTOMATION
+#include "decision.h"
+
 // IR CONTROL
 #include "ir.h"
 
-typedef struct _control_state {
-    uint8_t shooting;
-    int16_t drive_velocity; // Forwards/backwards speed roomba
-    int16_t turn_radius; // Turning speed roomba
-} control_state_t;
-
-typedef enum _automation_state {
-    STRAIGHT,
-    ORBIT,
-    IS_DEAD,
-    IS_REVIVED
-} automation_state_t;
-
-typedef struct _automation_data {
-    int16_t distance;
-    int16_t rotation;
-} automation_data_t;
-
 // OS GLOBALS
 service_t* radio_receive_service;
 service_t* radio_send_service;
 
+// ROOMBA CONFIG, kept in the store so one image serves every roomba.  Set them with the
+// shell's 'c' command (key 32 is the COPS_AND_ROBBERS identity, 33 the radio channel) and reset.
+#define CONFIG_IDENTITY     (STORE_KEY_APP + 0)
+#define CONFIG_CHANNEL      (STORE_KEY_APP + 1)
+
 // ROOMBA CONFIG GLOBALS
 COPS_AND_ROBBERS roomba_identity = ROBBER1;
 IR_TEAM_CODE ir_team = ROBBER_CODE;
@@ -52,6 +46,17 @@ roomba_sensor_data_t roomba_sensor_data;
 automation_data_t roomba_automation_data;
 control_state_t roomba_controls;
 
+// SENSE -> DECIDE -> DRIVE
+// roomba_interface writes the ROOMBA_SENSOR_GROUP it just read into roomba_sensor_data, and
+// decision_making wakes for each frame to decide and drive once.
+channel_t* sensor_frames;
+uint8_t sensor_frames_buffer[CHANNEL_BYTES(sizeof(uint8_t), 1)];
+
+// Time from the end of a sensor frame to the drive command it caused, in Timer 1 counts.
+uint32_t drive_latency;
+uint32_t drive_latency_worst;
+uint16_t drive_count;
+
 
 
 /**
@@ -82,22 +87,13 @@ void radio_receive() {
                     case GAMESTATE_PACKET:
                         current_game_state = in_packet.payload.gamestate;
 
-                        // Roomba is in control of their own state.
-                        if((current_game_state.roomba_states[roomba_identity] & FORCED) == 0) {
-                            // If previously not in control, copy from gamestate.
-                            if((roomba_state & FORCED) != 0) {
-                                roomba_state = current_game_state.roomba_states[roomba_identity];
-                            }
-                            // If gamestate does not match your expectations, update the base station.
-                            else if(current_game_state.roomba_states[roomba_identity] != roomba_state) {
-                                // Update your own gamestate and send a packet.
-                                current_game_state.roomba_states[roomba_identity] = roomba_state;
-                                Service_Publish(radio_send_service, roomba_identity);
-                            }
+                        // If gamestate does not match your expectations, update the base station.
+                        if(Game_Sync_Roomba(&current_game_state, roomba_identity, &roomba_state)) {
+                            Service_Publish(radio_send_service, roomba_identity);
                         }
-                        // Just copy your state from the base station.
-                        else {
-                            roomba_state = current_game_state.roomba_states[roomba_identity];
+                        // Otherwise send a telemetry digest if one is due, while the channel is quiet.
+                        else if(Telemetry_Due()) {
+                            Service_Publish(radio_send_service, roomba_identity);
                         }
                         break;
                     default:
@@ -122,7 +118,7 @@ void radio_send() {
     pf_roombastate_t roombastate_command;
     roombastate_command.roomba_id = roomba_identity;
 
-    Radio_Set_Tx_Addr(BASE_ADDRESS);
+    Radio_Set_Tx_Addr_P(BASE_ADDRESS);
 
     for(;;) {
         Service_Subscribe(radio_send_service, &radio_send_service_value);
@@ -131,7 +127,8 @@ void radio_send() {
         roombastate_command.roomba_state = roomba_state;
 
         out_packet.type = ROOMBASTATE_PACKET;
-        memcpy(&out_packet.payload.roombastate, &roombastate_command, sizeof(pf_roombastate_t));
+        memcpy(&out_packet.payload.roombareport.roombastate, &roombastate_command, sizeof(pf_roombastate_t));
+        Telemetry_Fill(&out_packet.payload.roombareport.telemetry);
 
         // Send packet.
         radio_status = Radio_Transmit(&out_packet, RADIO_RETURN_ON_TX);
@@ -164,121 +161,73 @@ void user_input() {
 }
 
 /**
- * Task that reads stored data and makes operation decisions.
+ * System task that makes one decision and sends one drive command per sensor frame.
  */
 void decision_making() {
-    automation_state_t automation_state = STRAIGHT;
-    roomba_automation_data.distance = 0;
-    roomba_automation_data.rotation = 0;
+    static const decision_params_t decision_params_flash FLASH = DECISION_PARAMS_DEFAULT;
+    decision_params_t decision_params;
+    decision_t decision;
+    uint8_t group;
+    uint32_t stamp;
 
-    int rotating = 0;
+    Flash_Read(&decision_params, &decision_params_flash, sizeof(decision_params));
+    Decision_Init(&decision, &roomba_automation_data);
 
     for(;;) {
-        switch(current_game_state.game_state) {
-            case GAME_STARTING:
-                automation_state = STRAIGHT;
-                roomba_controls.turn_radius = 0x8000; // Straight
-                roomba_controls.drive_velocity = 0; //500 max;
-                roomba_controls.shooting = 0;
-                break;
-            case GAME_RUNNING:
-                rotating = 0;
-                // Handle death globally from any state.
-                if((roomba_state & DEAD) != 0) {
-                    automation_state = IS_DEAD;
-                }
-                switch(automation_state) {
-                    // Drive in a straight line for approximately 1 meter.
-                    case STRAIGHT:
-                        roomba_controls.turn_radius = 0x8000; // Straight
-                        roomba_controls.drive_velocity = 300; //500 max;
-                        roomba_controls.shooting = 0;
-                        if(roomba_automation_data.distance > 1000 || (roomba_sensor_data.bumps_wheeldrops & 0x3) > 0 || roomba_sensor_data.light_bumber > 0) {
-                            automation_state = ORBIT;
-                            roomba_automation_data.rotation = 0;
-                            roomba_automation_data.distance = 0;
-                        }
-                        break;
-                    // Rotate 270 degrees clockwise.
-                    case ORBIT:
-                        roomba_controls.drive_velocity = 100;
-                        roomba_controls.turn_radius = 1; // On spot clockwise.
-                        roomba_controls.shooting = 1;
-                        if(roomba_automation_data.rotation <= -260) {
-                            automation_state = STRAIGHT;
-                            roomba_automation_data.rotation = 0;
-                            roomba_automation_data.distance = 0;
-                        }
-                        break;
-                    // Cannot move, stay in place.
-                    case IS_DEAD:
-                        roomba_controls.drive_velocity = 0;
-                        roomba_controls.turn_radius = 0;
-                        roomba_controls.shooting = 0;
-                        if((roomba_state & DEAD) == 0) {
-                            automation_state = IS_REVIVED;
-                            roomba_automation_data.rotation = 0;
-                            roomba_automation_data.distance = 0;
-                        }
-                        break;
-                    // Revent spree! Rotate 720 degrees counter clockwise spamming shoost!
-                    case IS_REVIVED:
-                        roomba_controls.drive_velocity = 250;
-                        roomba_controls.turn_radius = -1; // On spot cclockwise.
-                        roomba_controls.shooting = 1;
-                        if(roomba_automation_data.rotation >= 710) {
-                            automation_state = STRAIGHT;
-                            roomba_automation_data.rotation = 0;
-                            roomba_automation_data.distance = 0;
-                        }
-                }
-                break;
-            case GAME_OVER:
-
-
-                automation_state = STRAIGHT;
-                // Victory dance! (rotate on the spot)
-                if((roomba_state & DEAD) == 0) {
-                    roomba_controls.turn_radius = -1; // Clockwise
-                    roomba_controls.drive_velocity = 200; //500 max;
-                // Loosers corner! (shake head back and forth.)
-                } else {
-                    if(rotating == 0) {
-                        rotating = 1;
-                        roomba_controls.turn_radius = 1; // Clockwise
-                        roomba_controls.drive_velocity = 100;
-                        break;
-                    }
-
-                    if(roomba_automation_data.rotation >= 10) {
-                        roomba_controls.turn_radius = 1; // cClockwise
-                        roomba_controls.drive_velocity = 100;
-                    } else if(roomba_automation_data.rotation <= -10) {
-                        roomba_controls.turn_radius = -1; // Clockwise
-                        roomba_controls.drive_velocity = 100;
-                    }
-                }
-                roomba_controls.shooting = 0;
-                break;
-        }
+        stamp = Channel_Read(sensor_frames, &group);
 
-        Task_Next();
+        Decision_Step(&decision, &decision_params,
+                      current_game_state.game_state, roomba_state,
+                      &roomba_sensor_data, &roomba_automation_data, &roomba_controls);
+
+        // Sends the drive command to the roomba.
+        Roomba_Drive(roomba_controls.drive_velocity, -1*roomba_controls.turn_radius); // 3ms
+
+        drive_latency = OS_Time() - stamp;
+        if(drive_latency > drive_latency_worst) {
+            drive_latency_worst = drive_latency;
+        }
+        ++drive_count;
     }
 }
 
+/**
+ * Shell command: sensor frames driven on, and the last and worst sensor-to-drive latency.
+ */
+void print_drive() {
+    uint8_t sreg = SREG;
+    uint32_t latency, worst;
+    uint16_t count;
+
+    cli();
+    IRQ_PROFILE_DISABLE();
+    latency = drive_latency;
+    worst = drive_latency_worst;
+    count = drive_count;
+    IRQ_PROFILE_RESTORE(sreg);
+    SREG = sreg;
+
+    Shell_Print_P(PSTR("frames  last us  worst us\r\n"));
+    Shell_Print_Number(count, 6);
+    Shell_Print_Number(latency / US_CYCLES, 9);
+    Shell_Print_Number(worst / US_CYCLES, 10);
+    Shell_Print_P(PSTR("\r\n"));
+}
+
 /**
  * Roomba interface task
  */
 void roomba_interface() {
     int m_sensor_stage = 0;
+    uint8_t group;
 
     for(;;) {
         // Updates the sensors structure. Alternates which sensors to check from based on runtime.
         switch(m_sensor_stage) {
             case 0:
+                group = CHASSIS;
                 Roomba_UpdateSensorPacket(CHASSIS, &roomba_sensor_data); // 10.5ms
-                roomba_automation_data.distance += 120;// roomba_sensor_data.distance.value; Doesn't work on our firmware
-                roomba_automation_data.rotation += roomba_sensor_data.angle.value*3;
+                Decision_Update_Odometry(&roomba_automation_data, &roomba_sensor_data);
 
                 // Fire IR
                 if(roomba_controls.shooting != 0) {
@@ -286,9 +235,11 @@ void roomba_interface() {
                 }
                 break;
             case 1:
+                group = EXTERNAL;
                 Roomba_UpdateSensorPacket(EXTERNAL, &roomba_sensor_data); // 17ms
                 break;
             case 2:
+                group = LIGHT_SENSOR;
                 Roomba_UpdateSensorPacket(LIGHT_SENSOR, &roomba_sensor_data); // 25ms
                 break;
             default:
@@ -297,8 +248,8 @@ void roomba_interface() {
         }
         m_sensor_stage = (m_sensor_stage+1) % 3;
 
-        // Sends the drive command to the roomba.
-        Roomba_Drive(roomba_controls.drive_velocity, -1*roomba_controls.turn_radius); // 3ms
+        // Hand the frame to decision_making, which runs and drives before this task goes on.
+        Channel_Write(sensor_frames, &group);
 
         Task_Next();
     }
@@ -309,6 +260,14 @@ void roomba_interface() {
  * Setup function called by the RTOS on initialization.
  */
 int r_main(){
+    // CONFIGURATION
+    roomba_identity = (COPS_AND_ROBBERS)Store_Get(CONFIG_IDENTITY, ROBBER1);
+    if(roomba_identity > ROBBER2) {
+        roomba_identity = ROBBER1;
+    }
+    ir_team = roomba_identity >= ROBBER1 ? ROBBER_CODE : COP_CODE;
+    ir_enemy = roomba_identity >= ROBBER1 ? COP_CODE : ROBBER_CODE;
+
     // RADIO INITIALIZATION
     DDRL |= (1 << PL2);
     PORTL &= ~(1 << PL2);
@@ -316,10 +275,10 @@ int r_main(){
     PORTL |= 1 << PL2;
     _delay_ms(500);
 
-    Radio_Init(BASE_FREQUENCY);
+    Radio_Init((uint8_t)Store_Get(CONFIG_CHANNEL, Flash_Read_Byte(&BASE_FREQUENCY)));
 
     // Configure the receive settings for radio pipe 0
-    Radio_Configure_Rx(RADIO_PIPE_0, ROOMBA_ADDRESSES[roomba_identity], ENABLE);
+    Radio_Configure_Rx_P(RADIO_PIPE_0, ROOMBA_ADDRESSES[roomba_identity], ENABLE);
 
     // Configure radio transceiver settings.
     Radio_Configure(RADIO_1MBPS, RADIO_HIGHEST_POWER);
@@ -337,6 +296,7 @@ int r_main(){
     // RTOS INITIALIZATION
     radio_receive_service = Service_Init();
     radio_send_service = Service_Init();
+    sensor_frames = Channel_Init(sensor_frames_buffer, sizeof(uint8_t), 1, CHANNEL_OVERWRITE);
 
     DefaultPorts();
 
@@ -344,7 +304,9 @@ int r_main(){
     Task_Create_System(radio_send, 0);
     Task_Create_Periodic(roomba_interface, 0, 20, 8, 200);
     Task_Create_RR(user_input, 0);
-    Task_Create_RR(decision_making, 0);
+    Task_Create_System(decision_making, 0);
+    Shell_Init();
+    Shell_Add_Command('d', "drive", print_drive);
 
     return 0;
 }
@@ -364,19 +326,10 @@ void radio_rxhandler(uint8_t pipe_number)
 void ir_rxhandler() {
     uint8_t ir_value = IR_getLast();
 
-    // IR only effects the roomba when state is changable.
-    if((roomba_state & FORCED) == 0) {
-        // Revive if shot by a team member.
-        if (ir_value == ir_team) {
-            PORTB ^= (1 << PB7);
-            roomba_state &= ~DEAD;
-        // Kill if shot by an enemy.
-        } else if (ir_value == ir_enemy) {
-            PORTB ^= (1 << PB7);
-            roomba_state |= DEAD;
-        }
+    // Revive if shot by a team member, kill if shot by an enemy.
+    if(Game_Apply_IR(ir_value, ir_team, ir_enemy, &roomba_state)) {
+        PORTB ^= (1 << PB7);
         _delay_ms(1);
     }
-
 }
 
@@ -5,7 +5,9 @@
  *      Author: nrqm
  */
 
+#include <stddef.h>
 #include <util/delay.h>
+#include "flash.h"
 #include "uart.h"
 #include "roomba.h"
 #include "roomba_sci.h"
@@ -45,79 +47,149 @@ void Roomba_Finish() {
 	Roomba_Send_Byte(STOP);
 }
 
+/// Field flags in a sensor descriptor.  The low bits hold the width of the field in bytes.
+#define SENSOR_FIELD_WIDTH_MASK	0x03
+#define SENSOR_FIELD_SIGNED		0x80
+
+#define U8	1
+#define S8	(1 | SENSOR_FIELD_SIGNED)
+#define U16	2
+#define S16	(2 | SENSOR_FIELD_SIGNED)
+
+/// One field of a sensor packet, in the order the Roomba sends it.
+typedef struct _sensor_field
+{
+	uint8_t offset;		// offset of the field inside roomba_sensor_data_t
+	uint8_t flags;		// width in bytes, and SENSOR_FIELD_SIGNED for signed values
+} sensor_field_t;
+
+/// One sensor packet: the number of bytes the Roomba sends, and where they go.
+typedef struct _sensor_packet
+{
+	uint8_t group;
+	uint8_t length;
+	uint8_t field_count;
+	const sensor_field_t* fields;
+} sensor_packet_t;
+
+#define FIELD(member, flags) { offsetof(roomba_sensor_data_t, member), (flags) }
+
+static const sensor_field_t external_fields[] FLASH = {
+	FIELD(bumps_wheeldrops, U8),
+	FIELD(wall, U8),
+	FIELD(cliff_left, U8),
+	FIELD(cliff_front_left, U8),
+	FIELD(cliff_front_right, U8),
+	FIELD(cliff_right, U8),
+	FIELD(virtual_wall, U8),
+	FIELD(motor_overcurrents, U8),
+	FIELD(dirt_left, U8),
+	FIELD(dirt_right, U8),
+};
+
+static const sensor_field_t chassis_fields[] FLASH = {
+	FIELD(remote_opcode, U8),
+	FIELD(buttons, U8),
+	FIELD(distance, S16),
+	FIELD(angle, S16),
+};
+
+static const sensor_field_t internal_fields[] FLASH = {
+	FIELD(charging_state, U8),
+	FIELD(voltage, U16),
+	FIELD(current, S16),
+	FIELD(temperature, S8),
+	FIELD(charge, U16),
+	FIELD(capacity, U16),
+};
+
+static const sensor_field_t light_sensor_fields[] FLASH = {
+	FIELD(left_encoder_counts, U16),
+	FIELD(right_encoder_counts, U16),
+	FIELD(light_bumber, U8),
+	FIELD(left_light_bumber_signal, U16),
+	FIELD(left_front_light_bumber_signal, U16),
+	FIELD(left_center_light_bumber_signal, U16),
+	FIELD(right_center_light_bumber_signal, U16),
+	FIELD(right_front_light_bumber_signal, U16),
+	FIELD(right_light_bumber_signal, U16),
+	FIELD(left_motor_current, U16),
+	FIELD(right_motor_current, U16),
+	FIELD(main_brush_motor_current, U16),
+	FIELD(side_brush_motor_current, U16),
+};
+
+#define PACKET(group, length, fields) { (group), (length), sizeof(fields) / sizeof(sensor_field_t), (fields) }
+
+static const sensor_packet_t sensor_packets[] FLASH = {
+	PACKET(EXTERNAL, 10, external_fields),
+	PACKET(CHASSIS, 6, chassis_fields),
+	PACKET(INTERNAL, 10, internal_fields),
+	PACKET(LIGHT_SENSOR, 28, light_sensor_fields),
+};
+
+#define SENSOR_PACKET_COUNT (sizeof(sensor_packets) / sizeof(sensor_packet_t))
+
+static const sensor_packet_t* find_sensor_packet(ROOMBA_SENSOR_GROUP group)
+{
+	uint8_t i;
+	for (i = 0; i < SENSOR_PACKET_COUNT; i++)
+	{
+		if (Flash_Read_Byte(&sensor_packets[i].group) == group)
+		{
+			return &sensor_packets[i];
+		}
+	}
+	return NULL;
+}
+
+uint8_t Roomba_SensorPacketLength(ROOMBA_SENSOR_GROUP group)
+{
+	const sensor_packet_t* packet = find_sensor_packet(group);
+	if (packet == NULL)
+	{
+		return 0;
+	}
+	return Flash_Read_Byte(&packet->length);
+}
+
+void Roomba_DecodeSensorPacket(ROOMBA_SENSOR_GROUP group, const volatile uint8_t* data, roomba_sensor_data_t* sensor_packet)
+{
+	const sensor_packet_t* packet = find_sensor_packet(group);
+	const sensor_field_t* field;
+	uint8_t* base = (uint8_t*)sensor_packet;
+	uint8_t* dst;
+	uint8_t count;
+
+	if (packet == NULL)
+	{
+		return;
+	}
+
+	field = (const sensor_field_t*)Flash_Read_Ptr((const void* const*)&packet->fields);
+	count = Flash_Read_Byte(&packet->field_count);
+	for (; count > 0; count--, field++)
+	{
+		dst = base + Flash_Read_Byte(&field->offset);
+		// The Roomba sends 16-bit values high byte first, AVR RAM is little-endian.
+		if ((Flash_Read_Byte(&field->flags) & SENSOR_FIELD_WIDTH_MASK) == 2)
+		{
+			dst[1] = *data++;
+		}
+		dst[0] = *data++;
+	}
+}
+
 void Roomba_UpdateSensorPacket(ROOMBA_SENSOR_GROUP group, roomba_sensor_data_t* sensor_packet)
 {
+	uint8_t length = Roomba_SensorPacketLength(group);
+
 	Roomba_Send_Byte(SENSORS);
 	Roomba_Send_Byte(group);
-	switch(group)
+	if (length != 0)
 	{
-	case EXTERNAL:
-		// environment sensors
-		while (uart_bytes_received() != 10);
-		sensor_packet->bumps_wheeldrops = uart_get_byte(0);
-		sensor_packet->wall = uart_get_byte(1);
-		sensor_packet->cliff_left = uart_get_byte(2);
-		sensor_packet->cliff_front_left = uart_get_byte(3);
-		sensor_packet->cliff_front_right = uart_get_byte(4);
-		sensor_packet->cliff_right = uart_get_byte(5);
-		sensor_packet->virtual_wall = uart_get_byte(6);
-		sensor_packet->motor_overcurrents = uart_get_byte(7);
-		sensor_packet->dirt_left = uart_get_byte(8);
-		sensor_packet->dirt_right = uart_get_byte(9);
-		break;
-	case CHASSIS:
-		// chassis sensors	
-		while (uart_bytes_received() != 6);
-		sensor_packet->remote_opcode = uart_get_byte(0);
-		sensor_packet->buttons = uart_get_byte(1);
-		sensor_packet->distance.bytes.high_byte = uart_get_byte(2);
-		sensor_packet->distance.bytes.low_byte = uart_get_byte(3);
-		sensor_packet->angle.bytes.high_byte = uart_get_byte(4);
-		sensor_packet->angle.bytes.low_byte = uart_get_byte(5);
-		break;
-	case INTERNAL:
-		// internal sensors
-		while (uart_bytes_received() != 10);
-		sensor_packet->charging_state = uart_get_byte(0);
-		sensor_packet->voltage.bytes.high_byte = uart_get_byte(1);
-		sensor_packet->voltage.bytes.low_byte = uart_get_byte(2);
-		sensor_packet->current.bytes.high_byte = uart_get_byte(3);
-		sensor_packet->current.bytes.low_byte = uart_get_byte(4);
-		sensor_packet->temperature = uart_get_byte(5);
-		sensor_packet->charge.bytes.high_byte = uart_get_byte(6);
-		sensor_packet->charge.bytes.low_byte = uart_get_byte(7);
-		sensor_packet->capacity.bytes.high_byte = uart_get_byte(8);
-		sensor_packet->capacity.bytes.low_byte = uart_get_byte(9);
-		break;
-	case LIGHT_SENSOR:
-		// light sensors sensors
-		while (uart_bytes_received() != 28);
-		sensor_packet->left_encoder_counts.bytes.high_byte = uart_get_byte(0);
-		sensor_packet->left_encoder_counts.bytes.low_byte = uart_get_byte(1);
-		sensor_packet->right_encoder_counts.bytes.high_byte = uart_get_byte(2);
-		sensor_packet->right_encoder_counts.bytes.low_byte = uart_get_byte(3);
-		sensor_packet->light_bumber = uart_get_byte(4);
-		sensor_packet->left_light_bumber_signal.bytes.high_byte = uart_get_byte(5);
-		sensor_packet->left_light_bumber_signal.bytes.low_byte = uart_get_byte(6);
-		sensor_packet->left_front_light_bumber_signal.bytes.high_byte = uart_get_byte(7);
-		sensor_packet->left_front_light_bumber_signal.bytes.low_byte = uart_get_byte(8);
-		sensor_packet->left_center_light_bumber_signal.bytes.high_byte = uart_get_byte(9);
-		sensor_packet->left_center_light_bumber_signal.bytes.low_byte = uart_get_byte(10);
-		sensor_packet->right_center_light_bumber_signal.bytes.high_byte = uart_get_byte(11);
-		sensor_packet->right_center_light_bumber_signal.bytes.low_byte = uart_get_byte(12);
-		sensor_packet->right_front_light_bumber_signal.bytes.high_byte = uart_get_byte(13);
-		sensor_packet->right_front_light_bumber_signal.bytes.low_byte = uart_get_byte(14);
-		sensor_packet->right_light_bumber_signal.bytes.high_byte = uart_get_byte(15);
-		sensor_packet->right_light_bumber_signal.bytes.low_byte = uart_get_byte(16);
-		sensor_packet->left_motor_current.bytes.high_byte = uart_get_byte(17);
-		sensor_packet->left_motor_current.bytes.low_byte = uart_get_byte(18);
-		sensor_packet->right_motor_current.bytes.high_byte = uart_get_byte(19);
-		sensor_packet->right_motor_current.bytes.low_byte = uart_get_byte(20);
-		sensor_packet->main_brush_motor_current.bytes.high_byte = uart_get_byte(21);
-		sensor_packet->main_brush_motor_current.bytes.low_byte = uart_get_byte(22);
-		sensor_packet->side_brush_motor_current.bytes.high_byte = uart_get_byte(23);
-		sensor_packet->side_brush_motor_current.bytes.low_byte = uart_get_byte(24);
-		break;
+		while (uart_bytes_received() != length);
+		Roomba_DecodeSensorPacket(group, uart_get_buffer(), sensor_packet);
 	}
 	uart_reset_receive();
 }
@@ -40,6 +40,21 @@ void Roomba_Init();
  */
 void Roomba_UpdateSensorPacket(ROOMBA_SENSOR_GROUP group, roomba_sensor_data_t* sensor_packet);
 
+/**
+ * The number of bytes the Roomba sends in reply to a query for a sensor packet group, or 0 if the group is not supported.
+ */
+uint8_t Roomba_SensorPacketLength(ROOMBA_SENSOR_GROUP group);
+
+/**
+ * Decode the raw bytes of a sensor packet group into a sensor packet structure.  The layout of each group is described
+ * by a descriptor table in flash, so the same decoder serves direct queries, streams and query lists.
+ *
+ * \param group The sensor group the bytes belong to.
+ * \param data The bytes as they were received from the Roomba (16-bit values high byte first).
+ * \param sensor_packet The structure to populate.  Only the data in the decoded group are changed.
+ */
+void Roomba_DecodeSensorPacket(ROOMBA_SENSOR_GROUP group, const volatile uint8_t* data, roomba_sensor_data_t* sensor_packet);
+
 /**
  * Send a drive command to the Roomba.
  *
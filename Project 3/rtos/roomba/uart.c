@@ -1,4 +1,5 @@
 #include "uart.h"
+#include "irq_profile.h"
 
 #define UART_BUFFER_SIZE    32
 
@@ -13,6 +14,7 @@ void Roomba_Send_Byte(uint8_t data_out){
 void Roomba_UART_Init(UART_BPS baud){
 	uint8_t sreg = SREG;
 	cli();
+	IRQ_PROFILE_DISABLE();
 	
 	// Make sure I/O clock to USART1 is enabled
 	PRR1 &= ~(1 << PRUSART1);
@@ -47,6 +49,7 @@ void Roomba_UART_Init(UART_BPS baud){
 	UCSR1A &= ~(1<<U2X1);
 	
 	
+	IRQ_PROFILE_RESTORE(sreg);
 	SREG = sreg;
 }
 
@@ -65,8 +68,15 @@ void uart_reset_receive(void)
  */
 ISR(USART1_RX_vect)
 {
+    IRQ_PROFILE_ISR_ENTER();
     uart_buffer[uart_buffer_index] = UDR1;
     uart_buffer_index = (uart_buffer_index + 1) % UART_BUFFER_SIZE;
+    IRQ_PROFILE_ISR_EXIT();
+}
+
+volatile uint8_t* uart_get_buffer(void)
+{
+	return uart_buffer;
 }
 
 uint8_t uart_get_byte(int index)
@@ -29,5 +29,6 @@ void Roomba_UART_Init(UART_BPS baud);
 uint8_t uart_bytes_received(void);
 void uart_reset_receive(void);
 uint8_t uart_get_byte(int index);
+volatile uint8_t* uart_get_buffer(void);
 
 #endif /* UART_H_ */
\ No newline at end of file
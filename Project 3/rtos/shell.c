@@ -0,0 +1,695 @@
+/**
+ * @file   shell.c
+ *
+ * @brief A "ps" and "top" for a running system, on UART0.  See shell.h.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "shell.h"
+#include "os.h"
+#include "kernel.h"
+#include "store.h"
+#include "irq_profile.h"
+#include "flash.h"
+
+#if SHELL_ENABLE
+
+/** Move the cursor home and clear the screen (VT100). */
+#define CLEAR_SCREEN    "\033[H\033[2J"
+
+/** What the shell's service carries: a key arrived, or it is time to redraw "top". */
+#define EVENT_KEY       0
+#define EVENT_REFRESH   1
+
+/** Bytes the task writes, the UDRE interrupt sends. */
+static volatile uint8_t tx_buffer[SHELL_TX_BUFFER];
+static volatile uint8_t tx_head;
+static volatile uint8_t tx_tail;
+
+/** Bytes the RX interrupt receives, the task reads. */
+static volatile uint8_t rx_buffer[SHELL_RX_BUFFER];
+static volatile uint8_t rx_head;
+static volatile uint8_t rx_tail;
+
+static volatile uint16_t rx_bytes;
+static volatile uint16_t tx_bytes;
+static volatile uint16_t rx_dropped;
+
+/** The shell's task waits here for keys and redraws. */
+static service_t* shell_service;
+static soft_timer_t* refresh_timer;
+
+/** Commands added by the application. */
+typedef struct
+{
+    char key;
+    const char* help;
+    void (*command)(void);
+} command_t;
+
+static command_t commands[SHELL_MAX_COMMANDS];
+static uint8_t command_count;
+
+/** The readings the last tables were printed from. */
+static uint32_t task_time[MAXPROCESS + 1];
+static uint16_t service_publishes[MAXSERVICES];
+static uint16_t service_lost[MAXSERVICES];
+static uint16_t service_wakeups[MAXSERVICES];
+static uint16_t service_time;
+static uint16_t group_used[MAXGROUPS];
+static uint16_t group_depleted[MAXGROUPS];
+
+ISR(USART0_RX_vect)
+{
+    uint8_t data = UDR0;
+    uint8_t next = (rx_head + 1) & (SHELL_RX_BUFFER - 1);
+
+    IRQ_PROFILE_ISR_ENTER();
+    ++rx_bytes;
+    if(next == rx_tail)
+    {
+        ++rx_dropped;
+    }
+    else
+    {
+        rx_buffer[rx_head] = data;
+        rx_head = next;
+        Service_Publish(shell_service, EVENT_KEY);
+    }
+    IRQ_PROFILE_ISR_EXIT();
+}
+
+ISR(USART0_UDRE_vect)
+{
+    IRQ_PROFILE_ISR_ENTER();
+    if(tx_tail == tx_head)
+    {
+        UCSR0B &= ~_BV(UDRIE0);
+    }
+    else
+    {
+        UDR0 = tx_buffer[tx_tail];
+        tx_tail = (tx_tail + 1) & (SHELL_TX_BUFFER - 1);
+        ++tx_bytes;
+    }
+    IRQ_PROFILE_ISR_EXIT();
+}
+
+/**
+ * Queue a byte to send, yielding to other tasks while the buffer is full.
+ */
+static void put_char(char c)
+{
+    uint8_t next = (tx_head + 1) & (SHELL_TX_BUFFER - 1);
+    uint8_t sreg;
+
+    while(next == tx_tail)
+    {
+        Task_Next();
+    }
+    tx_buffer[tx_head] = c;
+
+    sreg = SREG;
+    Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
+    tx_head = next;
+    UCSR0B |= _BV(UDRIE0);
+    IRQ_PROFILE_RESTORE(sreg);
+    SREG = sreg;
+}
+
+static void put_str(const char* s)
+{
+    while(*s != '\0')
+    {
+        put_char(*s++);
+    }
+}
+
+/** Print a string from program memory. */
+static void put_str_P(const char* s)
+{
+    char c;
+
+    while((c = (char)Flash_Read_Byte((const uint8_t*)s++)) != '\0')
+    {
+        put_char(c);
+    }
+}
+
+/**
+ * Print a number right-aligned in width characters.
+ */
+static void put_uint(uint32_t value, uint8_t width)
+{
+    char digits[10];
+    uint8_t count = 0;
+
+    do
+    {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while(value != 0);
+
+    while(width > count)
+    {
+        put_char(' ');
+        --width;
+    }
+    while(count > 0)
+    {
+        put_char(digits[--count]);
+    }
+}
+
+/**
+ * Print a string from program memory left-aligned in width characters.
+ */
+static void put_field(const char* s, uint8_t width)
+{
+    char c;
+
+    while((c = (char)Flash_Read_Byte((const uint8_t*)s++)) != '\0')
+    {
+        put_char(c);
+        if(width > 0)
+        {
+            --width;
+        }
+    }
+    while(width-- > 0)
+    {
+        put_char(' ');
+    }
+}
+
+/**
+ * \return the next key pressed, or -1 if there is none.
+ */
+static int16_t get_key(void)
+{
+    uint8_t key;
+
+    if(rx_tail == rx_head)
+    {
+        return -1;
+    }
+    key = rx_buffer[rx_tail];
+    rx_tail = (rx_tail + 1) & (SHELL_RX_BUFFER - 1);
+    return key;
+}
+
+/**
+ * Wait for the next key pressed, or for the refresh timer.
+ * \return the key, or -1 if the refresh timer expired first.
+ */
+static int16_t wait_key(void)
+{
+    int16_t event = EVENT_KEY;
+    int16_t key;
+    uint8_t sreg;
+
+    /* Look and subscribe with interrupts off, so a key cannot arrive in between. */
+    sreg = SREG;
+    Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
+    while((key = get_key()) < 0 && event != EVENT_REFRESH)
+    {
+        Service_Subscribe(shell_service, &event);
+    }
+    IRQ_PROFILE_RESTORE(sreg);
+    SREG = sreg;
+    return key;
+}
+
+static void refresh_expired(int16_t arg)
+{
+    (void)arg;
+    Service_Publish(shell_service, EVENT_REFRESH);
+}
+
+/**
+ * Redraw "top" every SHELL_REFRESH ms.  \return 0 if there is no timer for it.
+ */
+static uint8_t start_refresh(void)
+{
+    /* Made on the first 't' rather than in Shell_Init(): the timer daemon needs a descriptor,
+     * and by now r_main() has given its own back. */
+    if(refresh_timer == NULL)
+    {
+        refresh_timer = Timer_Init(refresh_expired, 0, SHELL_REFRESH * 1000UL / OS_Tick_Us(), 1);
+        if(refresh_timer == NULL)
+        {
+            return 0;
+        }
+    }
+    Timer_Reset(refresh_timer);
+    return 1;
+}
+
+static void stop_refresh(void)
+{
+    if(refresh_timer != NULL)
+    {
+        Timer_Stop(refresh_timer);
+    }
+}
+
+static const char* level_name(uint8_t level)
+{
+    switch(level)
+    {
+    case SYSTEM: return PSTR("SYSTEM");
+    case PERIODIC: return PSTR("PERIODIC");
+    case RR: return PSTR("RR");
+    default: return PSTR("IDLE");
+    }
+}
+
+static const char* state_name(uint8_t state)
+{
+    switch(state)
+    {
+    case RUNNING: return PSTR("RUNNING");
+    case READY: return PSTR("READY");
+    case WAITING: return PSTR("WAITING");
+    default: return PSTR("DEAD");
+    }
+}
+
+/**
+ * \return part as a percentage of whole, which is not 0.
+ */
+static uint8_t percent(uint32_t part, uint32_t whole)
+{
+    /* Keep part * 100 within 32 bits. */
+    while(whole > 0x00FFFFFF)
+    {
+        whole >>= 8;
+        part >>= 8;
+    }
+    return part * 100 / whole;
+}
+
+/**
+ * Print the tasks, and the CPU load if load is set.
+ */
+static void print_tasks(uint8_t load)
+{
+    task_info_t info[MAXPROCESS + 1];
+    uint32_t elapsed = 0;
+    uint8_t i;
+
+    /* Read everything first, so the shares add up. */
+    for(i = 0; i <= MAXPROCESS; ++i)
+    {
+        OS_Task_Info(i, &info[i]);
+        info[i].run_time -= task_time[i];
+        task_time[i] += info[i].run_time;
+        elapsed += info[i].run_time;
+    }
+
+    if(load)
+    {
+        put_str_P(PSTR("load "));
+        if(elapsed == 0)
+        {
+            put_str_P(PSTR("  -"));
+        }
+        else
+        {
+            put_uint(100 - percent(info[MAXPROCESS].run_time, elapsed), 3);
+        }
+        put_str_P(PSTR("%  uptime "));
+        put_uint(Store_Get(STORE_KEY_UPTIME, 0), 1);
+        put_str_P(PSTR(" s  boots "));
+        put_uint(Store_Get(STORE_KEY_BOOTS, 0), 1);
+        put_str_P(PSTR("\r\n\r\n"));
+    }
+
+    put_str_P(PSTR("task  level     state     cpu%  stack\r\n"));
+    for(i = 0; i < MAXPROCESS; ++i)
+    {
+        if(info[i].state == DEAD)
+        {
+            continue;
+        }
+        put_uint(i, 4);
+        put_str_P(PSTR("  "));
+        put_field(level_name(info[i].level), 10);
+        put_field(state_name(info[i].state), 9);
+        if(elapsed == 0)
+        {
+            put_str_P(PSTR("   -"));
+        }
+        else
+        {
+            put_uint(percent(info[i].run_time, elapsed), 4);
+        }
+        put_uint(MAXSTACK - info[i].stack_free, 7);
+        put_char('/');
+        put_uint(MAXSTACK, 1);
+        put_str_P(PSTR("\r\n"));
+    }
+}
+
+static void print_services(void)
+{
+    service_info_t info;
+    uint16_t now = Now();
+    uint16_t elapsed = now - service_time;
+    uint8_t i;
+
+    put_str_P(PSTR("service  waiting  published/s   lost  woken  most  worst us\r\n"));
+    for(i = 0; OS_Service_Info(i, &info); ++i)
+    {
+        put_uint(i, 7);
+        put_uint(info.subscribers, 9);
+        if(elapsed == 0)
+        {
+            put_str_P(PSTR("            -"));
+        }
+        else
+        {
+            put_uint((uint32_t)(uint16_t)(info.publishes - service_publishes[i]) * 1000 / elapsed, 13);
+        }
+        put_uint((uint16_t)(info.lost - service_lost[i]), 7);
+        put_uint((uint16_t)(info.wakeups - service_wakeups[i]), 7);
+        put_uint(info.max_subscribers, 6);
+        put_uint(info.worst_latency, 10);
+        put_str_P(PSTR("\r\n"));
+        service_publishes[i] = info.publishes;
+        service_lost[i] = info.lost;
+        service_wakeups[i] = info.wakeups;
+    }
+    service_time = now;
+}
+
+static void print_groups(void)
+{
+    group_info_t info;
+    uint8_t i;
+
+    put_str_P(PSTR("group  budget/period  left  used  depleted\r\n"));
+    for(i = 1; OS_Group_Info(i, &info); ++i)
+    {
+        put_uint(i, 5);
+        put_uint(info.budget, 8);
+        put_char('/');
+        put_uint(info.period, 6);
+        put_uint(info.remaining, 6);
+        put_uint((uint16_t)(info.used - group_used[i - 1]), 6);
+        put_uint((uint16_t)(info.depleted - group_depleted[i - 1]), 10);
+        put_str_P(PSTR("\r\n"));
+        group_used[i - 1] = info.used;
+        group_depleted[i - 1] = info.depleted;
+    }
+}
+
+static void print_io(void)
+{
+    put_str_P(PSTR("radio  sent "));
+    put_uint(Store_Get(STORE_KEY_RADIO_TX, 0), 1);
+    put_str_P(PSTR("  dropped "));
+    put_uint(Store_Get(STORE_KEY_RADIO_TX_FAILED, 0), 1);
+    put_str_P(PSTR("  received "));
+    put_uint(Store_Get(STORE_KEY_RADIO_RX, 0), 1);
+    put_str_P(PSTR("\r\nuart0  sent "));
+    put_uint(tx_bytes, 1);
+    put_str_P(PSTR("  received "));
+    put_uint(rx_bytes, 1);
+    put_str_P(PSTR("  dropped "));
+    put_uint(rx_dropped, 1);
+    put_str_P(PSTR("\r\n"));
+}
+
+/**
+ * Read a number typed in decimal and ended with Enter, echoing it.
+ * \return 0 if anything else was typed.
+ */
+static uint8_t get_number(int32_t* value)
+{
+    uint8_t negative = 0;
+    uint8_t digits = 0;
+    int16_t key;
+
+    *value = 0;
+    for(;;)
+    {
+        key = wait_key();
+        if(key >= '0' && key <= '9' && digits < 9)
+        {
+            *value = *value * 10 + (key - '0');
+            ++digits;
+        }
+        else if(key == '-' && digits == 0 && !negative)
+        {
+            negative = 1;
+        }
+        else if(key == '\r' && digits > 0)
+        {
+            put_str_P(PSTR("\r\n"));
+            if(negative)
+            {
+                *value = -*value;
+            }
+            return 1;
+        }
+        else
+        {
+            put_str_P(PSTR("\r\n"));
+            return 0;
+        }
+        put_char((char)key);
+    }
+}
+
+/**
+ * Set a store key, such as the settings that tell one board from another, from a key and a
+ * value typed in decimal.
+ */
+static void set_key(void)
+{
+    int32_t key;
+    int32_t value;
+
+    put_str_P(PSTR("key "));
+    if(!get_number(&key))
+    {
+        return;
+    }
+    put_str_P(PSTR("value "));
+    if(!get_number(&value))
+    {
+        return;
+    }
+
+    if(key < 0 || key > STORE_KEY_MAX || !Store_Set((uint8_t)key, value))
+    {
+        put_str_P(PSTR("not set\r\n"));
+        return;
+    }
+    Store_Flush();
+    put_str_P(PSTR("set; settings read at boot take effect after a reset\r\n"));
+}
+
+#if IRQ_PROFILE
+/**
+ * The longest windows with interrupts disabled, then start measuring afresh.
+ */
+static void print_windows(void)
+{
+    irq_window_t windows[IRQ_PROFILE_TOP];
+    uint8_t count = Irq_Profile_Read(windows);
+    uint8_t i;
+
+    Irq_Profile_Clear();
+    put_str_P(PSTR("    us  count  where\r\n"));
+    for(i = 0; i < count; ++i)
+    {
+        put_uint(windows[i].length / 2, 6);
+        put_uint(windows[i].count, 7);
+        put_str_P(PSTR("  "));
+        put_str_P(windows[i].file);
+        put_char(':');
+        put_uint(windows[i].line, 1);
+        put_str_P(PSTR("\r\n"));
+    }
+}
+#endif
+
+static void print_top(void)
+{
+    put_str_P(PSTR(CLEAR_SCREEN));
+    print_tasks(1);
+    put_str_P(PSTR("\r\n"));
+    print_services();
+    put_str_P(PSTR("\r\n"));
+    print_io();
+}
+
+static void print_help(void)
+{
+    uint8_t i;
+
+    put_str_P(PSTR("t top, p tasks, s services, g groups, i I/O, c set a key"));
+#if IRQ_PROFILE
+    put_str_P(PSTR(", w interrupts off"));
+#endif
+    for(i = 0; i < command_count; ++i)
+    {
+        put_str_P(PSTR(", "));
+        put_char(commands[i].key);
+        put_char(' ');
+        put_str(commands[i].help);
+    }
+    put_str_P(PSTR(", h help\r\n"));
+}
+
+/**
+ * Run the command added for key.  Returns 0 if there is none.
+ */
+static uint8_t run_command(int16_t key)
+{
+    uint8_t i;
+
+    for(i = 0; i < command_count; ++i)
+    {
+        if(commands[i].key == key)
+        {
+            commands[i].command();
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void shell_task(void)
+{
+    uint8_t top = 0;
+    int16_t key;
+
+    print_help();
+    for(;;)
+    {
+        key = wait_key();
+        if(key >= 0)
+        {
+            top = 0;
+            stop_refresh();
+            switch(key)
+            {
+            case 't':
+                top = start_refresh();
+                print_top();
+                break;
+            case 'p':
+                print_tasks(0);
+                break;
+            case 's':
+                print_services();
+                break;
+            case 'g':
+                print_groups();
+                break;
+            case 'i':
+                print_io();
+                break;
+            case 'c':
+                set_key();
+                break;
+#if IRQ_PROFILE
+            case 'w':
+                print_windows();
+                break;
+#endif
+            default:
+                if(!run_command(key))
+                {
+                    print_help();
+                }
+                break;
+            }
+        }
+        else if(top)
+        {
+            print_top();
+        }
+    }
+}
+
+int8_t Shell_Init(void)
+{
+    shell_service = Service_Init();
+
+    /* 8 data bits, 1 stop bit, no parity, double speed for a closer baud rate. */
+    UCSR0A = _BV(U2X0);
+    UBRR0 = (F_CPU / 8 + SHELL_BAUD / 2) / SHELL_BAUD - 1;
+    UCSR0C = _BV(UCSZ01) | _BV(UCSZ00);
+    UCSR0B = _BV(RXEN0) | _BV(TXEN0) | _BV(RXCIE0);
+
+    service_time = Now();
+    return Task_Create_RR(shell_task, 0);
+}
+
+uint8_t Shell_Add_Command(char key, const char* help, void (*command)(void))
+{
+    if(command_count >= SHELL_MAX_COMMANDS)
+    {
+        return 0;
+    }
+    commands[command_count].key = key;
+    commands[command_count].help = help;
+    commands[command_count].command = command;
+    ++command_count;
+    return 1;
+}
+
+void Shell_Print(const char* s)
+{
+    put_str(s);
+}
+
+void Shell_Print_P(const char* s)
+{
+    put_str_P(s);
+}
+
+void Shell_Print_Number(uint32_t value, uint8_t width)
+{
+    put_uint(value, width);
+}
+
+#else
+
+int8_t Shell_Init(void)
+{
+    return 0;
+}
+
+uint8_t Shell_Add_Command(char key, const char* help, void (*command)(void))
+{
+    (void)key;
+    (void)help;
+    (void)command;
+    return 0;
+}
+
+void Shell_Print(const char* s)
+{
+    (void)s;
+}
+
+void Shell_Print_P(const char* s)
+{
+    (void)s;
+}
+
+void Shell_Print_Number(uint32_t value, uint8_t width)
+{
+    (void)value;
+    (void)width;
+}
+
+#endif
@@ -0,0 +1,80 @@
+/**
+ * @file   shell.h
+ *
+ * @brief A "ps" and "top" for a running system, on UART0.
+ *
+ * Shell_Init() starts UART0 and creates an RR task that answers single key commands:
+ *
+ *   t  top: load, tasks, services and I/O, redrawn every SHELL_REFRESH ms until the next key
+ *   p  the tasks: level, state, share of the CPU and stack used
+ *   s  the services: tasks waiting, publishes per second, publishes no task was waiting for,
+ *      tasks woken, and since OS_Init() the most tasks waiting and the worst time from a
+ *      publish to running a task it woke
+ *   g  the RR reservation groups: budget, TICKs left this period, TICKs used and periods
+ *      the budget ran out
+ *   i  I/O: radio packets (from the store) and bytes through the shell's UART
+ *   c  set a store key: asks for the key and the value, in decimal, each ended with Enter.
+ *      This is how a board is given the settings that tell it from the others.
+ *   w  the longest windows with interrupts disabled, when built with IRQ_PROFILE (irq_profile.h)
+ *   h  help
+ *
+ * Applications can add their own commands with Shell_Add_Command().
+ *
+ * Shares, rates and counts are over the time since the same table was last printed.
+ *
+ * The shell's task waits on a service, published by the receive interrupt for each key and,
+ * while "top" is up, by a software timer every SHELL_REFRESH ms.  It is READY only while it
+ * answers a key or redraws, so otherwise it takes nothing from the other RR tasks or from the
+ * idle task, and the load "top" shows is the load of the application.  The first 't' makes
+ * the timer, and with it the timer daemon, so "top" needs a free task descriptor.
+ *
+ * All the formatting is done by the shell's RR task, so it never delays a SYSTEM or PERIODIC
+ * task, but it does share the CPU with the RR tasks while it prints.  The UART interrupts only
+ * move one byte between a buffer and the UART, and the task yields whenever the transmit
+ * buffer is full, so turning the shell on does not change when PERIODIC tasks run.
+ */
+
+#ifndef SHELL_H_
+#define SHELL_H_
+
+#include <stdint.h>
+
+/** Set to 0 to leave UART0 alone; Shell_Init() then creates no task. */
+#define SHELL_ENABLE        1
+
+#define SHELL_BAUD          57600
+
+/** Milliseconds between redraws of "top". */
+#define SHELL_REFRESH       1000
+
+/** Buffer sizes in bytes, each a power of 2. */
+#define SHELL_TX_BUFFER     128
+#define SHELL_RX_BUFFER     8
+
+/** Number of commands applications can add. */
+#define SHELL_MAX_COMMANDS  2
+
+/**
+ * Start UART0 and create the shell's RR task.  Call from r_main().
+ * \return 0 if the task could not be created; otherwise non-zero.
+ */
+int8_t Shell_Init(void);
+
+/**
+ * Run command, in the shell's task, when key is pressed.  It prints with Shell_Print(),
+ * Shell_Print_P() and Shell_Print_Number().
+ * \param help a few words for the help line
+ * \return 0 if there is no room for another command; otherwise non-zero.
+ */
+uint8_t Shell_Add_Command(char key, const char* help, void (*command)(void));
+
+/** Print a string.  Only for the shell's task. */
+void Shell_Print(const char* s);
+
+/** Print a string from program memory, such as a PSTR().  Only for the shell's task. */
+void Shell_Print_P(const char* s);
+
+/** Print a number right-aligned in width characters.  Only for the shell's task. */
+void Shell_Print_Number(uint32_t value, uint8_t width);
+
+#endif /* SHELL_H_ */
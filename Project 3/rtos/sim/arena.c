@@ -0,0 +1,818 @@
+/*
+ * arena.c
+ *
+ * Simulated cops and robbers arena.
+ *
+ * Each step integrates every pose with the selected kernel, pushes overlapping neighbours apart
+ * using the bins of the previous step, and then rebins the robots for the sensor and IR queries.
+ * The neighbours in a run of bin slots are tested a vector at a time, for the pushes and for the
+ * light bumper probes.
+ * Headings are unit vectors turned by a short series for the rotation of one step and
+ * renormalised, so the kernels need no sin/cos.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ARENA_X86 1
+#include <immintrin.h>
+#else
+#define ARENA_X86 0
+#endif
+
+/* Bits in the Bumps/Wheeldrops byte, as in roomba_sci.h */
+#define BUMP_LEFT           1
+#define BUMP_RIGHT          0
+
+/* A contact is on the left (right) bumper unless it is more than this far right (left) of centre. */
+#define BUMP_SIDE_SIN       0.29552f    /* sin(0.3) */
+
+/* Light bumper sensors, from the left to the right of the bumper: at 1.05, 0.52, 0.17, -0.17,
+ * -0.52 and -1.05 rad from the heading. */
+static const float light_bumper_cos[6] = {
+    0.497571081f, 0.86781919f, 0.985584795f, 0.985584795f, 0.86781919f, 0.497571081f
+};
+static const float light_bumper_sin[6] = {
+    0.867423177f, 0.496880114f, 0.169182345f, -0.169182345f, -0.496880114f, -0.867423177f
+};
+
+/* Tests up to ARENA_LANES binned robots, from bin slot begin, for being within sqrt(r2) of (px, py). */
+typedef unsigned (*near_kernel_t)(const arena_t* arena, uint32_t begin, uint32_t count, float px, float py, float r2);
+
+/* ==== Helpers ==== */
+
+static void* alloc_lanes(uint32_t capacity, size_t size) {
+    size_t bytes = ((capacity * size + 31) / 32) * 32;
+    void* p = aligned_alloc(32, bytes);
+    if(p) memset(p, 0, bytes);
+    return p;
+}
+
+static uint32_t clamp_bin(float v, uint32_t bins) {
+    int32_t b = (int32_t)(v * (1.0f / ARENA_BIN_SIZE));
+    if(b < 0) return 0;
+    if((uint32_t)b >= bins) return bins - 1;
+    return (uint32_t)b;
+}
+
+/**
+ * Latch a bump if a contact in direction (dx, dy) is on the front half of the robot.
+ */
+static void bump(arena_t* arena, uint32_t i, float dx, float dy) {
+    float c = arena->heading_cos[i];
+    float s = arena->heading_sin[i];
+    float length = sqrtf(dx * dx + dy * dy);
+    float ahead, side;
+
+    if(length == 0) {
+        return;
+    }
+    ahead = (c * dx + s * dy) / length;
+    side = (c * dy - s * dx) / length;
+    if(ahead < 0) {
+        return;
+    }
+    if(side > -BUMP_SIDE_SIN) arena->bumps[i] |= (1 << BUMP_LEFT);
+    if(side < BUMP_SIDE_SIN) arena->bumps[i] |= (1 << BUMP_RIGHT);
+}
+
+#if ARENA_X86
+
+/**
+ * Latch the wall bumps of the lanes set in each mask, for the SIMD kernels.
+ */
+static void wall_bumps(arena_t* arena, uint32_t base, unsigned left, unsigned bottom, unsigned right, unsigned top) {
+    while(left) { bump(arena, base + __builtin_ctz(left), -1, 0); left &= left - 1; }
+    while(bottom) { bump(arena, base + __builtin_ctz(bottom), 0, -1); bottom &= bottom - 1; }
+    while(right) { bump(arena, base + __builtin_ctz(right), 1, 0); right &= right - 1; }
+    while(top) { bump(arena, base + __builtin_ctz(top), 0, 1); top &= top - 1; }
+}
+
+#endif /* ARENA_X86 */
+
+/* ==== Pose integration kernels ==== */
+
+static void integrate_scalar(arena_t* arena, float dt) {
+    const float lo = ROBOT_RADIUS;
+    const float hi_x = arena->width - ROBOT_RADIUS;
+    const float hi_y = arena->height - ROBOT_RADIUS;
+    uint32_t i;
+
+    for(i = 0; i < arena->count; i++) {
+        float c = arena->heading_cos[i];
+        float s = arena->heading_sin[i];
+        float v = arena->speed[i] * dt;
+        float a = arena->omega[i] * dt;
+        float a2 = a * a;
+        float ca = 1 - a2 * (0.5f - a2 * (1.0f / 24));
+        float sa = a * (1 - a2 * (1.0f / 6));
+        float nc = c * ca - s * sa;
+        float ns = s * ca + c * sa;
+        float k = 1.5f - 0.5f * (nc * nc + ns * ns);
+
+        arena->x[i] += v * c;
+        arena->y[i] += v * s;
+        arena->heading_cos[i] = nc * k;
+        arena->heading_sin[i] = ns * k;
+        arena->turned[i] += a;
+
+        if(arena->x[i] < lo) { arena->x[i] = lo; bump(arena, i, -1, 0); }
+        if(arena->y[i] < lo) { arena->y[i] = lo; bump(arena, i, 0, -1); }
+        if(arena->x[i] > hi_x) { arena->x[i] = hi_x; bump(arena, i, 1, 0); }
+        if(arena->y[i] > hi_y) { arena->y[i] = hi_y; bump(arena, i, 0, 1); }
+    }
+}
+
+#if ARENA_X86
+
+__attribute__((target("sse")))
+static void integrate_sse(arena_t* arena, float dt) {
+    const __m128 vdt = _mm_set1_ps(dt);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 sixth = _mm_set1_ps(1.0f / 6);
+    const __m128 twentyfourth = _mm_set1_ps(1.0f / 24);
+    const __m128 three_halves = _mm_set1_ps(1.5f);
+    const __m128 lo = _mm_set1_ps(ROBOT_RADIUS);
+    const __m128 hi_x = _mm_set1_ps(arena->width - ROBOT_RADIUS);
+    const __m128 hi_y = _mm_set1_ps(arena->height - ROBOT_RADIUS);
+    uint32_t i;
+
+    for(i = 0; i < arena->count; i += 4) {
+        __m128 c = _mm_load_ps(&arena->heading_cos[i]);
+        __m128 s = _mm_load_ps(&arena->heading_sin[i]);
+        __m128 v = _mm_mul_ps(_mm_load_ps(&arena->speed[i]), vdt);
+        __m128 a = _mm_mul_ps(_mm_load_ps(&arena->omega[i]), vdt);
+        __m128 a2 = _mm_mul_ps(a, a);
+        __m128 ca = _mm_sub_ps(one, _mm_mul_ps(a2, _mm_sub_ps(half, _mm_mul_ps(a2, twentyfourth))));
+        __m128 sa = _mm_mul_ps(a, _mm_sub_ps(one, _mm_mul_ps(a2, sixth)));
+        __m128 nc = _mm_sub_ps(_mm_mul_ps(c, ca), _mm_mul_ps(s, sa));
+        __m128 ns = _mm_add_ps(_mm_mul_ps(s, ca), _mm_mul_ps(c, sa));
+        __m128 k = _mm_sub_ps(three_halves, _mm_mul_ps(half, _mm_add_ps(_mm_mul_ps(nc, nc), _mm_mul_ps(ns, ns))));
+        __m128 x = _mm_add_ps(_mm_load_ps(&arena->x[i]), _mm_mul_ps(v, c));
+        __m128 y = _mm_add_ps(_mm_load_ps(&arena->y[i]), _mm_mul_ps(v, s));
+
+        _mm_store_ps(&arena->heading_cos[i], _mm_mul_ps(nc, k));
+        _mm_store_ps(&arena->heading_sin[i], _mm_mul_ps(ns, k));
+        _mm_store_ps(&arena->turned[i], _mm_add_ps(_mm_load_ps(&arena->turned[i]), a));
+        _mm_store_ps(&arena->x[i], _mm_min_ps(_mm_max_ps(x, lo), hi_x));
+        _mm_store_ps(&arena->y[i], _mm_min_ps(_mm_max_ps(y, lo), hi_y));
+
+        wall_bumps(arena, i,
+                   _mm_movemask_ps(_mm_cmplt_ps(x, lo)), _mm_movemask_ps(_mm_cmplt_ps(y, lo)),
+                   _mm_movemask_ps(_mm_cmpgt_ps(x, hi_x)), _mm_movemask_ps(_mm_cmpgt_ps(y, hi_y)));
+    }
+}
+
+__attribute__((target("avx")))
+static void integrate_avx(arena_t* arena, float dt) {
+    const __m256 vdt = _mm256_set1_ps(dt);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 sixth = _mm256_set1_ps(1.0f / 6);
+    const __m256 twentyfourth = _mm256_set1_ps(1.0f / 24);
+    const __m256 three_halves = _mm256_set1_ps(1.5f);
+    const __m256 lo = _mm256_set1_ps(ROBOT_RADIUS);
+    const __m256 hi_x = _mm256_set1_ps(arena->width - ROBOT_RADIUS);
+    const __m256 hi_y = _mm256_set1_ps(arena->height - ROBOT_RADIUS);
+    uint32_t i;
+
+    for(i = 0; i < arena->count; i += 8) {
+        __m256 c = _mm256_load_ps(&arena->heading_cos[i]);
+        __m256 s = _mm256_load_ps(&arena->heading_sin[i]);
+        __m256 v = _mm256_mul_ps(_mm256_load_ps(&arena->speed[i]), vdt);
+        __m256 a = _mm256_mul_ps(_mm256_load_ps(&arena->omega[i]), vdt);
+        __m256 a2 = _mm256_mul_ps(a, a);
+        __m256 ca = _mm256_sub_ps(one, _mm256_mul_ps(a2, _mm256_sub_ps(half, _mm256_mul_ps(a2, twentyfourth))));
+        __m256 sa = _mm256_mul_ps(a, _mm256_sub_ps(one, _mm256_mul_ps(a2, sixth)));
+        __m256 nc = _mm256_sub_ps(_mm256_mul_ps(c, ca), _mm256_mul_ps(s, sa));
+        __m256 ns = _mm256_add_ps(_mm256_mul_ps(s, ca), _mm256_mul_ps(c, sa));
+        __m256 k = _mm256_sub_ps(three_halves, _mm256_mul_ps(half, _mm256_add_ps(_mm256_mul_ps(nc, nc), _mm256_mul_ps(ns, ns))));
+        __m256 x = _mm256_add_ps(_mm256_load_ps(&arena->x[i]), _mm256_mul_ps(v, c));
+        __m256 y = _mm256_add_ps(_mm256_load_ps(&arena->y[i]), _mm256_mul_ps(v, s));
+
+        _mm256_store_ps(&arena->heading_cos[i], _mm256_mul_ps(nc, k));
+        _mm256_store_ps(&arena->heading_sin[i], _mm256_mul_ps(ns, k));
+        _mm256_store_ps(&arena->turned[i], _mm256_add_ps(_mm256_load_ps(&arena->turned[i]), a));
+        _mm256_store_ps(&arena->x[i], _mm256_min_ps(_mm256_max_ps(x, lo), hi_x));
+        _mm256_store_ps(&arena->y[i], _mm256_min_ps(_mm256_max_ps(y, lo), hi_y));
+
+        wall_bumps(arena, i,
+                   _mm256_movemask_ps(_mm256_cmp_ps(x, lo, _CMP_LT_OQ)), _mm256_movemask_ps(_mm256_cmp_ps(y, lo, _CMP_LT_OQ)),
+                   _mm256_movemask_ps(_mm256_cmp_ps(x, hi_x, _CMP_GT_OQ)), _mm256_movemask_ps(_mm256_cmp_ps(y, hi_y, _CMP_GT_OQ)));
+    }
+}
+
+#endif /* ARENA_X86 */
+
+/* ==== Beam cone kernels ==== */
+
+/*
+ * Mark the candidates inside the beam of a robot at (sx, sy) facing (c, s): closer than
+ * IR_RANGE, in front, and within IR_HALF_ANGLE of the heading.  count is padded to the lanes.
+ */
+
+static void cone_scalar(arena_t* arena, uint32_t count, float sx, float sy, float c, float s) {
+    const float range2 = IR_RANGE * IR_RANGE;
+    const float cos2 = cosf(IR_HALF_ANGLE) * cosf(IR_HALF_ANGLE);
+    uint32_t k;
+
+    for(k = 0; k < count; k++) {
+        float dx = arena->candidate_x[k] - sx;
+        float dy = arena->candidate_y[k] - sy;
+        float d2 = dx * dx + dy * dy;
+        float ahead = dx * c + dy * s;
+        arena->candidate_hit[k] = d2 <= range2 && ahead > 0 && ahead * ahead >= cos2 * d2;
+    }
+}
+
+#if ARENA_X86
+
+__attribute__((target("sse")))
+static void cone_sse(arena_t* arena, uint32_t count, float sx, float sy, float c, float s) {
+    const __m128 range2 = _mm_set1_ps(IR_RANGE * IR_RANGE);
+    const __m128 cos2 = _mm_set1_ps(cosf(IR_HALF_ANGLE) * cosf(IR_HALF_ANGLE));
+    const __m128 vsx = _mm_set1_ps(sx), vsy = _mm_set1_ps(sy);
+    const __m128 vc = _mm_set1_ps(c), vs = _mm_set1_ps(s);
+    const __m128 zero = _mm_setzero_ps();
+    uint32_t k, lane;
+
+    for(k = 0; k < count; k += 4) {
+        __m128 dx = _mm_sub_ps(_mm_load_ps(&arena->candidate_x[k]), vsx);
+        __m128 dy = _mm_sub_ps(_mm_load_ps(&arena->candidate_y[k]), vsy);
+        __m128 d2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        __m128 ahead = _mm_add_ps(_mm_mul_ps(dx, vc), _mm_mul_ps(dy, vs));
+        __m128 in = _mm_and_ps(_mm_and_ps(_mm_cmple_ps(d2, range2), _mm_cmpgt_ps(ahead, zero)),
+                               _mm_cmpge_ps(_mm_mul_ps(ahead, ahead), _mm_mul_ps(cos2, d2)));
+        int mask = _mm_movemask_ps(in);
+        for(lane = 0; lane < 4; lane++) {
+            arena->candidate_hit[k + lane] = (mask >> lane) & 1;
+        }
+    }
+}
+
+__attribute__((target("avx")))
+static void cone_avx(arena_t* arena, uint32_t count, float sx, float sy, float c, float s) {
+    const __m256 range2 = _mm256_set1_ps(IR_RANGE * IR_RANGE);
+    const __m256 cos2 = _mm256_set1_ps(cosf(IR_HALF_ANGLE) * cosf(IR_HALF_ANGLE));
+    const __m256 vsx = _mm256_set1_ps(sx), vsy = _mm256_set1_ps(sy);
+    const __m256 vc = _mm256_set1_ps(c), vs = _mm256_set1_ps(s);
+    const __m256 zero = _mm256_setzero_ps();
+    uint32_t k, lane;
+
+    for(k = 0; k < count; k += 8) {
+        __m256 dx = _mm256_sub_ps(_mm256_load_ps(&arena->candidate_x[k]), vsx);
+        __m256 dy = _mm256_sub_ps(_mm256_load_ps(&arena->candidate_y[k]), vsy);
+        __m256 d2 = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+        __m256 ahead = _mm256_add_ps(_mm256_mul_ps(dx, vc), _mm256_mul_ps(dy, vs));
+        __m256 in = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(d2, range2, _CMP_LE_OQ), _mm256_cmp_ps(ahead, zero, _CMP_GT_OQ)),
+                                  _mm256_cmp_ps(_mm256_mul_ps(ahead, ahead), _mm256_mul_ps(cos2, d2), _CMP_GE_OQ));
+        int mask = _mm256_movemask_ps(in);
+        for(lane = 0; lane < 8; lane++) {
+            arena->candidate_hit[k + lane] = (mask >> lane) & 1;
+        }
+    }
+}
+
+#endif /* ARENA_X86 */
+
+/* ==== Neighbour kernels ==== */
+
+/*
+ * Return a mask of the count (at most ARENA_LANES) binned robots from slot begin that are
+ * closer than sqrt(r2) to (px, py).  The bin arrays are padded so a whole vector can be read.
+ */
+
+static unsigned near_scalar(const arena_t* arena, uint32_t begin, uint32_t count, float px, float py, float r2) {
+    unsigned mask = 0;
+    uint32_t k;
+
+    for(k = 0; k < count; k++) {
+        float dx = arena->bin_x[begin + k] - px;
+        float dy = arena->bin_y[begin + k] - py;
+        if(dx * dx + dy * dy < r2) mask |= 1u << k;
+    }
+    return mask;
+}
+
+#if ARENA_X86
+
+__attribute__((target("sse")))
+static unsigned near_sse(const arena_t* arena, uint32_t begin, uint32_t count, float px, float py, float r2) {
+    const __m128 vpx = _mm_set1_ps(px), vpy = _mm_set1_ps(py);
+    const __m128 vr2 = _mm_set1_ps(r2);
+    __m128 dx = _mm_sub_ps(_mm_loadu_ps(&arena->bin_x[begin]), vpx);
+    __m128 dy = _mm_sub_ps(_mm_loadu_ps(&arena->bin_y[begin]), vpy);
+    unsigned mask = _mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), vr2));
+
+    if(count > 4) {
+        dx = _mm_sub_ps(_mm_loadu_ps(&arena->bin_x[begin + 4]), vpx);
+        dy = _mm_sub_ps(_mm_loadu_ps(&arena->bin_y[begin + 4]), vpy);
+        mask |= _mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), vr2)) << 4;
+    }
+    return mask & ((1u << count) - 1);
+}
+
+__attribute__((target("avx")))
+static unsigned near_avx(const arena_t* arena, uint32_t begin, uint32_t count, float px, float py, float r2) {
+    __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(&arena->bin_x[begin]), _mm256_set1_ps(px));
+    __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(&arena->bin_y[begin]), _mm256_set1_ps(py));
+    __m256 d2 = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+    unsigned mask = _mm256_movemask_ps(_mm256_cmp_ps(d2, _mm256_set1_ps(r2), _CMP_LT_OQ));
+
+    return mask & ((1u << count) - 1);
+}
+
+#endif /* ARENA_X86 */
+
+/* ==== Binning ==== */
+
+static void rebuild_bins(arena_t* arena) {
+    uint32_t bins = arena->bins_x * arena->bins_y;
+    uint32_t i, b;
+
+    memset(arena->bin_start, 0, (bins + 1) * sizeof(uint32_t));
+    for(i = 0; i < arena->count; i++) {
+        b = clamp_bin(arena->y[i], arena->bins_y) * arena->bins_x + clamp_bin(arena->x[i], arena->bins_x);
+        arena->bin_of[i] = b;
+        arena->bin_start[b]++;
+    }
+    /* bin_start[b] becomes the end of bin b, then counts back down to its start. */
+    for(b = 1; b < bins; b++) {
+        arena->bin_start[b] += arena->bin_start[b - 1];
+    }
+    arena->bin_start[bins] = arena->count;
+    for(i = arena->count; i-- > 0;) {
+        uint32_t n = --arena->bin_start[arena->bin_of[i]];
+        arena->bin_items[n] = i;
+        arena->bin_x[n] = arena->x[i];
+        arena->bin_y[n] = arena->y[i];
+    }
+    arena->bins_stale = 0;
+}
+
+static void rebuild_stale_bins(arena_t* arena) {
+    if(arena->bins_stale) {
+        rebuild_bins(arena);
+    }
+}
+
+/**
+ * Push two robots apart if they overlap, given their slots in the bins.
+ */
+static void push_pair(arena_t* arena, uint32_t n, uint32_t m) {
+    uint32_t i = arena->bin_items[n];
+    uint32_t j = arena->bin_items[m];
+    float dx, dy, d;
+
+    dx = arena->x[j] - arena->x[i];
+    dy = arena->y[j] - arena->y[i];
+    if(dx * dx + dy * dy >= 4 * ROBOT_RADIUS * ROBOT_RADIUS) {
+        return;
+    }
+    d = sqrtf(dx * dx + dy * dy);
+    if(d > 0) {
+        float push = (2 * ROBOT_RADIUS - d) / 2 / d;
+        arena->x[i] -= dx * push;
+        arena->y[i] -= dy * push;
+        arena->x[j] += dx * push;
+        arena->y[j] += dy * push;
+        bump(arena, i, dx, dy);
+        bump(arena, j, -dx, -dy);
+    }
+}
+
+/**
+ * Push the robot in bin slot n apart from those of slots begin to end that were near it when
+ * binned.  The binned positions are a step old; allow for a step of travel and the pushes since.
+ */
+static inline __attribute__((always_inline))
+void push_near(arena_t* arena, uint32_t n, uint32_t begin, uint32_t end, near_kernel_t near) {
+    const float reach = 2 * ROBOT_RADIUS + 20.0f;
+    uint32_t m;
+    unsigned mask;
+
+    for(m = begin; m < end; m += ARENA_LANES) {
+        mask = near(arena, m, end - m < ARENA_LANES ? end - m : ARENA_LANES,
+                    arena->bin_x[n], arena->bin_y[n], reach * reach);
+        while(mask) {
+            push_pair(arena, n, m + __builtin_ctz(mask));
+            mask &= mask - 1;
+        }
+    }
+}
+
+/**
+ * Robots push each other apart.  The bins are one step old, but a robot moves far less than a
+ * cell in a step, so neighbours are still at most one cell away.
+ *
+ * Each robot is paired with the rest of its cell and the cell to its right, which follow it in
+ * bin order, and with the three cells of the next row, which are also contiguous; the other
+ * neighbours pair with it from their side.  Both runs are tested a vector at a time.
+ */
+static inline __attribute__((always_inline))
+void collide_with(arena_t* arena, near_kernel_t near) {
+    const uint32_t bins_x = arena->bins_x;
+    uint32_t cx, cy, n;
+
+    for(cy = 0; cy < arena->bins_y; cy++) {
+        for(cx = 0; cx < bins_x; cx++) {
+            uint32_t cell = cy * bins_x + cx;
+            uint32_t right_end = arena->bin_start[cx + 1 < bins_x ? cell + 2 : cell + 1];
+            uint32_t below_begin = 0, below_end = 0;
+
+            if(arena->bin_start[cell] == arena->bin_start[cell + 1]) {
+                continue;
+            }
+            if(cy + 1 < arena->bins_y) {
+                uint32_t row = (cy + 1) * bins_x;
+                below_begin = arena->bin_start[row + (cx > 0 ? cx - 1 : 0)];
+                below_end = arena->bin_start[row + (cx + 1 < bins_x ? cx + 1 : cx) + 1];
+            }
+            for(n = arena->bin_start[cell]; n < arena->bin_start[cell + 1]; n++) {
+                push_near(arena, n, n + 1, right_end, near);
+                push_near(arena, n, below_begin, below_end, near);
+            }
+        }
+    }
+}
+
+static void collide_scalar(arena_t* arena) {
+    collide_with(arena, near_scalar);
+}
+
+#if ARENA_X86
+
+__attribute__((target("sse")))
+static void collide_sse(arena_t* arena) {
+    collide_with(arena, near_sse);
+}
+
+__attribute__((target("avx")))
+static void collide_avx(arena_t* arena) {
+    collide_with(arena, near_avx);
+}
+
+#endif /* ARENA_X86 */
+
+/**
+ * The light bumper bits of a robot: which probes are inside a wall or another robot.
+ *
+ * The bins are fresh, so the binned positions are the robots' own.  A probe is within a cell
+ * of its robot, so the robots it can touch are in the three rows of three cells around the
+ * robot's cell, each contiguous in bin order.  The robot itself is farther from its probes than
+ * a body.
+ */
+static inline __attribute__((always_inline))
+uint8_t light_with(const arena_t* arena, uint32_t robot, near_kernel_t near) {
+    const float reach = ROBOT_RADIUS + LIGHT_BUMPER_RANGE;
+    const uint32_t bins_x = arena->bins_x;
+    uint32_t cell = arena->bin_of[robot];
+    uint32_t bx = cell % bins_x, by = cell / bins_x;
+    uint32_t row_begin[3], row_end[3], rows = 0;
+    float c = arena->heading_cos[robot];
+    float s = arena->heading_sin[robot];
+    uint32_t cy, r, n;
+    uint8_t i;
+    uint8_t bits = 0;
+
+    for(cy = by > 0 ? by - 1 : 0; cy <= by + 1 && cy < arena->bins_y; cy++) {
+        row_begin[rows] = arena->bin_start[cy * bins_x + (bx > 0 ? bx - 1 : 0)];
+        row_end[rows] = arena->bin_start[cy * bins_x + (bx + 1 < bins_x ? bx + 1 : bx) + 1];
+        rows++;
+    }
+
+    for(i = 0; i < 6; i++) {
+        float x = arena->x[robot] + reach * (c * light_bumper_cos[i] - s * light_bumper_sin[i]);
+        float y = arena->y[robot] + reach * (s * light_bumper_cos[i] + c * light_bumper_sin[i]);
+        int hit = x < 0 || y < 0 || x > arena->width || y > arena->height;
+
+        for(r = 0; r < rows && !hit; r++) {
+            for(n = row_begin[r]; n < row_end[r] && !hit; n += ARENA_LANES) {
+                hit = near(arena, n, row_end[r] - n < ARENA_LANES ? row_end[r] - n : ARENA_LANES,
+                           x, y, ROBOT_RADIUS * ROBOT_RADIUS) != 0;
+            }
+        }
+        if(hit) {
+            bits |= (1 << i);
+        }
+    }
+    return bits;
+}
+
+static uint8_t light_scalar(const arena_t* arena, uint32_t robot) {
+    return light_with(arena, robot, near_scalar);
+}
+
+#if ARENA_X86
+
+__attribute__((target("sse")))
+static uint8_t light_sse(const arena_t* arena, uint32_t robot) {
+    return light_with(arena, robot, near_sse);
+}
+
+__attribute__((target("avx")))
+static uint8_t light_avx(const arena_t* arena, uint32_t robot) {
+    return light_with(arena, robot, near_avx);
+}
+
+#endif /* ARENA_X86 */
+
+/* ==== Arena Functions ==== */
+
+static int kernel_supported(arena_kernel_t kernel) {
+#if ARENA_X86
+    __builtin_cpu_init();
+    if(kernel == ARENA_KERNEL_AVX) return __builtin_cpu_supports("avx");
+    if(kernel == ARENA_KERNEL_SSE) return __builtin_cpu_supports("sse");
+#endif
+    return kernel == ARENA_KERNEL_SCALAR;
+}
+
+/*
+ * The runs of neighbours are a few robots long, so in arenabench the AVX kernels are no faster
+ * than SSE; both are about 1.4 times scalar.
+ */
+static arena_kernel_t best_kernel(void) {
+    return kernel_supported(ARENA_KERNEL_SSE) ? ARENA_KERNEL_SSE : ARENA_KERNEL_SCALAR;
+}
+
+int Arena_Init(arena_t* arena, float width, float height, uint32_t capacity) {
+    uint32_t lanes, bins, i;
+
+    memset(arena, 0, sizeof(*arena));
+    arena->width = width;
+    arena->height = height;
+    arena->kernel = best_kernel();
+
+    lanes = ((capacity + ARENA_LANES - 1) / ARENA_LANES) * ARENA_LANES;
+    if(lanes == 0) lanes = ARENA_LANES;
+    arena->capacity = capacity;
+    arena->bins_x = (uint32_t)ceilf(width / ARENA_BIN_SIZE);
+    arena->bins_y = (uint32_t)ceilf(height / ARENA_BIN_SIZE);
+    if(arena->bins_x == 0) arena->bins_x = 1;
+    if(arena->bins_y == 0) arena->bins_y = 1;
+    bins = arena->bins_x * arena->bins_y;
+
+    arena->x = alloc_lanes(lanes, sizeof(float));
+    arena->y = alloc_lanes(lanes, sizeof(float));
+    arena->heading_cos = alloc_lanes(lanes, sizeof(float));
+    arena->heading_sin = alloc_lanes(lanes, sizeof(float));
+    arena->velocity = alloc_lanes(lanes, sizeof(int16_t));
+    arena->radius = alloc_lanes(lanes, sizeof(int16_t));
+    arena->speed = alloc_lanes(lanes, sizeof(float));
+    arena->omega = alloc_lanes(lanes, sizeof(float));
+    arena->turned = alloc_lanes(lanes, sizeof(float));
+    arena->bumps = alloc_lanes(lanes, sizeof(uint8_t));
+    arena->bin_start = alloc_lanes(bins + 1, sizeof(uint32_t));
+    arena->bin_items = alloc_lanes(lanes, sizeof(uint32_t));
+    arena->bin_of = alloc_lanes(lanes, sizeof(uint32_t));
+    arena->bin_x = alloc_lanes(lanes + ARENA_LANES, sizeof(float));
+    arena->bin_y = alloc_lanes(lanes + ARENA_LANES, sizeof(float));
+    arena->candidates = alloc_lanes(lanes, sizeof(uint32_t));
+    arena->candidate_x = alloc_lanes(lanes, sizeof(float));
+    arena->candidate_y = alloc_lanes(lanes, sizeof(float));
+    arena->candidate_hit = alloc_lanes(lanes, sizeof(uint8_t));
+
+    if(!arena->x || !arena->y || !arena->heading_cos || !arena->heading_sin || !arena->velocity ||
+       !arena->radius || !arena->speed || !arena->omega || !arena->turned || !arena->bumps ||
+       !arena->bin_start || !arena->bin_items || !arena->bin_of || !arena->bin_x || !arena->bin_y || !arena->candidates ||
+       !arena->candidate_x || !arena->candidate_y || !arena->candidate_hit) {
+        Arena_Free(arena);
+        return -1;
+    }
+
+    /* Padding lanes sit still, clear of the walls. */
+    for(i = 0; i < lanes; i++) {
+        arena->x[i] = ROBOT_RADIUS;
+        arena->y[i] = ROBOT_RADIUS;
+        arena->heading_cos[i] = 1;
+    }
+    return 0;
+}
+
+void Arena_Free(arena_t* arena) {
+    free(arena->x);
+    free(arena->y);
+    free(arena->heading_cos);
+    free(arena->heading_sin);
+    free(arena->velocity);
+    free(arena->radius);
+    free(arena->speed);
+    free(arena->omega);
+    free(arena->turned);
+    free(arena->bumps);
+    free(arena->bin_start);
+    free(arena->bin_items);
+    free(arena->bin_of);
+    free(arena->bin_x);
+    free(arena->bin_y);
+    free(arena->candidates);
+    free(arena->candidate_x);
+    free(arena->candidate_y);
+    free(arena->candidate_hit);
+    memset(arena, 0, sizeof(*arena));
+}
+
+arena_kernel_t Arena_Set_Kernel(arena_t* arena, arena_kernel_t kernel) {
+    while(!kernel_supported(kernel)) {
+        kernel = (arena_kernel_t)(kernel - 1);
+    }
+    arena->kernel = kernel;
+    return arena->kernel;
+}
+
+const char* Arena_Kernel_Name(arena_kernel_t kernel) {
+    switch(kernel) {
+        case ARENA_KERNEL_SSE: return "sse";
+        case ARENA_KERNEL_AVX: return "avx";
+        default: return "scalar";
+    }
+}
+
+uint32_t Arena_Add_Robot(arena_t* arena, float x, float y, float heading) {
+    uint32_t i = arena->count++;
+    arena->x[i] = x;
+    arena->y[i] = y;
+    arena->heading_cos[i] = cosf(heading);
+    arena->heading_sin[i] = sinf(heading);
+    arena->velocity[i] = 0;
+    arena->radius[i] = (int16_t)0x8000;
+    arena->speed[i] = 0;
+    arena->omega[i] = 0;
+    arena->turned[i] = 0;
+    arena->bumps[i] = 0;
+    arena->bins_stale = 1;
+    return i;
+}
+
+void Arena_Drive(arena_t* arena, uint32_t robot, int16_t velocity, int16_t radius) {
+    float v;
+    if(velocity > 500) velocity = 500;
+    if(velocity < -500) velocity = -500;
+    arena->velocity[robot] = velocity;
+    arena->radius[robot] = radius;
+
+    v = velocity;
+    if(radius == (int16_t)0x8000 || radius == 0x7FFF || radius == 0) {
+        arena->speed[robot] = v;
+        arena->omega[robot] = 0;
+    } else if(radius == 1) {
+        arena->speed[robot] = 0;
+        arena->omega[robot] = v / (ROBOT_WHEEL_BASE / 2);
+    } else if(radius == -1) {
+        arena->speed[robot] = 0;
+        arena->omega[robot] = -v / (ROBOT_WHEEL_BASE / 2);
+    } else {
+        arena->speed[robot] = v;
+        arena->omega[robot] = v / radius;
+    }
+}
+
+void Arena_Step(arena_t* arena, float dt) {
+    rebuild_stale_bins(arena);
+    switch(arena->kernel) {
+#if ARENA_X86
+        case ARENA_KERNEL_AVX:
+            integrate_avx(arena, dt);
+            collide_avx(arena);
+            break;
+        case ARENA_KERNEL_SSE:
+            integrate_sse(arena, dt);
+            collide_sse(arena);
+            break;
+#endif
+        default:
+            integrate_scalar(arena, dt);
+            collide_scalar(arena);
+            break;
+    }
+    rebuild_bins(arena);
+}
+
+void Arena_Read_Chassis(arena_t* arena, uint32_t robot, roomba_sensor_data_t* sensors) {
+    /* Our roombas report the angle in thirds of a degree (see Decision_Update_Odometry). */
+    sensors->angle.value = (int16_t)(arena->turned[robot] * (float)(180.0 / M_PI / 3.0));
+    sensors->distance.value = 0;
+    arena->turned[robot] -= sensors->angle.value * (float)(3.0 * M_PI / 180.0);
+}
+
+void Arena_Read_External(arena_t* arena, uint32_t robot, roomba_sensor_data_t* sensors) {
+    sensors->bumps_wheeldrops = arena->bumps[robot];
+    arena->bumps[robot] = 0;
+}
+
+void Arena_Read_Light(arena_t* arena, uint32_t robot, roomba_sensor_data_t* sensors) {
+    rebuild_stale_bins(arena);
+    switch(arena->kernel) {
+#if ARENA_X86
+        case ARENA_KERNEL_AVX:
+            sensors->light_bumber = light_avx(arena, robot);
+            break;
+        case ARENA_KERNEL_SSE:
+            sensors->light_bumber = light_sse(arena, robot);
+            break;
+#endif
+        default:
+            sensors->light_bumber = light_scalar(arena, robot);
+            break;
+    }
+}
+
+uint32_t Arena_IR_Fire(arena_t* arena, uint32_t shooter, uint32_t* hits) {
+    const float cos_half = cosf(IR_HALF_ANGLE);
+    const float sin_half = sinf(IR_HALF_ANGLE);
+    float sx = arena->x[shooter];
+    float sy = arena->y[shooter];
+    float c = arena->heading_cos[shooter];
+    float s = arena->heading_sin[shooter];
+    float min_x, max_x, min_y, max_y, ex, ey;
+    uint32_t count = 0, padded, hit_count = 0;
+    uint32_t bx0, bx1, by0, by1, cx, cy, n, k, m;
+
+    /* Bounding box of the beam: the tip, both edges, and any axis direction inside the beam. */
+    min_x = max_x = sx;
+    min_y = max_y = sy;
+    ex = sx + IR_RANGE * (c * cos_half - s * sin_half);
+    ey = sy + IR_RANGE * (s * cos_half + c * sin_half);
+    min_x = fminf(min_x, ex); max_x = fmaxf(max_x, ex); min_y = fminf(min_y, ey); max_y = fmaxf(max_y, ey);
+    ex = sx + IR_RANGE * (c * cos_half + s * sin_half);
+    ey = sy + IR_RANGE * (s * cos_half - c * sin_half);
+    min_x = fminf(min_x, ex); max_x = fmaxf(max_x, ex); min_y = fminf(min_y, ey); max_y = fmaxf(max_y, ey);
+    if(c >= cos_half) max_x = sx + IR_RANGE;
+    if(-c >= cos_half) min_x = sx - IR_RANGE;
+    if(s >= cos_half) max_y = sy + IR_RANGE;
+    if(-s >= cos_half) min_y = sy - IR_RANGE;
+
+    /* Gather every robot that could be hit or block a hit. */
+    rebuild_stale_bins(arena);
+    bx0 = clamp_bin(min_x - ROBOT_RADIUS, arena->bins_x);
+    bx1 = clamp_bin(max_x + ROBOT_RADIUS, arena->bins_x);
+    by0 = clamp_bin(min_y - ROBOT_RADIUS, arena->bins_y);
+    by1 = clamp_bin(max_y + ROBOT_RADIUS, arena->bins_y);
+    for(cy = by0; cy <= by1; cy++) {
+        for(cx = bx0; cx <= bx1; cx++) {
+            uint32_t cell = cy * arena->bins_x + cx;
+            for(n = arena->bin_start[cell]; n < arena->bin_start[cell + 1]; n++) {
+                uint32_t j = arena->bin_items[n];
+                if(j == shooter) continue;
+                arena->candidates[count] = j;
+                arena->candidate_x[count] = arena->x[j];
+                arena->candidate_y[count] = arena->y[j];
+                count++;
+            }
+        }
+    }
+    /* Padding lanes are out of range. */
+    for(padded = count; padded % ARENA_LANES != 0; padded++) {
+        arena->candidate_x[padded] = sx + 2 * IR_RANGE;
+        arena->candidate_y[padded] = sy;
+    }
+
+    switch(arena->kernel) {
+#if ARENA_X86
+        case ARENA_KERNEL_AVX:
+            cone_avx(arena, padded, sx, sy, c, s);
+            break;
+        case ARENA_KERNEL_SSE:
+            cone_sse(arena, padded, sx, sy, c, s);
+            break;
+#endif
+        default:
+            cone_scalar(arena, padded, sx, sy, c, s);
+            break;
+    }
+
+    for(k = 0; k < count; k++) {
+        float dx, dy, d2;
+        int blocked = 0;
+        if(!arena->candidate_hit[k]) {
+            continue;
+        }
+
+        /* Line of sight: no other robot body crosses the segment from shooter to target. */
+        dx = arena->candidate_x[k] - sx;
+        dy = arena->candidate_y[k] - sy;
+        d2 = dx * dx + dy * dy;
+        for(m = 0; m < count && !blocked; m++) {
+            float ox = arena->candidate_x[m] - sx;
+            float oy = arena->candidate_y[m] - sy;
+            float along = (ox * dx + oy * dy) / d2;
+            float px, py;
+            if(m == k || along <= 0 || along >= 1) {
+                continue;
+            }
+            px = ox - along * dx;
+            py = oy - along * dy;
+            blocked = px * px + py * py < ROBOT_RADIUS * ROBOT_RADIUS;
+        }
+
+        if(!blocked) {
+            hits[hit_count++] = arena->candidates[k];
+        }
+    }
+    return hit_count;
+}
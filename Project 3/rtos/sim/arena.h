@@ -0,0 +1,116 @@
+/*
+ * arena.h
+ *
+ * A simulated cops and robbers arena: roomba kinematics, the sensors the roomba firmware
+ * reads, and IR line-of-sight hits.  Distances are in mm, angles in radians counter clockwise.
+ *
+ * The arena scales from a 4 roomba game to fleets of thousands:
+ *   - Robots are stored as a structure of arrays, padded to a whole number of SIMD lanes, so
+ *     pose integration and beam tests run 4 (SSE) or 8 (AVX) robots at a time.
+ *   - Robots are binned into a grid of ARENA_BIN_SIZE cells after every step, so collisions,
+ *     light bumper probes and IR beams only look at nearby robots, a vector of them at a time.
+ */
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <stdint.h>
+#include "sensor_struct.h"
+
+/** Roomba body radius and wheel base, in mm. */
+#define ROBOT_RADIUS        170.0f
+#define ROBOT_WHEEL_BASE    258.0f
+
+/** IR emitter range (mm) and half angle of its beam (radians). */
+#define IR_RANGE            2500.0f
+#define IR_HALF_ANGLE       0.35f
+
+/** Reach of the light bumper beyond the body, in mm. */
+#define LIGHT_BUMPER_RANGE  120.0f
+
+/** Side of a grid cell, in mm.  At least the reach of a light bumper probe plus a body. */
+#define ARENA_BIN_SIZE      1000.0f
+
+/** Robot arrays are padded to, and aligned for, this many float lanes. */
+#define ARENA_LANES         8
+
+typedef enum _arena_kernel {
+    ARENA_KERNEL_SCALAR,
+    ARENA_KERNEL_SSE,
+    ARENA_KERNEL_AVX
+} arena_kernel_t;
+
+typedef struct _arena {
+    float width;
+    float height;
+    uint32_t count;
+    uint32_t capacity;
+    arena_kernel_t kernel;
+
+    /* Pose; the heading is kept as a unit vector. */
+    float* x;
+    float* y;
+    float* heading_cos;
+    float* heading_sin;
+    /* The last drive command as sent to Roomba_Drive(), and the motion it gives. */
+    int16_t* velocity;
+    int16_t* radius;
+    float* speed;
+    float* omega;
+    /* Rotation since the last chassis sensor update. */
+    float* turned;
+    /* Bump bits latched since the last external sensor update. */
+    uint8_t* bumps;
+
+    /*
+     * Grid: the robots of cell c are bin_items[bin_start[c] .. bin_start[c+1]-1], with their
+     * positions when binned in bin_x/bin_y.  Cells are numbered row by row.
+     */
+    uint32_t bins_x;
+    uint32_t bins_y;
+    uint8_t bins_stale;
+    uint32_t* bin_start;
+    uint32_t* bin_items;
+    uint32_t* bin_of;
+    float* bin_x;
+    float* bin_y;
+
+    /* Scratch for beam tests. */
+    uint32_t* candidates;
+    float* candidate_x;
+    float* candidate_y;
+    uint8_t* candidate_hit;
+} arena_t;
+
+/**
+ * Make an empty arena with room for capacity robots, using the SSE kernels if the CPU has them.
+ * Returns 0 on success, -1 if out of memory.
+ */
+int Arena_Init(arena_t* arena, float width, float height, uint32_t capacity);
+void Arena_Free(arena_t* arena);
+
+/** Use another kernel; falls back to the next one down the CPU has.  Returns the kernel in use. */
+arena_kernel_t Arena_Set_Kernel(arena_t* arena, arena_kernel_t kernel);
+const char* Arena_Kernel_Name(arena_kernel_t kernel);
+
+/** Add a robot at the given pose, returns its index. */
+uint32_t Arena_Add_Robot(arena_t* arena, float x, float y, float heading);
+
+/** Apply a Roomba_Drive() command: velocity in mm/s, radius in mm (0x8000 straight, 1/-1 spin). */
+void Arena_Drive(arena_t* arena, uint32_t robot, int16_t velocity, int16_t radius);
+
+/** Advance the arena by dt seconds. */
+void Arena_Step(arena_t* arena, float dt);
+
+/** Fill in the sensor group the roomba just queried, as the Roomba would report it. */
+void Arena_Read_Chassis(arena_t* arena, uint32_t robot, roomba_sensor_data_t* sensors);
+void Arena_Read_External(arena_t* arena, uint32_t robot, roomba_sensor_data_t* sensors);
+void Arena_Read_Light(arena_t* arena, uint32_t robot, roomba_sensor_data_t* sensors);
+
+/**
+ * Fire the IR emitter of a robot.  The robots inside its beam with a clear line of sight are
+ * written to hits, which must have room for count robots.  Returns the number of robots hit.
+ */
+uint32_t Arena_IR_Fire(arena_t* arena, uint32_t shooter, uint32_t* hits);
+
+#endif /* ARENA_H_ */
@@ -0,0 +1,178 @@
+/*
+ * arenabench.c
+ *
+ * Benchmark the arena with a large fleet of roombas running the roomba automation.
+ *
+ * Usage: arenabench [-n robots] [-t seconds] [-k scalar|sse|avx|all] [-s seed]
+ *
+ * Half of the fleet are cops and half robbers, at the density of a 4 roomba game in a 3 m
+ * arena.  Every TICK each roomba runs Decision_Step; every 100 ms it runs its roomba_interface
+ * update, firing its IR on the chassis update.  Reports robot-steps per second for the arena
+ * step alone and for the whole loop.  Built by build_sim.sh.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "arena.h"
+#include "game.h"
+
+#define INTERFACE_PERIOD_MS 100
+
+typedef struct _fleet_roomba {
+    IR_TEAM_CODE ir_team;
+    IR_TEAM_CODE ir_enemy;
+    uint8_t roomba_state;
+    uint8_t sensor_stage;
+    roomba_sensor_data_t sensors;
+    automation_data_t automation;
+    control_state_t controls;
+    decision_t decision;
+} fleet_roomba_t;
+
+typedef struct _bench_result {
+    double step_seconds;
+    double total_seconds;
+    uint64_t hits;
+} bench_result_t;
+
+static double seconds_since(const struct timespec* start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: arenabench [-n robots] [-t seconds] [-k scalar|sse|avx|all] [-s seed]\n");
+    exit(2);
+}
+
+static int bench(arena_kernel_t kernel, uint32_t robots, uint32_t steps, unsigned seed, bench_result_t* result) {
+    static const decision_params_t params = DECISION_PARAMS_DEFAULT;
+    float side = 3000.0f * sqrtf(robots / 4.0f);
+    fleet_roomba_t* fleet = calloc(robots, sizeof(fleet_roomba_t));
+    uint32_t* hits = malloc(robots * sizeof(uint32_t));
+    arena_t arena;
+    uint32_t i, step, h;
+
+    if(!fleet || !hits || Arena_Init(&arena, side, side, robots) != 0) {
+        free(fleet);
+        free(hits);
+        return -1;
+    }
+    Arena_Set_Kernel(&arena, kernel);
+
+    srand(seed);
+    for(i = 0; i < robots; i++) {
+        float x = ROBOT_RADIUS + (side - 2 * ROBOT_RADIUS) * (rand() / (float)RAND_MAX);
+        float y = ROBOT_RADIUS + (side - 2 * ROBOT_RADIUS) * (rand() / (float)RAND_MAX);
+        Arena_Add_Robot(&arena, x, y, (float)(2 * M_PI) * (rand() / (float)RAND_MAX));
+        fleet[i].ir_team = (i & 1) ? ROBBER_CODE : COP_CODE;
+        fleet[i].ir_enemy = (i & 1) ? COP_CODE : ROBBER_CODE;
+        Decision_Init(&fleet[i].decision, &fleet[i].automation);
+    }
+
+    memset(result, 0, sizeof(*result));
+    for(step = 0; step < steps; step++) {
+        struct timespec start, arena_start;
+        uint32_t phase = step % (INTERFACE_PERIOD_MS / SIM_STEP_MS);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        for(i = 0; i < robots; i++) {
+            fleet_roomba_t* roomba = &fleet[i];
+
+            /* The roombas' interface tasks are spread over the period. */
+            if(i % (INTERFACE_PERIOD_MS / SIM_STEP_MS) == phase) {
+                switch(roomba->sensor_stage) {
+                    case 0:
+                        Arena_Read_Chassis(&arena, i, &roomba->sensors);
+                        Decision_Update_Odometry(&roomba->automation, &roomba->sensors);
+                        if(roomba->controls.shooting != 0) {
+                            uint32_t count = Arena_IR_Fire(&arena, i, hits);
+                            for(h = 0; h < count; h++) {
+                                fleet_roomba_t* target = &fleet[hits[h]];
+                                Game_Apply_IR(roomba->ir_team, target->ir_team, target->ir_enemy, &target->roomba_state);
+                            }
+                            result->hits += count;
+                        }
+                        break;
+                    case 1:
+                        Arena_Read_External(&arena, i, &roomba->sensors);
+                        break;
+                    default:
+                        Arena_Read_Light(&arena, i, &roomba->sensors);
+                        break;
+                }
+                roomba->sensor_stage = (roomba->sensor_stage + 1) % 3;
+                Arena_Drive(&arena, i, roomba->controls.drive_velocity, (int16_t)(-1*roomba->controls.turn_radius));
+            }
+
+            Decision_Step(&roomba->decision, &params, GAME_RUNNING, roomba->roomba_state,
+                          &roomba->sensors, &roomba->automation, &roomba->controls);
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &arena_start);
+        Arena_Step(&arena, SIM_STEP_MS / 1000.0f);
+        result->step_seconds += seconds_since(&arena_start);
+        result->total_seconds += seconds_since(&start);
+    }
+
+    Arena_Free(&arena);
+    free(fleet);
+    free(hits);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    uint32_t robots = 4096;
+    uint32_t seconds = 10;
+    unsigned seed = 1;
+    int first = ARENA_KERNEL_SCALAR, last = ARENA_KERNEL_AVX;
+    int i, k;
+
+    for(i = 1; i < argc; i++) {
+        if(i + 1 >= argc) usage();
+        if(strcmp(argv[i], "-n") == 0) robots = strtoul(argv[++i], NULL, 0);
+        else if(strcmp(argv[i], "-t") == 0) seconds = strtoul(argv[++i], NULL, 0);
+        else if(strcmp(argv[i], "-s") == 0) seed = strtoul(argv[++i], NULL, 0);
+        else if(strcmp(argv[i], "-k") == 0) {
+            const char* name = argv[++i];
+            if(strcmp(name, "all") == 0) continue;
+            for(k = ARENA_KERNEL_SCALAR; k <= ARENA_KERNEL_AVX; k++) {
+                if(strcmp(name, Arena_Kernel_Name((arena_kernel_t)k)) == 0) first = last = k;
+            }
+            if(first != last) usage();
+        }
+        else usage();
+    }
+    if(robots == 0 || seconds == 0) usage();
+
+    printf("%u robots, %u s simulated in %u ms steps\n", robots, seconds, SIM_STEP_MS);
+    for(k = first; k <= last; k++) {
+        uint32_t steps = seconds * 1000 / SIM_STEP_MS;
+        double robot_steps = (double)robots * steps;
+        bench_result_t result;
+        arena_t probe;
+
+        /* Skip kernels this CPU does not have. */
+        if(Arena_Init(&probe, 1000, 1000, 1) != 0) return 1;
+        if(Arena_Set_Kernel(&probe, (arena_kernel_t)k) != (arena_kernel_t)k) {
+            printf("  %-6s not supported\n", Arena_Kernel_Name((arena_kernel_t)k));
+            Arena_Free(&probe);
+            continue;
+        }
+        Arena_Free(&probe);
+
+        if(bench((arena_kernel_t)k, robots, steps, seed, &result) != 0) {
+            perror("arenabench");
+            return 1;
+        }
+        printf("  %-6s arena step %8.2f M robot-steps/s   whole loop %8.2f M robot-steps/s   %llu IR hits\n",
+               Arena_Kernel_Name((arena_kernel_t)k),
+               robot_steps / result.step_seconds / 1e6, robot_steps / result.total_seconds / 1e6,
+               (unsigned long long)result.hits);
+    }
+    return 0;
+}
@@ -0,0 +1,276 @@
+/*
+ * game.c
+ *
+ * One simulated cops and robbers game.
+ *
+ * Each roomba runs the firmware's tasks at the firmware's rates:
+ *   - roomba_interface, PERIODIC every 100 ms from 1 s: cycles through the chassis, external and
+ *     light sensor groups, fires the IR on the chassis update, and sends the drive command.
+ *   - decision_making, RR: evaluated once per TICK.
+ *   - radio_receive / ir_rxhandler: apply the game rules when a packet or IR code arrives.
+ * The base station starts the game, sends the gamestate every 250 ms from 5 s, applies roomba
+ * reports and ends the game once a team is dead.
+ */
+
+#include <math.h>
+#include <string.h>
+#include "arena.h"
+#include "game.h"
+
+#define ROOMBAS             4
+#define RADIO_QUEUE_SIZE    64
+#define TO_BASE             (-1)
+
+#define INTERFACE_START_MS  1000
+#define INTERFACE_PERIOD_MS 100
+#define SENDSTATE_START_MS  5000
+#define SENDSTATE_PERIOD_MS 250
+
+/** The roombas are switched on up to this long apart. */
+#define BOOT_JITTER_MS      1000
+
+typedef struct _sim_roomba {
+    COPS_AND_ROBBERS identity;
+    IR_TEAM_CODE ir_team;
+    IR_TEAM_CODE ir_enemy;
+    uint8_t roomba_state;
+    pf_gamestate_t current_game_state;
+    roomba_sensor_data_t sensors;
+    automation_data_t automation;
+    control_state_t controls;
+    decision_t decision;
+    uint8_t sensor_stage;
+    /** When the roomba was switched on; the roombas' tasks are not in step with each other. */
+    uint32_t boot_ms;
+} sim_roomba_t;
+
+typedef struct _radio_message {
+    uint32_t at;
+    int8_t to;
+    pf_gamestate_t gamestate;
+    pf_roombastate_t roombastate;
+} radio_message_t;
+
+typedef struct _game {
+    const sim_config_t* config;
+    uint64_t rng;
+    uint32_t now;
+    arena_t arena;
+    sim_roomba_t roombas[ROOMBAS];
+    pf_gamestate_t base_state;
+    radio_message_t radio[RADIO_QUEUE_SIZE];
+    uint8_t radio_head;
+    uint8_t radio_count;
+} game_t;
+
+static uint64_t rng_next(uint64_t* state) {
+    /* splitmix64 */
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static double rng_uniform(uint64_t* state) {
+    return (rng_next(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static int team_of(COPS_AND_ROBBERS identity) {
+    return (identity == COP1 || identity == COP2) ? TEAM_COPS : TEAM_ROBBERS;
+}
+
+static void radio_send(game_t* game, int8_t to, const pf_gamestate_t* gamestate, const pf_roombastate_t* roombastate) {
+    radio_message_t* message;
+    if(game->radio_count == RADIO_QUEUE_SIZE || rng_uniform(&game->rng) < game->config->radio_loss) {
+        return;
+    }
+    message = &game->radio[(game->radio_head + game->radio_count++) % RADIO_QUEUE_SIZE];
+    message->at = game->now + game->config->radio_delay_ms;
+    message->to = to;
+    if(gamestate) message->gamestate = *gamestate;
+    if(roombastate) message->roombastate = *roombastate;
+}
+
+/**
+ * The roomba's radio_receive and radio_send tasks.
+ */
+static void roomba_receive(game_t* game, sim_roomba_t* roomba, const pf_gamestate_t* gamestate) {
+    roomba->current_game_state = *gamestate;
+    if(Game_Sync_Roomba(&roomba->current_game_state, roomba->identity, &roomba->roomba_state)) {
+        pf_roombastate_t report;
+        report.roomba_id = roomba->identity;
+        report.roomba_state = roomba->roomba_state;
+        radio_send(game, TO_BASE, NULL, &report);
+    }
+}
+
+static void radio_deliver(game_t* game) {
+    while(game->radio_count > 0 && game->radio[game->radio_head].at <= game->now) {
+        radio_message_t* message = &game->radio[game->radio_head];
+        game->radio_head = (game->radio_head + 1) % RADIO_QUEUE_SIZE;
+        game->radio_count--;
+
+        if(message->to == TO_BASE) {
+            Game_Apply_Roombastate(&game->base_state, &message->roombastate);
+        } else {
+            roomba_receive(game, &game->roombas[(uint8_t)message->to], &message->gamestate);
+        }
+    }
+}
+
+/**
+ * The roomba's ir_rxhandler for every roomba in the beam.
+ */
+static void fire_ir(game_t* game, uint8_t shooter, game_result_t* result) {
+    uint32_t hits[ROOMBAS];
+    uint32_t count = Arena_IR_Fire(&game->arena, shooter, hits);
+    uint32_t i;
+
+    for(i = 0; i < count; i++) {
+        sim_roomba_t* target = &game->roombas[hits[i]];
+        uint8_t was_dead = target->roomba_state & DEAD;
+        Game_Apply_IR(game->roombas[shooter].ir_team, target->ir_team, target->ir_enemy, &target->roomba_state);
+        if(!was_dead && (target->roomba_state & DEAD)) result->kills++;
+        if(was_dead && !(target->roomba_state & DEAD)) result->revives++;
+    }
+}
+
+/**
+ * The roomba's roomba_interface task.
+ */
+static void roomba_interface(game_t* game, uint8_t index, game_result_t* result) {
+    sim_roomba_t* roomba = &game->roombas[index];
+
+    switch(roomba->sensor_stage) {
+        case 0:
+            Arena_Read_Chassis(&game->arena, index, &roomba->sensors);
+            Decision_Update_Odometry(&roomba->automation, &roomba->sensors);
+            if(roomba->controls.shooting != 0) {
+                fire_ir(game, index, result);
+            }
+            break;
+        case 1:
+            Arena_Read_External(&game->arena, index, &roomba->sensors);
+            break;
+        default:
+            Arena_Read_Light(&game->arena, index, &roomba->sensors);
+            break;
+    }
+    roomba->sensor_stage = (roomba->sensor_stage + 1) % 3;
+
+    Arena_Drive(&game->arena, index, roomba->controls.drive_velocity, (int16_t)(-1*roomba->controls.turn_radius));
+}
+
+static void place_roombas(game_t* game) {
+    const sim_config_t* config = game->config;
+    uint8_t i, j;
+
+    for(i = 0; i < ROOMBAS; i++) {
+        sim_roomba_t* roomba = &game->roombas[i];
+        double x, y;
+        int clear;
+
+        do {
+            double side = team_of((COPS_AND_ROBBERS)i) == TEAM_COPS ? 0.15 : 0.65;
+            x = config->arena_width * (side + 0.2 * rng_uniform(&game->rng));
+            y = ROBOT_RADIUS + (config->arena_height - 2 * ROBOT_RADIUS) * rng_uniform(&game->rng);
+            clear = 1;
+            for(j = 0; j < i; j++) {
+                double dx = game->arena.x[j] - x;
+                double dy = game->arena.y[j] - y;
+                clear &= dx * dx + dy * dy > 4 * ROBOT_RADIUS * ROBOT_RADIUS;
+            }
+        } while(!clear);
+        Arena_Add_Robot(&game->arena, x, y, 2 * M_PI * rng_uniform(&game->rng));
+
+        memset(roomba, 0, sizeof(*roomba));
+        roomba->identity = (COPS_AND_ROBBERS)i;
+        roomba->ir_team = team_of(roomba->identity) == TEAM_COPS ? COP_CODE : ROBBER_CODE;
+        roomba->ir_enemy = team_of(roomba->identity) == TEAM_COPS ? ROBBER_CODE : COP_CODE;
+        roomba->boot_ms = SIM_STEP_MS * (rng_next(&game->rng) % (BOOT_JITTER_MS / SIM_STEP_MS));
+        Decision_Init(&roomba->decision, &roomba->automation);
+    }
+}
+
+void Sim_Config_Default(sim_config_t* config) {
+    static const decision_params_t defaults = DECISION_PARAMS_DEFAULT;
+    memset(config, 0, sizeof(*config));
+    config->team_params[TEAM_COPS] = defaults;
+    config->team_params[TEAM_ROBBERS] = defaults;
+    config->arena_width = 3000;
+    config->arena_height = 3000;
+    config->start_ms = 5000;
+    config->timeout_ms = 180000;
+    config->radio_delay_ms = 2;
+    config->radio_loss = 0.02;
+    config->broadcast_all = 1;
+}
+
+void Sim_Game_Run(const sim_config_t* config, uint64_t seed, game_result_t* result) {
+    game_t game;
+    uint8_t i, first;
+
+    memset(&game, 0, sizeof(game));
+    game.config = config;
+    game.rng = seed;
+    memset(result, 0, sizeof(*result));
+    result->winner = TEAM_NONE;
+    result->duration_ms = config->timeout_ms;
+
+    if(Arena_Init(&game.arena, config->arena_width, config->arena_height, ROOMBAS) != 0) {
+        return;
+    }
+    place_roombas(&game);
+
+    /* The base station's r_main. */
+    game.base_state.game_state = GAME_STARTING;
+    for(i = COP1; i <= ROBBER2; i++) {
+        game.base_state.roomba_states[i] = FORCED;
+    }
+
+    for(game.now = 0; game.now < config->start_ms + config->timeout_ms; game.now += SIM_STEP_MS) {
+        radio_deliver(&game);
+
+        /* Base station: user_input, update_gamestate and sendState. */
+        if(game.now == config->start_ms) {
+            Game_Start(&game.base_state);
+        }
+        if(game.base_state.game_state == GAME_RUNNING && result->first_kill_ms == 0) {
+            for(i = COP1; i <= ROBBER2; i++) {
+                if(game.base_state.roomba_states[i] & DEAD) {
+                    result->first_kill_ms = game.now - config->start_ms;
+                }
+            }
+        }
+        if(Game_Update(&game.base_state)) {
+            uint8_t cops_dead = (game.base_state.roomba_states[COP1] & DEAD) && (game.base_state.roomba_states[COP2] & DEAD);
+            uint8_t robbers_dead = (game.base_state.roomba_states[ROBBER1] & DEAD) && (game.base_state.roomba_states[ROBBER2] & DEAD);
+            result->winner = cops_dead == robbers_dead ? TEAM_NONE : (cops_dead ? TEAM_ROBBERS : TEAM_COPS);
+            result->duration_ms = game.now - config->start_ms;
+            break;
+        }
+        if(game.now >= SENDSTATE_START_MS && (game.now - SENDSTATE_START_MS) % SENDSTATE_PERIOD_MS == 0) {
+            for(i = COP1; i <= (config->broadcast_all ? ROBBER2 : COP1); i++) {
+                radio_send(&game, i, &game.base_state, NULL);
+            }
+        }
+
+        /* Roombas: roomba_interface and decision_making, in a random order so no team always shoots last. */
+        first = rng_next(&game.rng) % ROOMBAS;
+        for(i = 0; i < ROOMBAS; i++) {
+            uint8_t index = (first + i) % ROOMBAS;
+            sim_roomba_t* roomba = &game.roombas[index];
+            uint32_t uptime = game.now - roomba->boot_ms;
+            if(game.now >= roomba->boot_ms + INTERFACE_START_MS && (uptime - INTERFACE_START_MS) % INTERFACE_PERIOD_MS == 0) {
+                roomba_interface(&game, index, result);
+            }
+            Decision_Step(&roomba->decision, &config->team_params[team_of(roomba->identity)],
+                          roomba->current_game_state.game_state, roomba->roomba_state,
+                          &roomba->sensors, &roomba->automation, &roomba->controls);
+        }
+
+        Arena_Step(&game.arena, SIM_STEP_MS / 1000.0f);
+    }
+
+    Arena_Free(&game.arena);
+}
@@ -0,0 +1,55 @@
+/*
+ * game.h
+ *
+ * One simulated cops and robbers game: four roombas running the real decision logic and game
+ * rules against the simulated arena, talking to a simulated base station over a delayed radio.
+ */
+
+#ifndef SIM_GAME_H_
+#define SIM_GAME_H_
+
+#include <stdint.h>
+#include "decision.h"
+
+/** Teams, indexing sim_config_t.team_params and the win counts. */
+#define TEAM_COPS       0
+#define TEAM_ROBBERS    1
+#define TEAM_NONE       2
+
+/** The simulation step, one RTOS TICK. */
+#define SIM_STEP_MS     5
+
+typedef struct _sim_config {
+    /** The automation constants each team plays with. */
+    decision_params_t team_params[2];
+    /** Arena size in mm. */
+    double arena_width;
+    double arena_height;
+    /** When the base station's button is pressed, and when an unfinished game is called a draw. */
+    uint32_t start_ms;
+    uint32_t timeout_ms;
+    /** Radio latency and the chance a packet is lost. */
+    uint16_t radio_delay_ms;
+    double radio_loss;
+    /** Send the gamestate to all four roombas, not just COP1 as the base station firmware does. */
+    uint8_t broadcast_all;
+} sim_config_t;
+
+typedef struct _game_result {
+    /** TEAM_COPS or TEAM_ROBBERS, or TEAM_NONE for a draw. */
+    uint8_t winner;
+    /** Time from the start of the game until the base station saw the first death, 0 if none. */
+    uint32_t first_kill_ms;
+    /** Time from the start of the game until it ended. */
+    uint32_t duration_ms;
+    uint16_t kills;
+    uint16_t revives;
+} game_result_t;
+
+/** The defaults mirror the firmware: 5 s of boot, a 3 m x 3 m arena, and a 3 minute game. */
+void Sim_Config_Default(sim_config_t* config);
+
+/** Play one game.  The same seed always plays the same game. */
+void Sim_Game_Run(const sim_config_t* config, uint64_t seed, game_result_t* result);
+
+#endif /* SIM_GAME_H_ */
@@ -0,0 +1,224 @@
+/*
+ * montecarlo.c
+ *
+ * Play many simulated cops and robbers games in parallel and report how each team fares.
+ *
+ * Usage: montecarlo [options]
+ *   -n games            games per configuration (default 10000)
+ *   -j threads          worker threads (default: one per processor)
+ *   -s seed             base seed; game i of every configuration uses the same arena
+ *   -t seconds          game length before it is called a draw (default 180)
+ *   -d ms               radio latency (default 2)
+ *   -l fraction         radio packet loss (default 0.02)
+ *   -1                  send the gamestate only to COP1, as the base station firmware does
+ *   --cop name=value    change a decision parameter of the cops
+ *   --robber name=value change a decision parameter of the robbers
+ *   --sweep name=lo:hi:step
+ *                       repeat the run for each value of a robber decision parameter
+ *
+ * Decision parameter names are the fields of decision_params_t, e.g. orbit_rotation.
+ */
+
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "game.h"
+#include "pool.h"
+
+typedef struct _param_name {
+    const char* name;
+    size_t offset;
+} param_name_t;
+
+static const param_name_t param_names[] = {
+    { "straight_velocity", offsetof(decision_params_t, straight_velocity) },
+    { "straight_distance", offsetof(decision_params_t, straight_distance) },
+    { "orbit_velocity", offsetof(decision_params_t, orbit_velocity) },
+    { "orbit_rotation", offsetof(decision_params_t, orbit_rotation) },
+    { "revived_velocity", offsetof(decision_params_t, revived_velocity) },
+    { "revived_rotation", offsetof(decision_params_t, revived_rotation) },
+};
+
+typedef struct _run {
+    const sim_config_t* config;
+    uint64_t seed;
+    game_result_t* results;
+} run_t;
+
+static void usage(void) {
+    fprintf(stderr, "usage: montecarlo [-n games] [-j threads] [-s seed] [-t seconds] [-d ms] [-l loss] [-1]\n"
+                    "                  [--cop name=value] [--robber name=value] [--sweep name=lo:hi:step]\n");
+    exit(2);
+}
+
+static int16_t* find_param(decision_params_t* params, const char* name, size_t length) {
+    size_t i;
+    for(i = 0; i < sizeof(param_names) / sizeof(param_names[0]); i++) {
+        if(strlen(param_names[i].name) == length && strncmp(param_names[i].name, name, length) == 0) {
+            return (int16_t*)((char*)params + param_names[i].offset);
+        }
+    }
+    fprintf(stderr, "montecarlo: unknown decision parameter '%.*s'\n", (int)length, name);
+    exit(2);
+}
+
+static void set_param(decision_params_t* params, const char* assignment) {
+    const char* eq = strchr(assignment, '=');
+    if(!eq) usage();
+    *find_param(params, assignment, eq - assignment) = (int16_t)atoi(eq + 1);
+}
+
+static uint64_t game_seed(uint64_t seed, uint32_t index) {
+    uint64_t z = seed + 0x9E3779B97F4A7C15ULL * (index + 1);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static void play(uint32_t index, unsigned worker, void* arg) {
+    run_t* run = (run_t*)arg;
+    (void)worker;
+    Sim_Game_Run(run->config, game_seed(run->seed, index), &run->results[index]);
+}
+
+static int compare_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * Wilson score interval half-width and centre for k successes in n trials, 95%.
+ */
+static void wilson(uint32_t k, uint32_t n, double* centre, double* half) {
+    const double z = 1.96;
+    double p = n ? (double)k / n : 0;
+    double d = 1 + z * z / n;
+    *centre = (p + z * z / (2 * n)) / d;
+    *half = z * sqrt(p * (1 - p) / n + z * z / (4.0 * n * n)) / d;
+}
+
+static void summarise(const game_result_t* results, uint32_t games, double seconds) {
+    uint32_t wins[3] = { 0, 0, 0 };
+    uint32_t* times = malloc(games * sizeof(uint32_t));
+    uint32_t count;
+    uint64_t kills = 0, revives = 0;
+    double total;
+    uint32_t i, t;
+
+    if(!times) {
+        perror("montecarlo");
+        exit(1);
+    }
+
+    for(i = 0; i < games; i++) {
+        wins[results[i].winner]++;
+        kills += results[i].kills;
+        revives += results[i].revives;
+    }
+    for(t = 0; t < 3; t++) {
+        static const char* names[3] = { "cops", "robbers", "draw" };
+        double centre, half;
+        wilson(wins[t], games, &centre, &half);
+        printf("  %-8s %6.2f%%  (95%% CI %5.2f%% .. %5.2f%%)\n", names[t],
+               100.0 * wins[t] / games, 100.0 * (centre - half), 100.0 * (centre + half));
+    }
+
+    /* Time to the first kill, over games that had one; game length over decided games. */
+    for(t = 0; t < 2; t++) {
+        count = 0;
+        total = 0;
+        for(i = 0; i < games; i++) {
+            uint32_t ms = t == 0 ? results[i].first_kill_ms : results[i].duration_ms;
+            if(t == 0 ? ms != 0 : results[i].winner != TEAM_NONE) {
+                times[count++] = ms;
+                total += ms;
+            }
+        }
+        if(count == 0) {
+            printf("  %-12s none\n", t == 0 ? "first kill" : "game length");
+            continue;
+        }
+        qsort(times, count, sizeof(uint32_t), compare_u32);
+        printf("  %-12s mean %7.1f s  median %7.1f s  p90 %7.1f s  (%u games)\n",
+               t == 0 ? "first kill" : "game length",
+               total / count / 1000.0, times[count / 2] / 1000.0, times[count * 9 / 10] / 1000.0, count);
+    }
+    printf("  kills %.2f, revives %.2f per game\n", (double)kills / games, (double)revives / games);
+    printf("  %u games in %.2f s (%.0f games/s)\n", games, seconds, games / seconds);
+    free(times);
+}
+
+static double elapsed(const struct timespec* start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int main(int argc, char** argv) {
+    sim_config_t config;
+    run_t run;
+    uint32_t games = 10000;
+    unsigned threads = Pool_Default_Threads();
+    const char* sweep = NULL;
+    int16_t* swept = NULL;
+    long lo = 0, hi = 0, step = 1, value;
+    int i;
+
+    Sim_Config_Default(&config);
+    run.seed = 1;
+
+    for(i = 1; i < argc; i++) {
+        const char* opt = argv[i];
+        if(strcmp(opt, "-1") == 0) {
+            config.broadcast_all = 0;
+            continue;
+        }
+        if(i + 1 >= argc) usage();
+        if(strcmp(opt, "-n") == 0) games = strtoul(argv[++i], NULL, 0);
+        else if(strcmp(opt, "-j") == 0) threads = strtoul(argv[++i], NULL, 0);
+        else if(strcmp(opt, "-s") == 0) run.seed = strtoull(argv[++i], NULL, 0);
+        else if(strcmp(opt, "-t") == 0) config.timeout_ms = 1000 * strtoul(argv[++i], NULL, 0);
+        else if(strcmp(opt, "-d") == 0) config.radio_delay_ms = strtoul(argv[++i], NULL, 0);
+        else if(strcmp(opt, "-l") == 0) config.radio_loss = atof(argv[++i]);
+        else if(strcmp(opt, "--cop") == 0) set_param(&config.team_params[TEAM_COPS], argv[++i]);
+        else if(strcmp(opt, "--robber") == 0) set_param(&config.team_params[TEAM_ROBBERS], argv[++i]);
+        else if(strcmp(opt, "--sweep") == 0) sweep = argv[++i];
+        else usage();
+    }
+    if(games == 0) usage();
+
+    if(sweep) {
+        const char* eq = strchr(sweep, '=');
+        if(!eq || sscanf(eq + 1, "%ld:%ld:%ld", &lo, &hi, &step) != 3 || step <= 0) usage();
+        swept = find_param(&config.team_params[TEAM_ROBBERS], sweep, eq - sweep);
+    }
+
+    run.config = &config;
+    run.results = malloc(games * sizeof(game_result_t));
+    if(!run.results) {
+        perror("montecarlo");
+        return 1;
+    }
+
+    printf("%u games per configuration on %u threads, seed %llu\n", games, threads, (unsigned long long)run.seed);
+    for(value = lo; value <= hi; value += step) {
+        struct timespec start;
+        if(swept) {
+            *swept = (int16_t)value;
+            printf("%.*s = %ld\n", (int)(strchr(sweep, '=') - sweep), sweep, value);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if(Pool_Run(games, threads, play, &run) != 0) {
+            perror("montecarlo");
+            return 1;
+        }
+        summarise(run.results, games, elapsed(&start));
+    }
+
+    free(run.results);
+    return 0;
+}
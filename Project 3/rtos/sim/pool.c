@@ -0,0 +1,157 @@
+/*
+ * pool.c
+ *
+ * A work-stealing thread pool.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "pool.h"
+
+typedef struct _worker_range {
+    pthread_mutex_t lock;
+    uint32_t begin;
+    uint32_t end;
+} worker_range_t;
+
+typedef struct _pool {
+    worker_range_t* ranges;
+    unsigned threads;
+    pool_job_t job;
+    void* arg;
+} pool_t;
+
+typedef struct _worker {
+    pool_t* pool;
+    unsigned index;
+} worker_t;
+
+/**
+ * Take the next job from the front of our own range.
+ */
+static int take_own(worker_range_t* range, uint32_t* index) {
+    int found = 0;
+    pthread_mutex_lock(&range->lock);
+    if(range->begin < range->end) {
+        *index = range->begin++;
+        found = 1;
+    }
+    pthread_mutex_unlock(&range->lock);
+    return found;
+}
+
+/**
+ * Move the back half of the fullest other range into our own.
+ */
+static int steal(pool_t* pool, unsigned self) {
+    unsigned i;
+    unsigned victim = self;
+    uint32_t most = 0;
+    uint32_t begin, end;
+
+    /* Pick the fullest range; it may shrink before we lock it again below. */
+    for(i = 0; i < pool->threads; i++) {
+        worker_range_t* range = &pool->ranges[i];
+        uint32_t left;
+        if(i == self) continue;
+        pthread_mutex_lock(&range->lock);
+        left = range->end - range->begin;
+        pthread_mutex_unlock(&range->lock);
+        if(left > most) {
+            most = left;
+            victim = i;
+        }
+    }
+    if(victim == self) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&pool->ranges[victim].lock);
+    end = pool->ranges[victim].end;
+    begin = end - (end - pool->ranges[victim].begin + 1) / 2;
+    pool->ranges[victim].end = begin;
+    pthread_mutex_unlock(&pool->ranges[victim].lock);
+
+    if(begin == end) {
+        /* Someone else emptied it first; look again. */
+        return 1;
+    }
+
+    pthread_mutex_lock(&pool->ranges[self].lock);
+    pool->ranges[self].begin = begin;
+    pool->ranges[self].end = end;
+    pthread_mutex_unlock(&pool->ranges[self].lock);
+    return 1;
+}
+
+static void* worker_main(void* arg) {
+    worker_t* worker = (worker_t*)arg;
+    pool_t* pool = worker->pool;
+    uint32_t index;
+
+    for(;;) {
+        while(take_own(&pool->ranges[worker->index], &index)) {
+            pool->job(index, worker->index, pool->arg);
+        }
+        if(!steal(pool, worker->index)) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+unsigned Pool_Default_Threads(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (unsigned)n : 1;
+}
+
+int Pool_Run(uint32_t count, unsigned threads, pool_job_t job, void* arg) {
+    pool_t pool;
+    worker_t* workers;
+    pthread_t* ids;
+    unsigned i, started;
+
+    if(threads == 0) threads = 1;
+    if(threads > count && count > 0) threads = count;
+
+    pool.ranges = calloc(threads, sizeof(worker_range_t));
+    workers = calloc(threads, sizeof(worker_t));
+    ids = calloc(threads, sizeof(pthread_t));
+    if(!pool.ranges || !workers || !ids) {
+        free(pool.ranges);
+        free(workers);
+        free(ids);
+        return -1;
+    }
+    pool.threads = threads;
+    pool.job = job;
+    pool.arg = arg;
+
+    for(i = 0; i < threads; i++) {
+        pthread_mutex_init(&pool.ranges[i].lock, NULL);
+        pool.ranges[i].begin = (uint32_t)((uint64_t)count * i / threads);
+        pool.ranges[i].end = (uint32_t)((uint64_t)count * (i + 1) / threads);
+        workers[i].pool = &pool;
+        workers[i].index = i;
+    }
+
+    /* Worker 0 runs on the calling thread, and steals the range of any worker that failed to start. */
+    for(started = 1; started < threads; started++) {
+        if(pthread_create(&ids[started], NULL, worker_main, &workers[started]) != 0) {
+            break;
+        }
+    }
+    worker_main(&workers[0]);
+    for(i = 1; i < started; i++) {
+        pthread_join(ids[i], NULL);
+    }
+
+    for(i = 0; i < threads; i++) {
+        pthread_mutex_destroy(&pool.ranges[i].lock);
+    }
+    free(pool.ranges);
+    free(workers);
+    free(ids);
+    return 0;
+}
@@ -0,0 +1,28 @@
+/*
+ * pool.h
+ *
+ * A work-stealing thread pool for running many independent jobs.
+ *
+ * The jobs 0..count-1 are split into one contiguous range per worker.  A worker runs jobs from
+ * the front of its own range; once that is empty it steals the back half of the largest range
+ * left, so long games on one worker do not hold up the whole run.
+ */
+
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <stdint.h>
+
+/** A job: run job number index on the given worker (0..threads-1). */
+typedef void (*pool_job_t)(uint32_t index, unsigned worker, void* arg);
+
+/** The number of online processors, at least 1. */
+unsigned Pool_Default_Threads(void);
+
+/**
+ * Run jobs 0..count-1 on threads workers and return once all of them finished.
+ * Returns 0 on success, -1 if out of memory.
+ */
+int Pool_Run(uint32_t count, unsigned threads, pool_job_t job, void* arg);
+
+#endif /* POOL_H_ */
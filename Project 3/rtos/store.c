@@ -0,0 +1,345 @@
+/**
+ * @file   store.c
+ *
+ * @brief A wear-levelled key-value store in EEPROM, see store.h.
+ *
+ * Each record is 6 bytes: the key with the lap bit on top, the value (least significant byte
+ * first), and a check byte.  The writer fills the ring from the start, flipping the lap bit
+ * each time it wraps around, so the records up to the first change of lap bit are the newest.
+ * Before the writer passes over the record that holds the current value of a key, it writes
+ * that key again, so every key always has a record in the ring.
+ */
+
+#include <stddef.h>
+#include <avr/io.h>
+#include <avr/eeprom.h>
+#include "store.h"
+#include "os.h"
+#include "kernel.h"
+#include "irq_profile.h"
+
+#if STORE_ENABLE
+
+#define RECORD_SIZE     6
+#define RECORD_COUNT    (STORE_EEPROM_SIZE / RECORD_SIZE)
+#define RECORD_ADDRESS(slot)    (STORE_EEPROM_START + (uint16_t)(slot) * RECORD_SIZE)
+
+#define LAP_BIT         0x80
+#define KEY_MASK        0x7F
+/** The key of an erased record. */
+#define KEY_EMPTY       0x7F
+
+#define NO_SLOT         0xFFFF
+
+/** The value has changed since it was last written. */
+#define ENTRY_DIRTY     0x01
+/** The value is waiting to be written. */
+#define ENTRY_QUEUED    0x02
+
+typedef struct
+{
+    uint8_t key;
+    uint8_t flags;
+    /** The record holding the value in EEPROM, or NO_SLOT. */
+    uint16_t slot;
+    int32_t value;
+} entry_t;
+
+static entry_t entries[STORE_MAX_KEYS];
+static uint8_t entry_count;
+
+/** Where the next record goes, and its lap bit. */
+static uint16_t head;
+static uint8_t lap;
+
+/** The record being written, one byte a TICK. */
+static uint8_t record[RECORD_SIZE];
+static uint8_t record_written = RECORD_SIZE;
+
+static uint16_t checkpoint = STORE_CHECKPOINT;
+
+static entry_t* find_entry(uint8_t key)
+{
+    uint8_t i;
+    for(i = 0; i < entry_count; ++i)
+    {
+        if(entries[i].key == key)
+        {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+static entry_t* add_entry(uint8_t key)
+{
+    entry_t* entry = find_entry(key);
+    if(entry == NULL && entry_count < STORE_MAX_KEYS && key <= STORE_KEY_MAX)
+    {
+        entry = &entries[entry_count++];
+        entry->key = key;
+        entry->flags = 0;
+        entry->slot = NO_SLOT;
+        entry->value = 0;
+    }
+    return entry;
+}
+
+static uint8_t record_check(const uint8_t* bytes)
+{
+    uint8_t i, sum = 0;
+    for(i = 0; i < RECORD_SIZE - 1; ++i)
+    {
+        sum += bytes[i];
+    }
+    return ~sum;
+}
+
+void Store_Init(void)
+{
+    uint8_t bytes[RECORD_SIZE];
+    uint8_t first_lap;
+    uint16_t slot, i;
+
+    /* The newest records are those before the first change of lap bit. */
+    first_lap = eeprom_read_byte((const uint8_t*)RECORD_ADDRESS(0)) & LAP_BIT;
+    head = 0;
+    lap = first_lap ^ LAP_BIT;
+    for(slot = 1; slot < RECORD_COUNT; ++slot)
+    {
+        if((eeprom_read_byte((const uint8_t*)RECORD_ADDRESS(slot)) & LAP_BIT) != first_lap)
+        {
+            head = slot;
+            lap = first_lap;
+            break;
+        }
+    }
+
+    /* Replay the records oldest first, so the newest value of each key wins. */
+    for(i = 0; i < RECORD_COUNT; ++i)
+    {
+        entry_t* entry;
+
+        slot = (head + i) % RECORD_COUNT;
+        eeprom_read_block(bytes, (const void*)RECORD_ADDRESS(slot), RECORD_SIZE);
+        if((bytes[0] & KEY_MASK) == KEY_EMPTY || bytes[RECORD_SIZE - 1] != record_check(bytes))
+        {
+            continue;
+        }
+        entry = add_entry(bytes[0] & KEY_MASK);
+        if(entry != NULL)
+        {
+            entry->value = (int32_t)((uint32_t)bytes[1] | (uint32_t)bytes[2] << 8 |
+                                     (uint32_t)bytes[3] << 16 | (uint32_t)bytes[4] << 24);
+            entry->slot = slot;
+        }
+    }
+
+    /* Count the boot straight away, in case this run does not last until a checkpoint. */
+    Store_Add(STORE_KEY_BOOTS, 1);
+    Store_Flush();
+}
+
+int32_t Store_Get(uint8_t key, int32_t value)
+{
+    uint8_t sreg = SREG;
+    entry_t* entry;
+
+    Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
+    entry = find_entry(key);
+    if(entry != NULL)
+    {
+        value = entry->value;
+    }
+    IRQ_PROFILE_RESTORE(sreg);
+    SREG = sreg;
+    return value;
+}
+
+uint8_t Store_Set(uint8_t key, int32_t value)
+{
+    uint8_t sreg = SREG;
+    entry_t* entry;
+
+    Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
+    entry = add_entry(key);
+    if(entry != NULL && (entry->value != value || entry->slot == NO_SLOT))
+    {
+        entry->value = value;
+        entry->flags |= ENTRY_DIRTY;
+    }
+    IRQ_PROFILE_RESTORE(sreg);
+    SREG = sreg;
+    return entry != NULL;
+}
+
+void Store_Add(uint8_t key, int32_t delta)
+{
+    uint8_t sreg = SREG;
+    entry_t* entry;
+
+    Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
+    entry = add_entry(key);
+    if(entry != NULL && delta != 0)
+    {
+        entry->value += delta;
+        entry->flags |= ENTRY_DIRTY;
+    }
+    IRQ_PROFILE_RESTORE(sreg);
+    SREG = sreg;
+}
+
+void Store_Flush(void)
+{
+    uint8_t sreg = SREG;
+    uint8_t i;
+
+    Disable_Interrupt();
+    IRQ_PROFILE_DISABLE();
+    for(i = 0; i < entry_count; ++i)
+    {
+        if(entries[i].flags & ENTRY_DIRTY)
+        {
+            entries[i].flags = ENTRY_QUEUED;
+        }
+    }
+    IRQ_PROFILE_RESTORE(sreg);
+    SREG = sreg;
+}
+
+/**
+ * Start the next record: the key whose record is about to be written over, if any,
+ * otherwise a queued key.  Returns 0 if there is nothing to write.
+ */
+static uint8_t start_record(void)
+{
+    entry_t* entry = NULL;
+    uint8_t i;
+
+    for(i = 0; i < entry_count; ++i)
+    {
+        if(entries[i].slot == head)
+        {
+            entry = &entries[i];
+            break;
+        }
+    }
+    if(entry == NULL)
+    {
+        for(i = 0; i < entry_count && entry == NULL; ++i)
+        {
+            if(entries[i].flags & ENTRY_QUEUED)
+            {
+                entry = &entries[i];
+            }
+        }
+        if(entry == NULL)
+        {
+            return 0;
+        }
+    }
+    else
+    {
+        /* Only move a key for the sake of a queued one. */
+        for(i = 0; i < entry_count && !(entries[i].flags & ENTRY_QUEUED); ++i);
+        if(i == entry_count)
+        {
+            return 0;
+        }
+    }
+
+    record[0] = entry->key | lap;
+    record[1] = (uint8_t)entry->value;
+    record[2] = (uint8_t)(entry->value >> 8);
+    record[3] = (uint8_t)(entry->value >> 16);
+    record[4] = (uint8_t)(entry->value >> 24);
+    record[RECORD_SIZE - 1] = record_check(record);
+    record_written = 0;
+
+    entry->flags = 0;
+    entry->slot = head;
+    return 1;
+}
+
+/**
+ * Start writing one byte, unless the EEPROM already holds it.  Interrupts are disabled.
+ */
+static void write_byte(uint16_t address, uint8_t value)
+{
+    EEAR = address;
+    EECR |= _BV(EERE);
+    if(EEDR == value)
+    {
+        return;
+    }
+    EEDR = value;
+    EECR |= _BV(EEMPE);
+    EECR |= _BV(EEPE);
+}
+
+void Store_Tick(void)
+{
+    if(--checkpoint == 0)
+    {
+        checkpoint = STORE_CHECKPOINT;
+        Store_Add(STORE_KEY_UPTIME, (int32_t)STORE_CHECKPOINT * OS_Tick_Us() / 1000000);
+        Store_Flush();
+    }
+
+    /* One byte a TICK, and only once the last one is done. */
+    if(EECR & _BV(EEPE))
+    {
+        return;
+    }
+    if(record_written == RECORD_SIZE && !start_record())
+    {
+        return;
+    }
+    write_byte(RECORD_ADDRESS(head) + record_written, record[record_written]);
+    if(++record_written == RECORD_SIZE)
+    {
+        if(++head == RECORD_COUNT)
+        {
+            head = 0;
+            lap ^= LAP_BIT;
+        }
+    }
+}
+
+#else
+
+void Store_Init(void)
+{
+}
+
+int32_t Store_Get(uint8_t key, int32_t value)
+{
+    (void)key;
+    return value;
+}
+
+uint8_t Store_Set(uint8_t key, int32_t value)
+{
+    (void)key;
+    (void)value;
+    return 0;
+}
+
+void Store_Add(uint8_t key, int32_t delta)
+{
+    (void)key;
+    (void)delta;
+}
+
+void Store_Flush(void)
+{
+}
+
+void Store_Tick(void)
+{
+}
+
+#endif
@@ -0,0 +1,96 @@
+/**
+ * @file   store.h
+ *
+ * @brief A small key-value store in EEPROM for settings and statistics.
+ *
+ * Values live in a RAM cache, loaded from EEPROM by OS_Init() before r_main() runs, so
+ * Store_Get() is as cheap as reading a variable.  Store_Set() and Store_Add() only change the
+ * cache; changed values are written back by the kernel at the next checkpoint, every
+ * STORE_CHECKPOINT TICKs, however often they changed in between.
+ *
+ * The EEPROM region is a ring of records written one after the other, so every cell is
+ * written once per trip around the ring rather than once per change of a value.  The kernel
+ * writes at most one byte per TICK, starting it only when the previous byte is done, so the
+ * store never makes a task or the tick wait for the EEPROM.
+ *
+ * With a 2 KB region (341 records) and 8 values changing every checkpoint, each cell is
+ * written about once every 40 minutes: the 100,000 writes the EEPROM is rated for last
+ * about 8 years.
+ *
+ * If the power fails part way through a record, only the value in that record is lost.
+ */
+
+#ifndef STORE_H_
+#define STORE_H_
+
+#include <stdint.h>
+#include <avr/io.h>
+
+/** Set to 0 to leave the EEPROM alone; Store_Get() then always returns the default. */
+#define STORE_ENABLE        1
+
+/** The EEPROM region used by the store.  The crash snapshot sits at the end of EEPROM. */
+#define STORE_EEPROM_START  0
+#if E2END + 1 >= 4096
+#define STORE_EEPROM_SIZE   2048
+#else
+#define STORE_EEPROM_SIZE   ((E2END + 1) / 2)
+#endif
+
+/** Number of keys the RAM cache holds. */
+#define STORE_MAX_KEYS      16
+
+/** TICKs between checkpoints (1 minute at the default TICK). */
+#define STORE_CHECKPOINT    12000
+
+/** Keys are 0 to STORE_KEY_MAX.  The kernel and drivers use keys below STORE_KEY_APP. */
+#define STORE_KEY_MAX               126
+
+#define STORE_KEY_BOOTS             0   /* times OS_Init() has run */
+#define STORE_KEY_UPTIME            1   /* seconds run, counted at checkpoints */
+#define STORE_KEY_DISPATCHES        2   /* times the kernel switched tasks */
+#define STORE_KEY_RADIO_TX          3   /* packets acknowledged */
+#define STORE_KEY_RADIO_TX_FAILED   4   /* packets dropped after the last retry */
+#define STORE_KEY_RADIO_RX          5   /* receive interrupts */
+#define STORE_KEY_RADIO_RETRY       6   /* setting: SETUP_RETR register of the radio */
+#define STORE_KEY_RADIO_RESENT      7   /* retransmissions, of packets sent or dropped */
+#define STORE_KEY_TELEMETRY_PERIOD  8   /* setting: ms between telemetry digests, see telemetry.h */
+#define STORE_KEY_TICK_US           9   /* setting: us per TICK, read by OS_Init() */
+
+/** First key for applications. */
+#define STORE_KEY_APP               32
+
+/**
+ * Load the cache from EEPROM and count a boot.  Called by OS_Init().
+ */
+void Store_Init(void);
+
+/**
+ * \param key the key
+ * \param value returned if the key has never been set
+ * \return the value of the key.
+ */
+int32_t Store_Get(uint8_t key, int32_t value);
+
+/**
+ * Change the value of a key.  It is written to EEPROM at the next checkpoint.
+ * \return 0 if the key is out of range or the cache is full; otherwise non-zero.
+ */
+uint8_t Store_Set(uint8_t key, int32_t value);
+
+/**
+ * Add to the value of a key, starting from 0.  Safe to call from an interrupt.
+ */
+void Store_Add(uint8_t key, int32_t delta);
+
+/**
+ * Write changed values without waiting for the next checkpoint, still one byte a TICK.
+ */
+void Store_Flush(void);
+
+/**
+ * Called by the kernel every TICK, with interrupts disabled.
+ */
+void Store_Tick(void);
+
+#endif /* STORE_H_ */
@@ -0,0 +1,201 @@
+/**
+ * @file   telemetry.c
+ *
+ * @brief Roombas report the health of their kernel and radio to the base station.  See telemetry.h.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include "telemetry.h"
+#include "os.h"
+#include "store.h"
+#include "shell.h"
+#include "irq_profile.h"
+#include "flash.h"
+
+/*
+ * Roomba
+ */
+
+/** The readings the last digest was made from. */
+static uint32_t task_time[MAXPROCESS + 1];
+static int32_t radio_sent;
+static int32_t radio_dropped;
+static int32_t radio_resent;
+static uint8_t sequence;
+static uint16_t digest_time;
+
+/**
+ * \return part as a percentage of whole, at most 255.
+ */
+static uint8_t percent(uint32_t part, uint32_t whole)
+{
+    uint32_t value;
+
+    if(whole == 0)
+    {
+        return 0;
+    }
+    /* Keep part * 100 within 32 bits. */
+    while(whole > 0x00FFFFFF || part > 0x00FFFFFF)
+    {
+        whole >>= 8;
+        part >>= 8;
+    }
+    value = part * 100 / (whole == 0 ? 1 : whole);
+    return value > 255 ? 255 : value;
+}
+
+uint8_t Telemetry_Due(void)
+{
+    uint16_t period = (uint16_t)Store_Get(STORE_KEY_TELEMETRY_PERIOD, TELEMETRY_PERIOD);
+    return period != 0 && (uint16_t)(Now() - digest_time) >= period;
+}
+
+void Telemetry_Fill(pf_telemetry_t* digest)
+{
+    task_info_t info;
+    periodic_stats_t stats;
+    uint32_t elapsed = 0, idle = 0;
+    int32_t sent, dropped, resent;
+    uint16_t margin = 0xFFFF;
+    uint8_t i;
+
+    digest->stack_task = 0;
+    for(i = 0; i <= MAXPROCESS; ++i)
+    {
+        OS_Task_Info(i, &info);
+        info.run_time -= task_time[i];
+        task_time[i] += info.run_time;
+        elapsed += info.run_time;
+        if(i == MAXPROCESS)
+        {
+            idle = info.run_time;
+        }
+        else if(info.stack_free < margin)
+        {
+            margin = info.stack_free;
+            digest->stack_task = i;
+        }
+    }
+
+    OS_Periodic_Stats(&stats);
+
+    sent = Store_Get(STORE_KEY_RADIO_TX, 0) - radio_sent;
+    dropped = Store_Get(STORE_KEY_RADIO_TX_FAILED, 0) - radio_dropped;
+    resent = Store_Get(STORE_KEY_RADIO_RESENT, 0) - radio_resent;
+    radio_sent += sent;
+    radio_dropped += dropped;
+    radio_resent += resent;
+
+    digest->sequence = ++sequence;
+    digest->cpu_load = elapsed == 0 ? 0 : 100 - percent(idle, elapsed);
+    digest->worst_response = stats.worst_response;
+    digest->overruns = stats.overruns;
+    digest->radio_resent = percent(resent, sent + dropped);
+    digest->radio_dropped = percent(dropped, sent + dropped);
+    digest->stack_margin = margin > 255 ? 255 : margin;
+
+    digest_time = Now();
+}
+
+/*
+ * Base station
+ */
+
+typedef struct
+{
+    /** The last digest. */
+    pf_telemetry_t last;
+    /** Now() when it arrived. */
+    uint16_t heard;
+    uint16_t digests;
+    /** Digests missed, by the gaps in their sequence numbers. */
+    uint16_t lost;
+    /** The worst values in any digest. */
+    uint16_t worst_response;
+    uint8_t stack_margin;
+} fleet_entry_t;
+
+static fleet_entry_t fleet[TELEMETRY_ROOMBAS];
+
+void Telemetry_Record(uint8_t roomba, const pf_telemetry_t* digest)
+{
+    fleet_entry_t* entry;
+
+    if(roomba >= TELEMETRY_ROOMBAS)
+    {
+        return;
+    }
+    entry = &fleet[roomba];
+
+    if(entry->digests == 0)
+    {
+        entry->stack_margin = digest->stack_margin;
+    }
+    else if(digest->sequence == entry->last.sequence)
+    {
+        entry->heard = Now();
+        return;
+    }
+    else
+    {
+        entry->lost += (uint8_t)(digest->sequence - entry->last.sequence - 1);
+    }
+
+    ++entry->digests;
+    entry->last = *digest;
+    entry->heard = Now();
+    if(digest->worst_response > entry->worst_response)
+    {
+        entry->worst_response = digest->worst_response;
+    }
+    if(digest->stack_margin < entry->stack_margin)
+    {
+        entry->stack_margin = digest->stack_margin;
+    }
+}
+
+/**
+ * The shell's 'f' command.  Ages wrap around after 65 s.
+ */
+static void print_fleet(void)
+{
+    fleet_entry_t entry;
+    uint8_t i;
+
+    Shell_Print_P(PSTR("roomba  age s  load%  resp ms  worst  overruns  resent%  dropped%  stack  min  digests  lost\r\n"));
+    for(i = 0; i < TELEMETRY_ROOMBAS; ++i)
+    {
+        /* Copy it, the radio task may be writing it. */
+        uint8_t sreg = SREG;
+        cli();
+        IRQ_PROFILE_DISABLE();
+        entry = fleet[i];
+        IRQ_PROFILE_RESTORE(sreg);
+        SREG = sreg;
+
+        if(entry.digests == 0)
+        {
+            continue;
+        }
+        Shell_Print_Number(i, 6);
+        Shell_Print_Number((uint16_t)(Now() - entry.heard) / 1000, 7);
+        Shell_Print_Number(entry.last.cpu_load, 7);
+        Shell_Print_Number(entry.last.worst_response, 9);
+        Shell_Print_Number(entry.worst_response, 7);
+        Shell_Print_Number(entry.last.overruns, 10);
+        Shell_Print_Number(entry.last.radio_resent, 9);
+        Shell_Print_Number(entry.last.radio_dropped, 10);
+        Shell_Print_Number(entry.last.stack_margin, 7);
+        Shell_Print_Number(entry.stack_margin, 5);
+        Shell_Print_Number(entry.digests, 9);
+        Shell_Print_Number(entry.lost, 6);
+        Shell_Print_P(PSTR("\r\n"));
+    }
+}
+
+void Telemetry_Init(void)
+{
+    Shell_Add_Command('f', "fleet", print_fleet);
+}
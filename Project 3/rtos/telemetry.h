@@ -0,0 +1,56 @@
+/**
+ * @file   telemetry.h
+ *
+ * @brief Roombas report the health of their kernel and radio to the base station.
+ *
+ * Every ROOMBASTATE_PACKET a roomba sends carries a pf_telemetry_t digest (packet.h) in bytes
+ * that used to be padding, so a digest costs no airtime of its own.  A roomba that has had
+ * nothing to report for the telemetry period answers the next gamestate from the base station
+ * with its state anyway: the base station has just finished its own transmission, so the
+ * channel is quiet.  Deaths and revives are sent at once as before, with a digest on board.
+ *
+ * The base station keeps the last digest from each roomba and the worst values seen, and
+ * prints them with the shell's 'f' command.
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <stdint.h>
+#include "packet.h"
+
+/** Default ms between digests; STORE_KEY_TELEMETRY_PERIOD overrides it, 0 turns them off. */
+#define TELEMETRY_PERIOD    2000
+
+/** Roombas the base station keeps digests for. */
+#define TELEMETRY_ROOMBAS   4
+
+/*
+ * Roomba
+ */
+
+/**
+ * \return non-zero if the roomba should send its state to carry a digest.
+ */
+uint8_t Telemetry_Due(void);
+
+/**
+ * Fill in a digest of the time since the last one.  Cheap enough for a SYSTEM task.
+ */
+void Telemetry_Fill(pf_telemetry_t* digest);
+
+/*
+ * Base station
+ */
+
+/**
+ * Add the 'f' (fleet) command to the shell.  Call from r_main().
+ */
+void Telemetry_Init(void);
+
+/**
+ * Keep a digest received from a roomba.
+ */
+void Telemetry_Record(uint8_t roomba, const pf_telemetry_t* digest);
+
+#endif /* TELEMETRY_H_ */
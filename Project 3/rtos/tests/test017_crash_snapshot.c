@@ -0,0 +1,52 @@
+#include <avr/io.h>
+#include <util/delay.h>
+#include "port_map.h"
+#include "os.h"
+#include "kernel.h"
+#include "error_code.h"
+
+/*
+ * This test is designed to prove that OS_Abort() saves a crash snapshot to
+ * EEPROM that can be read back after a reset.
+ */
+
+/* ---- TRACE ----
+ * First boot, no snapshot:
+ * Defaults all testing output ports
+ * Creates 1 periodic task
+ * tick 0-0ms task: toggle port 0 on, runs past worst case execution;
+ * ERROR: OS should stop, and begin dispaying error output.
+ *
+ * After a reset:
+ * Defaults all testing output ports
+ * Snapshot found: ports 1 to 4 show the error code (ERR_RUN_3_PERIODIC_TOOK_TOO_LONG = 4),
+ * port 5 on if the running task was the periodic task (descriptor 1, r_main is 0),
+ * port 6 on if the periodic task's stack was used.
+ * The snapshot is cleared, so a second reset crashes again.
+ */
+
+void task(){
+    for(;;){
+        EnablePort0();
+    }
+}
+
+int r_main(){
+    crash_snapshot_t snapshot;
+
+    DefaultPorts();
+    if(OS_Crash_Read(&snapshot)) {
+        PORT_OUT |= (snapshot.error & 0x0F) << PORT_PIN1;
+        if(snapshot.task == 1) {
+            EnablePort5();
+        }
+        if(snapshot.tasks[1].stack_free < MAXSTACK) {
+            EnablePort6();
+        }
+        OS_Crash_Clear();
+        return 0;
+    }
+
+    Task_Create_Periodic(task, 0, 10, 5, 0);
+    return 0;
+}
@@ -0,0 +1,47 @@
+#include <avr/io.h>
+#include <util/delay.h>
+#include "port_map.h"
+#include "os.h"
+#include "kernel.h"
+#include "store.h"
+
+/*
+ * This test is designed to prove that values in the store are written to
+ * EEPROM in the background and read back after a reset.
+ */
+
+#define TEST_KEY (STORE_KEY_APP + 0)
+
+/* ---- TRACE ----
+ * Every boot:
+ * Defaults all testing output ports
+ * ports 1 to 3 show the number of boots so far (STORE_KEY_BOOTS, counted by OS_Init)
+ * port 4 on if the test key was saved by an earlier boot
+ * Adds 1 to the test key and flushes it.  The boot count and the test key are
+ * written one byte a TICK, 12 TICKs in all.
+ * Creates 1 periodic task
+ * tick 0-95ms task: waits for the records to be written
+ * tick 100ms task: toggle port 0 on, reset now to see the saved value
+ */
+
+void task(){
+    uint8_t i;
+    for(i = 0; i < 20; ++i){
+        Task_Next();
+    }
+    EnablePort0();
+    Task_Terminate();
+}
+
+int r_main(){
+    DefaultPorts();
+    PORT_OUT |= (Store_Get(STORE_KEY_BOOTS, 0) & 0x07) << PORT_PIN1;
+    if(Store_Get(TEST_KEY, 0) > 0) {
+        EnablePort4();
+    }
+    Store_Add(TEST_KEY, 1);
+    Store_Flush();
+
+    Task_Create_Periodic(task, 0, 1, 1, 0);
+    return 0;
+}
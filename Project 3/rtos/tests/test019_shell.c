@@ -0,0 +1,47 @@
+#include <avr/io.h>
+#include <util/delay.h>
+#include "port_map.h"
+#include "os.h"
+#include "kernel.h"
+#include "shell.h"
+
+/*
+ * This test is designed to prove that the shell does not disturb the timing
+ * of periodic tasks.  Connect a terminal to UART0 at SHELL_BAUD and press 't'.
+ */
+
+/* ---- TRACE ----
+ * Defaults all testing output ports
+ * Creates 1 periodic task, 1 rr task and the shell
+ * every 10ms task: toggle port 0 on, busy for 2ms, toggle port 0 off;
+ * rr task: toggles port 1 on and off, busy for 1ms each time.
+ * Port 0 should rise every 10ms, before and after 't' is pressed;
+ * "top" should show the periodic task near 20%, the rr task taking the
+ * rest and the shell near 0%, and redraw once a second.
+ */
+
+void periodic_task(){
+    for(;;){
+        EnablePort0();
+        _delay_ms(2);
+        DisablePort0();
+        Task_Next();
+    }
+}
+
+void rr_task(){
+    for(;;){
+        EnablePort1();
+        _delay_ms(1);
+        DisablePort1();
+        _delay_ms(1);
+    }
+}
+
+int r_main(){
+    DefaultPorts();
+    Task_Create_Periodic(periodic_task, 0, 2, 1, 0);
+    Task_Create_RR(rr_task, 0);
+    Shell_Init();
+    return 0;
+}
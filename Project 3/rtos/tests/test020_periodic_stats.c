@@ -0,0 +1,69 @@
+#include <avr/io.h>
+#include <util/delay.h>
+#include "port_map.h"
+#include "os.h"
+#include "kernel.h"
+
+/*
+ * This test is designed to prove that the kernel measures the response time
+ * of periodic tasks and counts the activations stretched past their wcet.
+ */
+
+/* ---- TRACE ----
+ * Defaults all testing output ports
+ * Creates 1 periodic task, 1 system task and 1 rr task
+ * every 20ms periodic: toggle port 0 on, busy for 7ms, toggle port 0 off;
+ *   wcet is 2 TICKs, so it finishes 7ms after its release.
+ * at 500ms periodic: publishes to the system task first, which preempts it
+ *   and is busy for 6ms, so this activation finishes after 13ms, past its wcet.
+ * at 1000ms rr: reads the statistics;
+ *   port 1 on if the worst response was at least 12ms,
+ *   port 2 on if exactly 1 activation overran.
+ */
+
+service_t* service;
+
+void periodic_task(){
+    uint8_t activation = 0;
+    for(;;){
+        if(++activation == 26){
+            Service_Publish(service, 0);
+        }
+        EnablePort0();
+        _delay_ms(7);
+        DisablePort0();
+        Task_Next();
+    }
+}
+
+void system_task(){
+    int16_t value;
+    Service_Subscribe(service, &value);
+    EnablePort3();
+    _delay_ms(6);
+    DisablePort3();
+}
+
+void rr_task(){
+    periodic_stats_t stats;
+
+    while(Now() < 1000){
+        Task_Next();
+    }
+    OS_Periodic_Stats(&stats);
+    if(stats.worst_response >= 12){
+        EnablePort1();
+    }
+    if(stats.overruns == 1){
+        EnablePort2();
+    }
+}
+
+int r_main(){
+    DefaultPorts();
+    service = Service_Init();
+    Task_Create_Periodic(periodic_task, 0, 4, 2, 0);
+    Task_Create_System(system_task, 0);
+    Task_Create_RR(rr_task, 0);
+    return 0;
+}
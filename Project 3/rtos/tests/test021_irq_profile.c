@@ -0,0 +1,69 @@
+#include <avr/io.h>
+#include <util/delay.h>
+#include "port_map.h"
+#include "os.h"
+#include "kernel.h"
+#include "shell.h"
+#include "irq_profile.h"
+
+/*
+ * This test is designed to prove that the profiler finds the longest
+ * windows with interrupts disabled.  Build everything with -DIRQ_PROFILE=1,
+ * connect a terminal to UART0 at SHELL_BAUD and press 'w'.
+ */
+
+/* ---- TRACE ----
+ * Defaults all testing output ports
+ * Creates 1 periodic task, 1 rr task and the shell
+ * every 10ms task: toggle port 0 on, busy for 1ms, toggle port 0 off;
+ * rr task: disables interrupts for 3ms with port 1 on, then for 1ms
+ * with port 2 on.
+ * Port 0 should rise late by up to 3ms while port 1 is on;
+ * 'w' should list this file's two windows first, near 3000 and 1000 us,
+ * ahead of the kernel's own windows of a few tens of us.
+ */
+
+void periodic_task(){
+    for(;;){
+        EnablePort0();
+        _delay_ms(1);
+        DisablePort0();
+        Task_Next();
+    }
+}
+
+void rr_task(){
+    uint8_t sreg;
+
+    for(;;){
+        sreg = SREG;
+        Disable_Interrupt();
+        IRQ_PROFILE_DISABLE();
+        EnablePort1();
+        _delay_ms(3);
+        DisablePort1();
+        IRQ_PROFILE_RESTORE(sreg);
+        SREG = sreg;
+
+        _delay_ms(5);
+
+        sreg = SREG;
+        Disable_Interrupt();
+        IRQ_PROFILE_DISABLE();
+        EnablePort2();
+        _delay_ms(1);
+        DisablePort2();
+        IRQ_PROFILE_RESTORE(sreg);
+        SREG = sreg;
+
+        _delay_ms(5);
+    }
+}
+
+int r_main(){
+    DefaultPorts();
+    Task_Create_Periodic(periodic_task, 0, 2, 1, 0);
+    Task_Create_RR(rr_task, 0);
+    Shell_Init();
+    return 0;
+}
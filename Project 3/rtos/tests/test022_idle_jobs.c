@@ -0,0 +1,79 @@
+#include <avr/io.h>
+#include <util/delay.h>
+#include "port_map.h"
+#include "os.h"
+#include "kernel.h"
+
+/*
+ * This test is designed to prove that background jobs only use the CPU
+ * left over by real tasks, and run in the order they were submitted.
+ */
+
+/* ---- TRACE ----
+ * Defaults all testing output ports
+ * Creates 1 periodic task and 1 rr task, and submits 2 background jobs
+ * every 10ms periodic: toggle port 0 on, busy for 2ms, toggle port 0 off,
+ *   every 5th time wakes the rr task and every 10th time submits job 3.
+ * rr task: waits for the periodic task, then toggles port 1 on for 1ms.
+ * jobs 1 and 2: port 2 on, busy for 30ms, port 2 off, then submit themselves
+ *   again; port 3 is on while job 2 runs.
+ * job 3: toggles port 4 once.
+ * Port 0 should rise every 10ms regardless of the jobs; port 1 pulses
+ * whenever the rr task runs; port 2 is only high while ports 0 and 1 are low,
+ * and port 4 toggles about every 100ms, after the job in front of it finishes.
+ */
+
+void spin_job(int16_t arg){
+    EnablePort2();
+    if(arg == 2){
+        EnablePort3();
+    }
+    _delay_ms(30);
+    DisablePort3();
+    DisablePort2();
+    Idle_Submit(spin_job, arg);
+}
+
+void toggle_job(int16_t arg){
+    (void)arg;
+    PORT_OUT ^= _BV(PORT_PIN4);
+}
+
+service_t* service;
+
+void periodic_task(){
+    uint8_t activation = 0;
+    for(;;){
+        EnablePort0();
+        _delay_ms(2);
+        DisablePort0();
+        if(activation % 5 == 4){
+            Service_Publish(service, 0);
+        }
+        if(++activation == 10){
+            activation = 0;
+            Idle_Submit(toggle_job, 0);
+        }
+        Task_Next();
+    }
+}
+
+void rr_task(){
+    int16_t value;
+    for(;;){
+        Service_Subscribe(service, &value);
+        EnablePort1();
+        _delay_ms(1);
+        DisablePort1();
+    }
+}
+
+int r_main(){
+    DefaultPorts();
+    service = Service_Init();
+    Idle_Submit(spin_job, 1);
+    Idle_Submit(spin_job, 2);
+    Task_Create_Periodic(periodic_task, 0, 2, 1, 0);
+    Task_Create_RR(rr_task, 0);
+    return 0;
+}
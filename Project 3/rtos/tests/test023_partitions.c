@@ -0,0 +1,60 @@
+#include <avr/io.h>
+#include <util/delay.h>
+#include "port_map.h"
+#include "os.h"
+#include "kernel.h"
+
+/*
+ * This test is designed to prove that a SYSTEM task that never yields
+ * cannot take the CPU from the tasks of another partition.
+ */
+
+/* ---- TRACE ----
+ * Defaults all testing output ports
+ * Creates 1 periodic task and 1 rr task in partition 0, and 1 system task
+ *   in partition 1; the major frame is 20ms of partition 0, then 10ms of
+ *   partition 1.
+ * every 30ms periodic: toggle port 0 on, busy for 2ms, toggle port 0 off;
+ *   released at the start of each of partition 0's windows.
+ * rr task: toggles port 1 as fast as it can.
+ * system task: toggles port 2 as fast as it can, and never yields.
+ * Port 0 should rise every 30ms; port 1 should toggle for the rest of
+ * partition 0's 20ms and stop for 10ms, while port 2 toggles only in
+ * those 10ms.
+ */
+
+void periodic_task(){
+    for(;;){
+        EnablePort0();
+        _delay_ms(2);
+        DisablePort0();
+        Task_Next();
+    }
+}
+
+void rr_task(){
+    for(;;){
+        EnablePort1();
+        DisablePort1();
+    }
+}
+
+void system_task(){
+    for(;;){
+        EnablePort2();
+        DisablePort2();
+    }
+}
+
+int r_main(){
+    DefaultPorts();
+    Task_Create_Periodic(periodic_task, 0, 6, 2, 1);
+    Task_Create_RR(rr_task, 0);
+
+    Partition_Select(1);
+    Task_Create_System(system_task, 0);
+
+    Partition_Add_Window(0, 4);
+    Partition_Add_Window(1, 2);
+    return 0;
+}
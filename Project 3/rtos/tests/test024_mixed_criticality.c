@@ -0,0 +1,68 @@
+#include <avr/io.h>
+#include <util/delay.h>
+#include "port_map.h"
+#include "os.h"
+#include "kernel.h"
+
+/*
+ * This test is designed to prove that a HI task running past its optimistic
+ * wcet puts the LO tasks aside instead of failing, and that they run again
+ * once no HI task is ready.
+ */
+
+/* ---- TRACE ----
+ * Defaults all testing output ports
+ * Creates 1 HI periodic task, and 1 LO periodic task and 1 LO rr task
+ * every 50ms HI task: toggle port 0 on, busy for 3ms, toggle port 0 off;
+ *   every 4th time it is busy for 12ms instead, with port 3 on, past its
+ *   wcet of 1 tick but within its wcet_hi of 3.
+ * every 50ms LO task: toggle port 1 on, busy for 1ms, toggle port 1 off;
+ *   released 10ms after the HI task.
+ * rr task: toggles port 2 as fast as it can.
+ * Port 0 should rise every 50ms.  While port 3 is on, port 2 stops and the
+ * LO task's next rise is skipped; port 2 toggles again as soon as port 0
+ * falls, and port 1 rises on time in the following period.
+ */
+
+void hi_task(){
+    uint8_t activation = 0;
+    for(;;){
+        EnablePort0();
+        if(++activation == 4){
+            activation = 0;
+            EnablePort3();
+            _delay_ms(12);
+            DisablePort3();
+        } else {
+            _delay_ms(3);
+        }
+        DisablePort0();
+        Task_Next();
+    }
+}
+
+void lo_task(){
+    for(;;){
+        EnablePort1();
+        _delay_ms(1);
+        DisablePort1();
+        Task_Next();
+    }
+}
+
+void rr_task(){
+    for(;;){
+        EnablePort2();
+        DisablePort2();
+    }
+}
+
+int r_main(){
+    DefaultPorts();
+    Task_Create_Periodic_MC(hi_task, 0, 10, 1, 3, 0);
+
+    Criticality_Select(CRIT_LO);
+    Task_Create_Periodic(lo_task, 0, 10, 1, 2);
+    Task_Create_RR(rr_task, 0);
+    return 0;
+}
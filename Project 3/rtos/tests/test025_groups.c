@@ -0,0 +1,48 @@
+#include <avr/io.h>
+#include <util/delay.h>
+#include "port_map.h"
+#include "os.h"
+#include "kernel.h"
+
+/*
+ * This test is designed to prove that RR tasks in a reservation group get
+ * no more than its budget, however many of them there are.
+ */
+
+/* ---- TRACE ----
+ * Defaults all testing output ports
+ * Creates 3 rr tasks in a group with a budget of 1 TICK every 4, and 1 rr
+ *   task outside it
+ * group tasks: toggle port 0, 1 or 2 as fast as they can.
+ * control task: toggles port 3 as fast as it can.
+ * Ports 0 to 2 should toggle for one 5ms TICK between them every 20ms, one
+ * port at a time, and port 3 for the other 15ms.  Without the group, port 3
+ * would get only a quarter of the time.
+ */
+
+void group_task(){
+    int16_t port = Task_GetArg();
+    for(;;){
+        EnablePort(PORT_PIN0 + port);
+        DisablePort(PORT_PIN0 + port);
+    }
+}
+
+void control_task(){
+    for(;;){
+        EnablePort3();
+        DisablePort3();
+    }
+}
+
+int r_main(){
+    DefaultPorts();
+    Group_Select(Group_Init(1, 4));
+    Task_Create_RR(group_task, 0);
+    Task_Create_RR(group_task, 1);
+    Task_Create_RR(group_task, 2);
+
+    Group_Select(0);
+    Task_Create_RR(control_task, 0);
+    return 0;
+}
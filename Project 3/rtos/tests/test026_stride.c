@@ -0,0 +1,36 @@
+#include <avr/io.h>
+#include <util/delay.h>
+#include "port_map.h"
+#include "os.h"
+#include "kernel.h"
+
+/*
+ * This test is designed to prove that RR tasks share the CPU by weight.
+ * Build everything with -DRR_STRIDE=1.
+ */
+
+/* ---- TRACE ----
+ * Defaults all testing output ports
+ * Creates 3 rr tasks, of weights 1, 2 and 4
+ * rr tasks: set their weight, then toggle port 0, 1 or 2 as fast as they can.
+ * Over any 35ms, port 0 should toggle for one 5ms TICK, port 1 for two and
+ * port 2 for four.  Built without RR_STRIDE, each port toggles every third
+ * TICK.
+ */
+
+void rr_task(){
+    int16_t port = Task_GetArg();
+    Task_Set_Weight(1 << port);
+    for(;;){
+        EnablePort(PORT_PIN0 + port);
+        DisablePort(PORT_PIN0 + port);
+    }
+}
+
+int r_main(){
+    DefaultPorts();
+    Task_Create_RR(rr_task, 0);
+    Task_Create_RR(rr_task, 1);
+    Task_Create_RR(rr_task, 2);
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include <avr/io.h>
+#include <util/delay.h>
+#include "port_map.h"
+#include "os.h"
+#include "kernel.h"
+
+/*
+ * This test is designed to prove that software timers expire on time,
+ * once or over and over, and that a reset puts a timer off.
+ */
+
+/* ---- TRACE ----
+ * Defaults all testing output ports
+ * Creates 3 timers and 1 rr task
+ * blink timer: reloads every 4 TICKs and toggles port 0.
+ * once timer: expires once, 20 TICKs after it is started, and sets port 1.
+ * watchdog timer: expires 10 TICKs after its last reset and toggles port 2.
+ * rr task: busy for 20ms with port 3 on, resets the watchdog, 30ms off,
+ *   and every 8th time busy for 80ms instead.
+ * Port 0 should toggle every 20ms, port 1 rise once at 100ms, and port 2
+ * toggle only 50ms into each of the rr task's 80ms stretches.
+ */
+
+soft_timer_t* blink;
+soft_timer_t* once;
+soft_timer_t* watchdog;
+
+void blink_expired(int16_t arg){
+    (void)arg;
+    PORT_OUT ^= _BV(PORT_PIN0);
+}
+
+void once_expired(int16_t arg){
+    (void)arg;
+    EnablePort1();
+}
+
+void watchdog_expired(int16_t arg){
+    (void)arg;
+    PORT_OUT ^= _BV(PORT_PIN2);
+}
+
+void rr_task(){
+    uint8_t round = 0;
+    for(;;){
+        EnablePort3();
+        if(++round == 8){
+            round = 0;
+            _delay_ms(80);
+        } else {
+            _delay_ms(20);
+        }
+        DisablePort3();
+        Timer_Reset(watchdog);
+        _delay_ms(30);
+    }
+}
+
+int r_main(){
+    DefaultPorts();
+    blink = Timer_Init(blink_expired, 0, 4, 1);
+    once = Timer_Init(once_expired, 0, 20, 0);
+    watchdog = Timer_Init(watchdog_expired, 0, 10, 0);
+    Timer_Start(blink);
+    Timer_Start(once);
+    Timer_Start(watchdog);
+    Task_Create_RR(rr_task, 0);
+    return 0;
+}
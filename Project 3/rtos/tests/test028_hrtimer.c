@@ -0,0 +1,63 @@
+#include <avr/io.h>
+#include <util/delay.h>
+#include "port_map.h"
+#include "os.h"
+#include "kernel.h"
+#include "hrtimer.h"
+
+/*
+ * This test is designed to prove that deadlines sharing OCR1B fall on time
+ * and in order, whatever order they were started in.
+ */
+
+/* ---- TRACE ----
+ * Defaults all testing output ports
+ * Creates 1 periodic task and 1 rr task, and 4 deadlines
+ * every 10ms periodic: sets port 0, then starts deadlines at 300us, 100us
+ *   and 200us that clear ports 3, 1 and 2, and one at 1000us that publishes
+ *   to the rr task's service.
+ * rr task: waits for the service, then pulses port 4.
+ * Port 0 should rise every 10ms with ports 1 to 3, which fall 100, 200 and
+ * 300us after it, each within a few us; port 4 pulses 1ms after port 0.
+ */
+
+service_t* service;
+hrtimer_t* clear[3];
+hrtimer_t* wake;
+
+void clear_port(int16_t port){
+    DisablePort(port);
+}
+
+void periodic_task(){
+    for(;;){
+        PORT_OUT |= _BV(PORT_PIN0) | _BV(PORT_PIN1) | _BV(PORT_PIN2) | _BV(PORT_PIN3);
+        HrTimer_Start(clear[2], 300);
+        HrTimer_Start(clear[0], 100);
+        HrTimer_Start(clear[1], 200);
+        HrTimer_Start(wake, 1000);
+        DisablePort0();
+        Task_Next();
+    }
+}
+
+void rr_task(){
+    int16_t value;
+    for(;;){
+        Service_Subscribe(service, &value);
+        EnablePort4();
+        DisablePort4();
+    }
+}
+
+int r_main(){
+    DefaultPorts();
+    service = Service_Init();
+    clear[0] = HrTimer_Init(clear_port, PORT_PIN1);
+    clear[1] = HrTimer_Init(clear_port, PORT_PIN2);
+    clear[2] = HrTimer_Init(clear_port, PORT_PIN3);
+    wake = HrTimer_Init_Publish(service, 0);
+    Task_Create_Periodic(periodic_task, 0, 2, 1, 0);
+    Task_Create_RR(rr_task, 0);
+    return 0;
+}
@@ -0,0 +1,55 @@
+#include <avr/io.h>
+#include <util/delay.h>
+#include "port_map.h"
+#include "os.h"
+#include "kernel.h"
+
+/*
+ * This test is designed to prove that a PERIODIC task created in usec is
+ * released on time between TICKs, and that the RR task below it keeps the
+ * rest of its quantum.
+ */
+
+/* ---- TRACE ----
+ * Defaults all testing output ports
+ * Creates 2 periodic tasks and 1 rr task
+ * every 2ms fast task: toggle port 0 on, busy for 300us, toggle port 0 off;
+ *   first released 1500us after r_main() creates it.
+ * every 8ms odd task: toggles port 1 once; first released 700us after
+ *   the fast one, so it never collides with it.
+ * rr task: toggles port 2 as fast as it can.
+ * Port 0 should rise every 2000us, within a few tens of us, whatever the
+ * TICK; port 1 every 8000us; port 2 toggles whenever ports 0 and 1 are low.
+ */
+
+void fast_task(){
+    for(;;){
+        EnablePort0();
+        _delay_us(300);
+        DisablePort0();
+        Task_Next();
+    }
+}
+
+void odd_task(){
+    for(;;){
+        EnablePort1();
+        DisablePort1();
+        Task_Next();
+    }
+}
+
+void rr_task(){
+    for(;;){
+        EnablePort2();
+        DisablePort2();
+    }
+}
+
+int r_main(){
+    DefaultPorts();
+    Task_Create_Periodic_Us(fast_task, 0, 2000, 500, 1500);
+    Task_Create_Periodic_Us(odd_task, 0, 8000, 100, 2200);
+    Task_Create_RR(rr_task, 0);
+    return 0;
+}
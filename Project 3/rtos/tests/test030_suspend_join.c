@@ -0,0 +1,73 @@
+#include <avr/io.h>
+#include <util/delay.h>
+#include "port_map.h"
+#include "os.h"
+#include "kernel.h"
+
+/*
+ * This test is designed to prove that a suspended task keeps its context
+ * and carries on where it stopped when resumed, and that a task joining
+ * another waits until it terminates.
+ */
+
+/* ---- TRACE ----
+ * Defaults all testing output ports
+ * Creates 1 periodic task and 2 rr tasks
+ * every 50ms periodic: toggles port 0, then suspends the counting task if
+ *   it was running or resumes it if it was suspended.
+ * counting task: counts up and shows bit 0 of the count on port 1, every 1ms.
+ * joining task: creates a worker, which holds port 2 high for 20ms and
+ *   terminates, joins it, then toggles port 3 and starts again.
+ * Port 1 should toggle for 50ms and hold still for 50ms, never restarting
+ * from 0; port 3 should toggle only after each fall of port 2.
+ */
+
+int8_t counting_id;
+
+void counting_task(){
+    uint8_t count = 0;
+    for(;;){
+        ++count;
+        if(count & 1){
+            EnablePort1();
+        } else {
+            DisablePort1();
+        }
+        _delay_ms(1);
+    }
+}
+
+void worker_task(){
+    EnablePort2();
+    _delay_ms(20);
+    DisablePort2();
+}
+
+void joining_task(){
+    for(;;){
+        Task_Join(Task_Create_RR(worker_task, 0));
+        PORT_OUT ^= _BV(PORT_PIN3);
+    }
+}
+
+void periodic_task(){
+    uint8_t suspended = 0;
+    for(;;){
+        PORT_OUT ^= _BV(PORT_PIN0);
+        if(suspended){
+            Task_Resume(counting_id);
+        } else {
+            Task_Suspend(counting_id);
+        }
+        suspended = !suspended;
+        Task_Next();
+    }
+}
+
+int r_main(){
+    DefaultPorts();
+    counting_id = Task_Create_RR(counting_task, 0);
+    Task_Create_RR(joining_task, 0);
+    Task_Create_Periodic(periodic_task, 0, 10, 1, 10);
+    return 0;
+}
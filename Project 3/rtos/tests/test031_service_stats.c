@@ -0,0 +1,73 @@
+#include <avr/io.h>
+#include <util/delay.h>
+#include "port_map.h"
+#include "os.h"
+#include "kernel.h"
+
+/*
+ * This test is designed to prove that the kernel counts the publishes of a
+ * service that nobody was waiting for, the tasks it woke, the most tasks
+ * waiting at once and the time from a publish to running a task it woke.
+ */
+
+/* ---- TRACE ----
+ * Defaults all testing output ports
+ * Creates 1 periodic task and 3 rr tasks
+ * every 20ms periodic: toggles port 0 and publishes twice; the first
+ *   publish wakes both subscribers, so the second finds nobody waiting.
+ * 2 subscriber tasks: wait on the service over and over.
+ * at 1000ms rr: reads the statistics;
+ *   port 1 on if at most 2 tasks waited at once,
+ *   port 2 on if half of the publishes were lost,
+ *   port 3 on if every publish that was not lost woke 2 tasks,
+ *   port 4 on if no task woke later than 1ms after its publish.
+ */
+
+service_t* service;
+
+void periodic_task(){
+    for(;;){
+        PORT_OUT ^= _BV(PORT_PIN0);
+        Service_Publish(service, 0);
+        Service_Publish(service, 1);
+        Task_Next();
+    }
+}
+
+void subscriber_task(){
+    int16_t value;
+    for(;;){
+        Service_Subscribe(service, &value);
+    }
+}
+
+void rr_task(){
+    service_info_t info;
+
+    while(Now() < 1000){
+        Task_Next();
+    }
+    OS_Service_Info(0, &info);
+    if(info.max_subscribers == 2){
+        EnablePort1();
+    }
+    if(info.lost * 2 == info.publishes){
+        EnablePort2();
+    }
+    if(info.wakeups == info.publishes){
+        EnablePort3();
+    }
+    if(info.worst_latency < 1000){
+        EnablePort4();
+    }
+}
+
+int r_main(){
+    DefaultPorts();
+    service = Service_Init();
+    Task_Create_Periodic(periodic_task, 0, 4, 1, 1);
+    Task_Create_RR(subscriber_task, 0);
+    Task_Create_RR(subscriber_task, 0);
+    Task_Create_RR(rr_task, 0);
+    return 0;
+}
@@ -0,0 +1,83 @@
+#include <avr/io.h>
+#include <util/delay.h>
+#include "port_map.h"
+#include "os.h"
+#include "kernel.h"
+
+/*
+ * This test is designed to prove that pipeline stages run when their input
+ * channel has data, that a full overwrite channel keeps the freshest items,
+ * and that the source's time reaches the last stage.
+ */
+
+/* ---- TRACE ----
+ * Defaults all testing output ports
+ * Creates 1 periodic task, 1 system task and 1 rr task
+ * every 10ms source (periodic): toggles port 0 and writes a count to an
+ *   overwrite channel of 1 item.
+ * filter (system): reads the count, busy for 1ms with port 1 on, and writes
+ *   it to a blocking channel of 2 items.
+ * sink (rr): reads the count, busy for 25ms with port 2 on; port 3 on if
+ *   the count went up by more than 1, as the sink is slower than the source;
+ *   port 4 on while the count's age, from the source's write, is over 80ms.
+ * Once the blocking channel is full, port 1 should rise every 25ms, each
+ * time the sink makes room; port 3 should come on; port 4 should stay off,
+ * as a count waits at most 10ms for the filter and 2 x 25ms for the sink.
+ */
+
+channel_t* sensed;
+channel_t* filtered;
+uint8_t sensed_buffer[CHANNEL_BYTES(sizeof(uint16_t), 1)];
+uint8_t filtered_buffer[CHANNEL_BYTES(sizeof(uint16_t), 2)];
+
+void source_task(){
+    uint16_t count = 0;
+    for(;;){
+        PORT_OUT ^= _BV(PORT_PIN0);
+        ++count;
+        Channel_Write(sensed, &count);
+        Task_Next();
+    }
+}
+
+void filter_task(){
+    uint16_t count;
+    for(;;){
+        Channel_Read(sensed, &count);
+        EnablePort1();
+        _delay_ms(1);
+        DisablePort1();
+        Channel_Write(filtered, &count);
+    }
+}
+
+void sink_task(){
+    uint16_t count;
+    uint16_t last = 0;
+    uint32_t stamp;
+    for(;;){
+        stamp = Channel_Read(filtered, &count);
+        if((uint32_t)(OS_Time() - stamp) > 80000UL * 2){
+            EnablePort4();
+        } else {
+            DisablePort4();
+        }
+        if(last != 0 && count > last + 1){
+            EnablePort3();
+        }
+        last = count;
+        EnablePort2();
+        _delay_ms(25);
+        DisablePort2();
+    }
+}
+
+int r_main(){
+    DefaultPorts();
+    sensed = Channel_Init(sensed_buffer, sizeof(uint16_t), 1, CHANNEL_OVERWRITE);
+    filtered = Channel_Init(filtered_buffer, sizeof(uint16_t), 2, CHANNEL_BLOCK);
+    Task_Create_Periodic(source_task, 0, 2, 1, 0);
+    Task_Create_System(filter_task, 0);
+    Task_Create_RR(sink_task, 0);
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include <avr/io.h>
+#include <util/delay.h>
+#include "port_map.h"
+#include "os.h"
+#include "kernel.h"
+
+/*
+ * This test is designed to prove that a publish wakes its subscribers most
+ * urgent first, and that each runs ahead of the READY tasks that are no more
+ * urgent than it.  Build without RR_STRIDE.
+ */
+
+/* ---- TRACE ----
+ * Defaults all testing output ports
+ * Creates 1 periodic task and 4 rr tasks
+ * 3 subscriber tasks: priorities 1, 3 and 2, subscribed in that order; each
+ *   notes its priority when it wakes.
+ * spinner task: priority 2, never waits; notes 9 the first time it runs
+ *   after a publish.
+ * every 20ms periodic: toggles port 0, checks the order noted since its last
+ *   publish, then publishes; port 1 on if the order was 3, 2, 9, 1, off
+ *   otherwise.
+ * Port 0 should toggle every 20ms, and port 1 should be on from 20ms and
+ * stay on.
+ */
+
+#define SPINNER 9
+
+service_t* service;
+volatile uint8_t woken[4];
+volatile uint8_t woken_count;
+volatile uint8_t published;
+
+void note(uint8_t who){
+    if(woken_count < sizeof(woken)){
+        woken[woken_count] = who;
+    }
+    ++woken_count;
+}
+
+void periodic_task(){
+    static const uint8_t expected[4] = {3, 2, SPINNER, 1};
+    uint8_t first = 1;
+    uint8_t i;
+
+    for(;;){
+        PORT_OUT ^= _BV(PORT_PIN0);
+        if(!first){
+            for(i = 0; i < sizeof(expected) && woken[i] == expected[i]; ++i);
+            if(i == sizeof(expected) && woken_count == sizeof(expected)){
+                EnablePort1();
+            } else {
+                DisablePort1();
+            }
+        }
+        first = 0;
+        woken_count = 0;
+        published = 1;
+        Service_Publish(service, 0);
+        Task_Next();
+    }
+}
+
+void subscriber_task(){
+    int16_t value;
+
+    Task_Set_Priority(Task_GetArg());
+    for(;;){
+        Service_Subscribe(service, &value);
+        note(Task_GetArg());
+    }
+}
+
+void spinner_task(){
+    Task_Set_Priority(2);
+    for(;;){
+        if(published){
+            published = 0;
+            note(SPINNER);
+        }
+    }
+}
+
+int r_main(){
+    DefaultPorts();
+    service = Service_Init();
+    Task_Create_Periodic(periodic_task, 0, 4, 1, 1);
+    Task_Create_RR(subscriber_task, 1);
+    Task_Create_RR(subscriber_task, 3);
+    Task_Create_RR(subscriber_task, 2);
+    Task_Create_RR(spinner_task, 0);
+    return 0;
+}
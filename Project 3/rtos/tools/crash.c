@@ -0,0 +1,157 @@
+/*
+ * crash.c
+ *
+ * Decode the crash snapshot OS_Abort() saves at the end of EEPROM.
+ *
+ * Usage: crash [-e bytes] eeprom-dump
+ *   -e  size of the EEPROM (default 4096, the ATmega2560)
+ *
+ * The dump is the whole EEPROM, read with avrdude as raw binary (-U eeprom:r:dump.bin:r) or
+ * Intel hex (-U eeprom:r:dump.eep:i).
+ *
+ * Exit status: 0 a snapshot was decoded, 1 there is none, 2 bad usage or dump.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "os.h"
+#include "error_name.h"
+
+#define DEFAULT_EEPROM_SIZE 4096
+#define MAX_EEPROM_SIZE     65536
+
+/** As in os.c. */
+#define CRASH_MAGIC         0xC5
+
+static const char* level_name(uint8_t level) {
+    switch(level) {
+        case SYSTEM: return "SYSTEM";
+        case PERIODIC: return "PERIODIC";
+        case RR: return "RR";
+        case IDLE: return "IDLE";
+        default: return "?";
+    }
+}
+
+/** task_state_t of kernel.h. */
+static const char* state_name(uint8_t state) {
+    static const char* names[] = { "DEAD", "RUNNING", "READY", "WAITING" };
+    return state < sizeof(names) / sizeof(names[0]) ? names[state] : "?";
+}
+
+static const char* event_name(uint8_t event) {
+    switch(event) {
+        case CRASH_EVENT_CREATE: return "create";
+        case CRASH_EVENT_TERMINATE: return "terminate";
+        case CRASH_EVENT_NEXT: return "next";
+        case CRASH_EVENT_INTERRUPT: return "interrupt";
+        case CRASH_EVENT_DISPATCH: return "dispatch";
+        default: return "?";
+    }
+}
+
+static void print_task(uint8_t task) {
+    if(task == CRASH_NO_TASK) printf("kernel/idle");
+    else printf("task %u", task);
+}
+
+static int hex_byte(const char* text) {
+    unsigned value;
+    return sscanf(text, "%2x", &value) == 1 ? (int)value : -1;
+}
+
+/**
+ * Read an Intel hex dump into eeprom.  Returns the number of bytes covered, or -1.
+ */
+static long read_ihex(FILE* file, uint8_t* eeprom, long size) {
+    char line[600];
+    long end = 0;
+
+    while(fgets(line, sizeof(line), file)) {
+        int count, address, type, i;
+        if(line[0] != ':') continue;
+        count = hex_byte(line + 1);
+        address = hex_byte(line + 3) << 8 | hex_byte(line + 5);
+        type = hex_byte(line + 7);
+        if(count < 0 || address < 0 || type < 0 || (long)strlen(line) < 11 + 2 * count) return -1;
+        if(type == 1) break;
+        if(type != 0) continue;
+        for(i = 0; i < count; i++) {
+            int value = hex_byte(line + 9 + 2 * i);
+            if(value < 0 || address + i >= size) return -1;
+            eeprom[address + i] = (uint8_t)value;
+        }
+        if(address + count > end) end = address + count;
+    }
+    return end;
+}
+
+int main(int argc, char** argv) {
+    long size = DEFAULT_EEPROM_SIZE, length;
+    const char* path = NULL;
+    static uint8_t eeprom[MAX_EEPROM_SIZE];
+    crash_snapshot_t snapshot;
+    uint8_t checksum = 0;
+    FILE* file;
+    int first, i;
+
+    for(i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-e") == 0 && i + 1 < argc) size = strtol(argv[++i], NULL, 0);
+        else if(argv[i][0] != '-' && !path) path = argv[i];
+        else path = NULL, i = argc;
+    }
+    if(!path || size < (long)sizeof(snapshot) || size > MAX_EEPROM_SIZE) {
+        fprintf(stderr, "usage: crash [-e bytes] eeprom-dump\n");
+        return 2;
+    }
+    file = fopen(path, "rb");
+    if(!file) {
+        fprintf(stderr, "crash: %s: cannot open\n", path);
+        return 2;
+    }
+    memset(eeprom, 0xFF, sizeof(eeprom));
+    first = fgetc(file);
+    ungetc(first, file);
+    length = first == ':' ? read_ihex(file, eeprom, size) : (long)fread(eeprom, 1, size, file);
+    fclose(file);
+    if(length < size) {
+        fprintf(stderr, "crash: %s: expected %ld bytes of EEPROM\n", path, size);
+        return 2;
+    }
+
+    memcpy(&snapshot, eeprom + size - sizeof(snapshot), sizeof(snapshot));
+    for(i = 1; i < (int)sizeof(snapshot); i++) {
+        checksum += eeprom[size - sizeof(snapshot) + i];
+    }
+    if(snapshot.magic != CRASH_MAGIC) {
+        printf("no crash snapshot\n");
+        return 1;
+    }
+    if(checksum != 0) {
+        printf("crash snapshot is corrupt (checksum %02x)\n", checksum);
+        return 1;
+    }
+
+    printf("%s at %u ms, ", Error_Name(snapshot.error), snapshot.now);
+    print_task(snapshot.task);
+    printf(" running, SP 0x%04x\n\n", snapshot.sp);
+
+    printf("task  level     state     sp      stack free\n");
+    for(i = 0; i < MAXPROCESS; i++) {
+        const crash_task_t* task = &snapshot.tasks[i];
+        if(task->state == 0 && task->sp == 0) continue;
+        printf("%-5d %-9s %-9s 0x%04x  %3u of %u%s\n", i, level_name(task->level), state_name(task->state),
+               task->sp, task->stack_free, MAXSTACK, task->stack_free == 0 ? "  OVERFLOWED" : "");
+    }
+
+    printf("\nlast kernel events, oldest first:\n");
+    for(i = 0; i < CRASH_TRACE_LENGTH; i++) {
+        const crash_event_t* event = &snapshot.trace[i];
+        if(event->event == 0) continue;
+        printf("  %5u ms  %-10s ", event->time, event_name(event->event));
+        print_task(event->task);
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,25 @@
+/*
+ * error_name.c
+ */
+
+#include "error_code.h"
+#include "error_name.h"
+
+const char* Error_Name(uint8_t error) {
+    switch(error) {
+        case ERR_1_WORST_CASE_GT_PERIOD: return "ERR_1_WORST_CASE_GT_PERIOD";
+        case ERR_2_MAX_SERVICES_REACHED: return "ERR_2_MAX_SERVICES_REACHED";
+        case ERR_RUN_1_USER_CALLED_OS_ABORT: return "ERR_RUN_1_USER_CALLED_OS_ABORT";
+        case ERR_RUN_2_TOO_MANY_TASKS: return "ERR_RUN_2_TOO_MANY_TASKS";
+        case ERR_RUN_3_PERIODIC_TOOK_TOO_LONG: return "ERR_RUN_3_PERIODIC_TOOK_TOO_LONG";
+        case ERR_RUN_4_ILLEGAL_ISR_KERNEL_REQUEST: return "ERR_RUN_4_ILLEGAL_ISR_KERNEL_REQUEST";
+        case ERR_RUN_5_RTOS_INTERNAL_ERROR: return "ERR_RUN_5_RTOS_INTERNAL_ERROR";
+        case ERR_RUN_6_PERIODIC_TASK_COLLISION: return "ERR_RUN_6_PERIODIC_TASK_COLLISION";
+        case ERR_RUN_7_PERIODIC_TASK_SUBSCRIBED: return "ERR_RUN_7_PERIODIC_TASK_SUBSCRIBED";
+        case ERR_RUN_8_PERIODIC_TASK_FOUND_SUBSCRIBED: return "ERR_RUN_8_PERIODIC_TASK_FOUND_SUBSCRIBED";
+        case ERR_RUN_9_IDLE_JOB_SUBSCRIBED: return "ERR_RUN_9_IDLE_JOB_SUBSCRIBED";
+        case ERR_RUN_10_ILLEGAL_JOIN: return "ERR_RUN_10_ILLEGAL_JOIN";
+        case ERR_RUN_11_ILLEGAL_CHANNEL_WAIT: return "ERR_RUN_11_ILLEGAL_CHANNEL_WAIT";
+        default: return "unknown error";
+    }
+}
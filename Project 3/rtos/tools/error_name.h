@@ -0,0 +1,15 @@
+/*
+ * error_name.h
+ *
+ * Names of the error_code.h values, for the host-side tools.
+ */
+
+#ifndef ERROR_NAME_H_
+#define ERROR_NAME_H_
+
+#include <stdint.h>
+
+/** The name of an error_code.h value, or "unknown error". */
+const char* Error_Name(uint8_t error);
+
+#endif /* ERROR_NAME_H_ */
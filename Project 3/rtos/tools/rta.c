@@ -0,0 +1,563 @@
+/*
+ * rta.c
+ *
+ * Response-time analysis and PERIODIC rule simulation.
+ */
+
+#include <string.h>
+#include "error_code.h"
+#include "rta.h"
+
+/* Longest SYSTEM backlog the simulation keeps before calling the set overloaded. */
+#define SYSTEM_BACKLOG      256
+
+/* Response times are not followed past this many deadlines. */
+#define RESPONSE_LIMIT      16
+
+/* Who the simulated CPU is running, besides a task index. */
+#define RUN_NONE            0xFF
+
+typedef struct _periodic_job {
+    uint8_t pending;
+    /* Releases that came while the previous activation was still pending. */
+    uint16_t queued;
+    uint64_t release_us;
+    uint64_t remaining_us;
+    /* Time run, kernel entries included, charged against the wcet. */
+    uint64_t charged_us;
+} periodic_job_t;
+
+typedef struct _system_job {
+    uint8_t task;
+    uint64_t arrival_us;
+} system_job_t;
+
+typedef struct _sim {
+    const taskset_t* set;
+    rta_report_t* report;
+    periodic_job_t jobs[TASKSET_MAX_TASKS];
+    /* PERIODIC: the next release.  SYSTEM: the next activation. */
+    uint64_t next_release[TASKSET_MAX_TASKS];
+    uint64_t next_arrival[TASKSET_MAX_TASKS];
+    system_job_t backlog[SYSTEM_BACKLOG];
+    uint16_t backlog_head;
+    uint16_t backlog_count;
+    uint8_t running;
+    uint64_t system_remaining;
+    system_job_t system_job;
+    uint64_t rr_last;
+} sim_t;
+
+/* ==== Helpers ==== */
+
+static uint64_t gcd(uint64_t a, uint64_t b) {
+    while(b != 0) {
+        uint64_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+static uint64_t ceil_div(uint64_t a, uint64_t b) {
+    return (a + b - 1) / b;
+}
+
+/**
+ * Time taken from a window of length w by the tick interrupt and every SYSTEM activation that
+ * can arrive in it.
+ */
+static uint64_t interference(const taskset_t* set, uint64_t w) {
+    uint64_t total = ceil_div(w, set->tick_us) * set->overhead_us;
+    uint8_t j;
+    for(j = 0; j < set->count; j++) {
+        if(set->tasks[j].level == SYSTEM) {
+            total += ceil_div(w, set->tasks[j].interarrival_us) * set->tasks[j].exec_us;
+        }
+    }
+    return total;
+}
+
+/**
+ * Smallest w >= start with w = base + interference(w), or RTA_UNBOUNDED past limit.
+ */
+static uint32_t fixpoint(const taskset_t* set, uint64_t base, uint64_t start, uint64_t limit) {
+    uint64_t w = start, next;
+    for(;;) {
+        next = base + interference(set, w);
+        if(next <= w) return (uint32_t)w;
+        if(next > limit) return RTA_UNBOUNDED;
+        w = next;
+    }
+}
+
+/**
+ * Time from a release of a to the next release of b in steady state: releases of the two
+ * tasks differ by (start_b - start_a) modulo the gcd of their periods.
+ */
+static uint64_t release_gap(const task_spec_t* a, const task_spec_t* b) {
+    int64_t g = (int64_t)gcd(a->period_us, b->period_us);
+    int64_t delta = ((int64_t)b->start_us - (int64_t)a->start_us) % g;
+    return (uint64_t)(delta < 0 ? delta + g : delta);
+}
+
+static uint32_t periodic_deadline(const taskset_t* set, uint8_t i) {
+    const task_spec_t* a = &set->tasks[i];
+    uint64_t us = a->period_us;
+    uint8_t k;
+    for(k = 0; k < set->count; k++) {
+        if(k != i && set->tasks[k].level == PERIODIC) {
+            uint64_t gap = release_gap(a, &set->tasks[k]);
+            if(gap < us) us = gap;
+        }
+    }
+    return (uint32_t)us;
+}
+
+static void set_error(rta_report_t* report, uint8_t error, uint64_t when_us, uint8_t task, uint8_t other) {
+    if(report->error == RTA_NO_ERROR) {
+        report->error = error;
+        report->error_us = when_us;
+        report->error_task = task;
+        report->error_other = other;
+    }
+}
+
+static void update_slack(task_result_t* result) {
+    if(result->response_us == RTA_UNBOUNDED) {
+        result->slack_us = INT32_MIN;
+    } else {
+        result->slack_us = (int32_t)((int64_t)result->deadline_us - result->response_us);
+    }
+}
+
+/* ==== Analysis ==== */
+
+/**
+ * Response times; these do not depend on the PERIODIC start times.
+ */
+static void analyse_responses(const taskset_t* set, rta_report_t* report) {
+    uint64_t system_exec = 0;
+    uint64_t longest_interarrival = 0;
+    uint32_t busy = 0;
+    uint8_t i, has_system = 0;
+
+    report->utilisation = (double)set->overhead_us / set->tick_us;
+    report->rr_demand = 0;
+    for(i = 0; i < set->count; i++) {
+        const task_spec_t* task = &set->tasks[i];
+        if(task->level == SYSTEM) {
+            report->utilisation += (double)task->exec_us / task->interarrival_us;
+            system_exec += task->exec_us;
+            if(task->interarrival_us > longest_interarrival) longest_interarrival = task->interarrival_us;
+            has_system = 1;
+        } else if(task->level == PERIODIC) {
+            report->utilisation += (double)task->exec_us / task->period_us;
+        } else {
+            report->rr_demand += task->load;
+        }
+    }
+    report->rr_share = report->utilisation < 1 ? 1 - report->utilisation : 0;
+
+    /* SYSTEM tasks are FCFS and run to completion: an activation waits at most one busy period. */
+    if(has_system) {
+        busy = fixpoint(set, 0, system_exec + set->overhead_us, RESPONSE_LIMIT * longest_interarrival);
+    }
+
+    for(i = 0; i < set->count; i++) {
+        const task_spec_t* task = &set->tasks[i];
+        task_result_t* result = &report->tasks[i];
+
+        if(task->level == SYSTEM) {
+            result->response_us = busy;
+            result->deadline_us = task->interarrival_us;
+        } else if(task->level == PERIODIC) {
+            uint64_t limit = RESPONSE_LIMIT * (uint64_t)task->period_us;
+            result->response_us = fixpoint(set, task->exec_us, task->exec_us, limit);
+
+            /*
+             * os.c charges an activation the time it runs, kernel entries included, and aborts
+             * when the charge reaches its wcet.  The kernel is entered at each tick while it
+             * runs, and once more each time a SYSTEM task preempts it.
+             */
+            if(result->response_us == RTA_UNBOUNDED) {
+                result->budget_ok = 0;
+            } else {
+                uint64_t preemptions = 0, charged = task->exec_us, next;
+                uint8_t j;
+                for(j = 0; j < set->count; j++) {
+                    if(set->tasks[j].level == SYSTEM) {
+                        preemptions += ceil_div(result->response_us, set->tasks[j].interarrival_us);
+                    }
+                }
+                while(charged < task->wcet_us) {
+                    next = task->exec_us + (ceil_div(charged, set->tick_us) + preemptions) * set->overhead_us;
+                    if(next <= charged) break;
+                    charged = next;
+                }
+                result->budget_ok = charged < task->wcet_us;
+            }
+        } else {
+            result->response_us = 0;
+            result->deadline_us = 0;
+            result->budget_ok = 1;
+        }
+    }
+}
+
+/**
+ * Deadlines, slack and verdicts; these depend on the PERIODIC start times.
+ */
+static uint8_t judge(const taskset_t* set, rta_report_t* report) {
+    uint8_t i, all = 1;
+
+    for(i = 0; i < set->count; i++) {
+        const task_spec_t* task = &set->tasks[i];
+        task_result_t* result = &report->tasks[i];
+
+        if(task->level == PERIODIC) {
+            result->deadline_us = periodic_deadline(set, i);
+            if(task->period_us < task->wcet_us) {
+                set_error(report, ERR_1_WORST_CASE_GT_PERIOD, 0, i, i);
+            }
+        }
+        if(task->level == RR) {
+            result->schedulable = 1;
+            continue;
+        }
+        update_slack(result);
+        result->schedulable = result->response_us != RTA_UNBOUNDED && result->slack_us >= 0 &&
+                              result->observed_us <= result->deadline_us &&
+                              (task->level != PERIODIC || result->budget_ok);
+        all &= result->schedulable;
+    }
+
+    /* r_main is still running while it creates the others. */
+    if(set->count > MAXPROCESS - 1) {
+        set_error(report, ERR_RUN_2_TOO_MANY_TASKS, 0, MAXPROCESS - 1, MAXPROCESS - 1);
+    }
+    report->schedulable = all && report->utilisation <= 1 && report->error == RTA_NO_ERROR;
+    return report->schedulable;
+}
+
+static void report_init(rta_report_t* report) {
+    memset(report, 0, sizeof(*report));
+    report->error = RTA_NO_ERROR;
+}
+
+uint8_t Rta_Check(const taskset_t* set, rta_report_t* report) {
+    report_init(report);
+    analyse_responses(set, report);
+    return judge(set, report);
+}
+
+/* ==== Simulation ==== */
+
+/**
+ * The least common multiple of the PERIODIC periods, or limit if it is longer.
+ */
+static uint64_t hyperperiod(const taskset_t* set, uint64_t limit) {
+    uint64_t h = 1;
+    uint8_t i;
+    for(i = 0; i < set->count; i++) {
+        if(set->tasks[i].level == PERIODIC) {
+            h = h / gcd(h, set->tasks[i].period_us) * set->tasks[i].period_us;
+            if(h > limit) return limit;
+        }
+    }
+    return h;
+}
+
+/**
+ * Queue every SYSTEM activation due by time t, oldest first.
+ */
+static void admit_arrivals(sim_t* sim, uint64_t t) {
+    const taskset_t* set = sim->set;
+    for(;;) {
+        uint8_t j, first = RUN_NONE;
+        for(j = 0; j < set->count; j++) {
+            if(set->tasks[j].level == SYSTEM && sim->next_arrival[j] <= t &&
+               (first == RUN_NONE || sim->next_arrival[j] < sim->next_arrival[first])) {
+                first = j;
+            }
+        }
+        if(first == RUN_NONE) {
+            return;
+        }
+        if(sim->backlog_count < SYSTEM_BACKLOG) {
+            system_job_t* job = &sim->backlog[(sim->backlog_head + sim->backlog_count++) % SYSTEM_BACKLOG];
+            job->task = first;
+            job->arrival_us = sim->next_arrival[first];
+        } else {
+            sim->report->tasks[first].observed_us = RTA_UNBOUNDED;
+        }
+        sim->next_arrival[first] += set->tasks[first].interarrival_us;
+    }
+}
+
+static uint64_t next_arrival(const sim_t* sim) {
+    uint64_t next = UINT64_MAX;
+    uint8_t j;
+    for(j = 0; j < sim->set->count; j++) {
+        if(sim->set->tasks[j].level == SYSTEM && sim->next_arrival[j] < next) {
+            next = sim->next_arrival[j];
+        }
+    }
+    return next;
+}
+
+static void observe(task_result_t* result, uint64_t response) {
+    if(result->observed_us != RTA_UNBOUNDED && response > result->observed_us) {
+        result->observed_us = response > UINT32_MAX - 1 ? RTA_UNBOUNDED : (uint32_t)response;
+    }
+}
+
+/**
+ * Pick what runs next: SYSTEM first come first served, then the ready PERIODIC task, else RR.
+ * A running SYSTEM task is never preempted, a PERIODIC one only by SYSTEM, which costs it a
+ * kernel entry.
+ */
+static void dispatch(sim_t* sim) {
+    uint8_t i;
+
+    if(sim->running != RUN_NONE && sim->set->tasks[sim->running].level == SYSTEM) {
+        return;
+    }
+    if(sim->backlog_count > 0) {
+        if(sim->running != RUN_NONE) {
+            sim->jobs[sim->running].charged_us += sim->set->overhead_us;
+        }
+        sim->system_job = sim->backlog[sim->backlog_head];
+        sim->backlog_head = (sim->backlog_head + 1) % SYSTEM_BACKLOG;
+        sim->backlog_count--;
+        sim->system_remaining = sim->set->tasks[sim->system_job.task].exec_us;
+        sim->running = sim->system_job.task;
+        return;
+    }
+    if(sim->running != RUN_NONE) {
+        return;
+    }
+    for(i = 0; i < sim->set->count; i++) {
+        if(sim->set->tasks[i].level == PERIODIC && sim->jobs[i].pending) {
+            sim->running = i;
+            return;
+        }
+    }
+}
+
+/**
+ * Run the CPU from t to end.  Returns 0 once os.c would have aborted.
+ */
+static uint8_t run_until(sim_t* sim, uint64_t t, uint64_t end) {
+    const taskset_t* set = sim->set;
+
+    while(t < end) {
+        uint64_t next = end, arrival;
+        admit_arrivals(sim, t);
+        dispatch(sim);
+
+        if(sim->running == RUN_NONE) {
+            /* RR tasks or idle until something arrives. */
+            arrival = next_arrival(sim);
+            if(arrival < next) next = arrival;
+            if(t - sim->rr_last > sim->report->rr_starved_us) {
+                sim->report->rr_starved_us = (uint32_t)(t - sim->rr_last);
+            }
+            sim->rr_last = next;
+            t = next;
+        } else if(set->tasks[sim->running].level == SYSTEM) {
+            if(t + sim->system_remaining < next) next = t + sim->system_remaining;
+            sim->system_remaining -= next - t;
+            t = next;
+            if(sim->system_remaining == 0) {
+                observe(&sim->report->tasks[sim->running], t - sim->system_job.arrival_us);
+                sim->running = RUN_NONE;
+            }
+        } else {
+            const task_spec_t* task = &set->tasks[sim->running];
+            periodic_job_t* job = &sim->jobs[sim->running];
+            uint64_t left = task->wcet_us > job->charged_us ? task->wcet_us - job->charged_us : 0;
+
+            /* The end of its slot: kernel_update_periodic() aborts. */
+            if(left == 0) {
+                set_error(sim->report, ERR_RUN_3_PERIODIC_TOOK_TOO_LONG, t, sim->running, sim->running);
+                return 0;
+            }
+            arrival = next_arrival(sim);
+            if(arrival < next) next = arrival;
+            if(t + job->remaining_us < next) next = t + job->remaining_us;
+            if(t + left < next) next = t + left;
+            job->remaining_us -= next - t;
+            job->charged_us += next - t;
+            t = next;
+            if(job->remaining_us == 0) {
+                observe(&sim->report->tasks[sim->running], t - job->release_us);
+                job->pending = 0;
+                if(job->queued > 0) {
+                    /* Released again while it was still running: run it straight away. */
+                    job->queued--;
+                    job->pending = 1;
+                    job->release_us = t;
+                    job->remaining_us = task->exec_us;
+                    job->charged_us = 0;
+                }
+                sim->running = RUN_NONE;
+            }
+        }
+    }
+    return 1;
+}
+
+/**
+ * A kernel entry at a TICK or a PERIODIC release: the entry is charged to the running PERIODIC
+ * task, as kernel_update_clock() does, then the PERIODIC rules of kernel_update_periodic() and
+ * kernel_find_periodic() for the releases that have come.  Returns 0 once os.c would have
+ * aborted.
+ */
+static uint8_t kernel_entry(sim_t* sim, uint64_t now) {
+    const taskset_t* set = sim->set;
+    uint8_t i, k;
+
+    if(sim->running != RUN_NONE && set->tasks[sim->running].level == PERIODIC) {
+        periodic_job_t* job = &sim->jobs[sim->running];
+        job->charged_us += set->overhead_us;
+        if(job->charged_us >= set->tasks[sim->running].wcet_us) {
+            set_error(sim->report, ERR_RUN_3_PERIODIC_TOOK_TOO_LONG, now, sim->running, sim->running);
+            return 0;
+        }
+    }
+
+    for(i = 0; i < set->count; i++) {
+        const task_spec_t* task = &set->tasks[i];
+        if(task->level != PERIODIC || sim->next_release[i] > now) {
+            continue;
+        }
+        sim->next_release[i] += task->period_us;
+        for(k = 0; k < set->count; k++) {
+            if(k != i && sim->jobs[k].pending) {
+                set_error(sim->report, ERR_RUN_6_PERIODIC_TASK_COLLISION, now, i, k);
+                return 0;
+            }
+        }
+        if(sim->jobs[i].pending) {
+            /* Still running from its last release: a deadline miss, though not an abort. */
+            sim->jobs[i].queued++;
+            observe(&sim->report->tasks[i], now - sim->jobs[i].release_us);
+            continue;
+        }
+        sim->jobs[i].pending = 1;
+        sim->jobs[i].release_us = now;
+        sim->jobs[i].remaining_us = task->exec_us;
+        sim->jobs[i].charged_us = 0;
+    }
+    return 1;
+}
+
+static void simulate(const taskset_t* set, rta_report_t* report) {
+    sim_t sim;
+    uint64_t limit = (uint64_t)RTA_MAX_SIM_TICKS * set->tick_us;
+    uint64_t end, longest = 0, now = 0, next_tick = 0, entry;
+    uint8_t i;
+
+    memset(&sim, 0, sizeof(sim));
+    sim.set = set;
+    sim.report = report;
+    sim.running = RUN_NONE;
+
+    report->hyperperiod_us = hyperperiod(set, limit);
+    end = report->hyperperiod_us;
+    for(i = 0; i < set->count; i++) {
+        if(set->tasks[i].level == PERIODIC) {
+            sim.next_release[i] = set->tasks[i].start_us;
+            if(set->tasks[i].start_us > longest) longest = set->tasks[i].start_us;
+        }
+        if(set->tasks[i].level == SYSTEM && set->tasks[i].interarrival_us > end) {
+            end = set->tasks[i].interarrival_us;
+        }
+    }
+    end += longest + set->tick_us;
+    if(end > limit) end = limit;
+
+    while(now < end) {
+        /* The next kernel entry: the next TICK, or a PERIODIC release before it. */
+        entry = next_tick;
+        for(i = 0; i < set->count; i++) {
+            if(set->tasks[i].level == PERIODIC && sim.next_release[i] < entry) entry = sim.next_release[i];
+        }
+        if(!run_until(&sim, now, entry)) {
+            now = report->error_us;
+            break;
+        }
+        if(!kernel_entry(&sim, entry)) {
+            now = entry;
+            break;
+        }
+        if(entry == next_tick) next_tick += set->tick_us;
+        /* SYSTEM tasks arriving during the kernel entry wait for it. */
+        now = entry + set->overhead_us;
+    }
+    report->simulated_us = now;
+}
+
+uint8_t Rta_Analyse(const taskset_t* set, rta_report_t* report) {
+    report_init(report);
+    analyse_responses(set, report);
+    simulate(set, report);
+    return judge(set, report);
+}
+
+/* ==== Start time search ==== */
+
+/**
+ * Can PERIODIC task b start at its current start time, given the tasks before it?
+ */
+static uint8_t fits(const taskset_t* set, const rta_report_t* report, uint8_t b) {
+    uint8_t a;
+    for(a = 0; a < b; a++) {
+        if(set->tasks[a].level != PERIODIC) continue;
+        if(release_gap(&set->tasks[a], &set->tasks[b]) < report->tasks[a].response_us) return 0;
+        if(release_gap(&set->tasks[b], &set->tasks[a]) < report->tasks[b].response_us) return 0;
+    }
+    return 1;
+}
+
+static uint8_t search(taskset_t* set, const rta_report_t* report, const uint32_t* earliest, uint8_t i) {
+    task_spec_t* task;
+    uint32_t s, step;
+
+    while(i < set->count && set->tasks[i].level != PERIODIC) i++;
+    if(i == set->count) {
+        return 1;
+    }
+    task = &set->tasks[i];
+    step = task->us ? task->period_us / RTA_START_STEPS : set->tick_us;
+    if(step == 0) step = 1;
+    for(s = 0; s < task->period_us; s += step) {
+        task->start_us = earliest[i] + s;
+        if(fits(set, report, i) && search(set, report, earliest, i + 1)) {
+            return 1;
+        }
+    }
+    task->start_us = earliest[i];
+    return 0;
+}
+
+uint8_t Rta_Search_Starts(taskset_t* set, rta_report_t* report) {
+    uint32_t earliest[TASKSET_MAX_TASKS];
+    uint8_t i;
+
+    report_init(report);
+    analyse_responses(set, report);
+    for(i = 0; i < set->count; i++) {
+        earliest[i] = set->tasks[i].start_us;
+        if(set->tasks[i].level == PERIODIC &&
+           (report->tasks[i].response_us == RTA_UNBOUNDED || !report->tasks[i].budget_ok ||
+            report->tasks[i].response_us > set->tasks[i].period_us)) {
+            return 0;
+        }
+    }
+    if(!search(set, report, earliest, 0)) {
+        return 0;
+    }
+    return Rta_Check(set, report);
+}
@@ -0,0 +1,99 @@
+/*
+ * rta.h
+ *
+ * Response-time analysis of a task set under the scheduling policy of os.c.
+ *
+ * Two checks are made:
+ *
+ *   - Analysis, which holds for every phasing of the SYSTEM tasks.  SYSTEM tasks run first come
+ *     first served and to completion, so each one waits at most one SYSTEM busy period.  A
+ *     PERIODIC activation is preempted by every SYSTEM activation and tick interrupt during its
+ *     response.  PERIODIC activations must finish before the next PERIODIC release of any
+ *     task, since os.c aborts with ERR_RUN_6_PERIODIC_TASK_COLLISION when two are ready.
+ *
+ *   - Simulation of the PERIODIC rules of os.c over the hyperperiod after the last start time,
+ *     with every SYSTEM task activated as often as allowed from time 0.  The kernel is entered
+ *     at each TICK and at each PERIODIC release, which need not fall on a TICK.  This gives
+ *     the observed response times and the first abort os.c would take, if any.
+ *
+ * As in kernel_update_clock(), a PERIODIC activation is charged the time it runs, including
+ * the kernel entries while it runs, and os.c aborts it when the charge reaches its wcet.  Time
+ * it spends preempted by SYSTEM tasks is not charged.
+ */
+
+#ifndef RTA_H_
+#define RTA_H_
+
+#include <stdint.h>
+#include "taskset.h"
+
+/** A response time that does not converge before its deadline. */
+#define RTA_UNBOUNDED       UINT32_MAX
+
+/** Longest simulation, in TICKs. */
+#define RTA_MAX_SIM_TICKS   10000000UL
+
+/** Start times tried per period for a periodic_us task. */
+#define RTA_START_STEPS     100
+
+typedef struct _task_result {
+    /** Worst-case response time from the analysis, in us, or RTA_UNBOUNDED. */
+    uint32_t response_us;
+    /** Longest response seen in the simulation, in us. */
+    uint32_t observed_us;
+    /**
+     * PERIODIC: time from a release to the nearest following PERIODIC release of any task.
+     * SYSTEM: the time between activations.  In us.
+     */
+    uint32_t deadline_us;
+    /** deadline_us - response_us. */
+    int32_t slack_us;
+    /** PERIODIC: the exec time plus the kernel entries charged to it stays under the wcet. */
+    uint8_t budget_ok;
+    uint8_t schedulable;
+} task_result_t;
+
+typedef struct _rta_report {
+    task_result_t tasks[TASKSET_MAX_TASKS];
+    /** Share of the CPU used by the tick interrupt, SYSTEM and PERIODIC tasks. */
+    double utilisation;
+    /** Share of the CPU left to RR tasks, and the share they want. */
+    double rr_share;
+    double rr_demand;
+    /** Longest time the RR tasks went without the CPU in the simulation, in us. */
+    uint32_t rr_starved_us;
+
+    /** In us. */
+    uint64_t hyperperiod_us;
+    uint64_t simulated_us;
+
+    /** First abort of os.c in the simulation: an error_code.h value, or RTA_NO_ERROR, and when. */
+    uint8_t error;
+    uint64_t error_us;
+    /** The task that caused the error, and for a collision the task it collided with. */
+    uint8_t error_task;
+    uint8_t error_other;
+
+    uint8_t schedulable;
+} rta_report_t;
+
+#define RTA_NO_ERROR        0xFF
+
+/**
+ * Analyse and simulate a task set.  Returns 1 if it is schedulable, 0 if not.
+ */
+uint8_t Rta_Analyse(const taskset_t* set, rta_report_t* report);
+
+/**
+ * Analysis only: quick enough to call in a search loop.  Returns 1 if schedulable.
+ */
+uint8_t Rta_Check(const taskset_t* set, rta_report_t* report);
+
+/**
+ * Look for PERIODIC start times, each no earlier than the one given and less than a period
+ * later, under which the set passes Rta_Check().  Updates set and returns 1 if found.  Starts
+ * are tried a TICK apart, or for periodic_us tasks RTA_START_STEPS times a period.
+ */
+uint8_t Rta_Search_Starts(taskset_t* set, rta_report_t* report);
+
+#endif /* RTA_H_ */
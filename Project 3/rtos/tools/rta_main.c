@@ -0,0 +1,147 @@
+/*
+ * rta_main.c
+ *
+ * Check a task set against the scheduling policy of os.c before flashing it.
+ *
+ * Usage: rta [-q] [-a] [-s] file.tasks
+ *   -q  print nothing; the exit status says whether the set is schedulable
+ *   -a  analysis only, no simulation
+ *   -s  search for PERIODIC start times that make the set schedulable
+ *
+ * Exit status: 0 schedulable, 1 not schedulable, 2 bad usage or task set.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "error_code.h"
+#include "error_name.h"
+#include "rta.h"
+
+static const char* level_name(uint8_t level) {
+    switch(level) {
+        case SYSTEM: return "SYSTEM";
+        case PERIODIC: return "PERIODIC";
+        default: return "RR";
+    }
+}
+
+static void print_time(uint32_t us) {
+    if(us == RTA_UNBOUNDED) printf(" %9s", "unbounded");
+    else printf(" %6.2f ms", us / 1000.0);
+}
+
+/* A PERIODIC period, wcet or start in the unit it was declared in. */
+static void print_periodic(const taskset_t* set, const task_spec_t* task, uint32_t us, int width) {
+    char text[16];
+    if(task->us) snprintf(text, sizeof(text), "%luus", (unsigned long)us);
+    else snprintf(text, sizeof(text), "%lu", (unsigned long)(us / set->tick_us));
+    printf(" %*s", width, text);
+}
+
+static void print_report(const char* path, const taskset_t* set, const rta_report_t* report, int simulated) {
+    uint8_t i;
+
+    printf("%s: TICK %.2f ms, tick interrupt %u us\n\n", path, set->tick_us / 1000.0, set->overhead_us);
+    printf("%-20s %-8s %8s %7s %8s %9s %9s %9s %9s %9s  %s\n",
+           "task", "level", "period", "wcet", "start", "exec", "response", "observed", "deadline", "slack", "");
+    for(i = 0; i < set->count; i++) {
+        const task_spec_t* task = &set->tasks[i];
+        const task_result_t* result = &report->tasks[i];
+
+        printf("%-20s %-8s", task->name, level_name(task->level));
+        if(task->level == PERIODIC) {
+            print_periodic(set, task, task->period_us, 8);
+            print_periodic(set, task, task->wcet_us, 7);
+            print_periodic(set, task, task->start_us, 8);
+        } else {
+            printf(" %8s %7s %8s", "", "", "");
+        }
+        if(task->level == RR) {
+            printf("   load %3.0f%%\n", 100 * task->load);
+            continue;
+        }
+        print_time(task->exec_us);
+        print_time(result->response_us);
+        if(simulated) print_time(result->observed_us);
+        else printf(" %9s", "-");
+        print_time(result->deadline_us);
+        if(result->slack_us == INT32_MIN) printf(" %9s", "-");
+        else printf(" %6.2f ms", result->slack_us / 1000.0);
+        printf("  %s%s\n", result->schedulable ? "ok" : "MISSED",
+               task->level == PERIODIC && !result->budget_ok ? ", over wcet" : "");
+    }
+
+    printf("\nutilisation %.1f%%, RR share %.1f%% (wanted %.1f%%)", 100 * report->utilisation,
+           100 * report->rr_share, 100 * report->rr_demand);
+    if(simulated) {
+        printf(", RR waited at most %.2f ms\n", report->rr_starved_us / 1000.0);
+        printf("hyperperiod %.2f ms, simulated %.2f ms\n", report->hyperperiod_us / 1000.0,
+               report->simulated_us / 1000.0);
+    } else {
+        printf("\n");
+    }
+
+    if(report->error == RTA_NO_ERROR) {
+        printf("first abort: none\n");
+    } else if(report->error == ERR_RUN_6_PERIODIC_TASK_COLLISION) {
+        printf("first abort: %s at %.2f ms, %s released while %s is still ready\n", Error_Name(report->error),
+               report->error_us / 1000.0, set->tasks[report->error_task].name, set->tasks[report->error_other].name);
+    } else if(report->error == ERR_RUN_2_TOO_MANY_TASKS) {
+        printf("first abort: %s, only %d tasks fit beside r_main\n", Error_Name(report->error), MAXPROCESS - 1);
+    } else {
+        printf("first abort: %s at %.2f ms, %s\n", Error_Name(report->error), report->error_us / 1000.0,
+               set->tasks[report->error_task].name);
+    }
+    if(report->rr_demand > report->rr_share) {
+        printf("warning: RR tasks want more of the CPU than is left\n");
+    }
+    printf("%s\n", report->schedulable ? "schedulable" : "NOT schedulable");
+}
+
+int main(int argc, char** argv) {
+    taskset_t set;
+    rta_report_t report;
+    char error[256];
+    const char* path = NULL;
+    int quiet = 0, simulate = 1, search = 0;
+    int i;
+    uint8_t schedulable;
+
+    for(i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-q") == 0) quiet = 1;
+        else if(strcmp(argv[i], "-a") == 0) simulate = 0;
+        else if(strcmp(argv[i], "-s") == 0) search = 1;
+        else if(argv[i][0] != '-' && !path) path = argv[i];
+        else path = NULL, i = argc;
+    }
+    if(!path) {
+        fprintf(stderr, "usage: rta [-q] [-a] [-s] file.tasks\n");
+        return 2;
+    }
+    if(Taskset_Load(path, &set, error, sizeof(error)) != 0) {
+        fprintf(stderr, "rta: %s\n", error);
+        return 2;
+    }
+
+    if(search) {
+        if(!Rta_Search_Starts(&set, &report)) {
+            if(!quiet) printf("no PERIODIC start times make %s schedulable\n", path);
+            return 1;
+        }
+        if(!quiet) {
+            printf("start times found:");
+            for(i = 0; i < set.count; i++) {
+                if(set.tasks[i].level != PERIODIC) continue;
+                if(set.tasks[i].us) printf(" %s=%luus", set.tasks[i].name, (unsigned long)set.tasks[i].start_us);
+                else printf(" %s=%lu", set.tasks[i].name, (unsigned long)(set.tasks[i].start_us / set.tick_us));
+            }
+            printf("\n");
+        }
+    }
+
+    schedulable = simulate ? Rta_Analyse(&set, &report) : Rta_Check(&set, &report);
+    if(!quiet) {
+        print_report(path, &set, &report, simulate);
+    }
+    return schedulable ? 0 : 1;
+}
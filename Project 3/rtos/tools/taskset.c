@@ -0,0 +1,167 @@
+/*
+ * taskset.c
+ *
+ * Task set file reader.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "taskset.h"
+
+#define LINE_LENGTH 256
+
+typedef enum _unit {
+    UNIT_US,
+    UNIT_MS,
+    UNIT_TICKS
+} unit_t;
+
+/**
+ * Parse a time like "28ms", "40us", "1.5s" or "8t" into us.  A bare number is in default_unit.
+ */
+static int parse_time(const char* text, unit_t default_unit, uint32_t tick_us, uint32_t* us) {
+    char* end;
+    double value = strtod(text, &end);
+    double scale;
+
+    if(end == text || value < 0) {
+        return -1;
+    }
+    if(*end == '\0') scale = default_unit == UNIT_TICKS ? tick_us : default_unit == UNIT_US ? 1 : 1000.0;
+    else if(strcmp(end, "us") == 0) scale = 1;
+    else if(strcmp(end, "ms") == 0) scale = 1000.0;
+    else if(strcmp(end, "s") == 0) scale = 1000000.0;
+    else if(strcmp(end, "t") == 0) scale = tick_us;
+    else return -1;
+
+    value *= scale;
+    if(value > 4e9) {
+        return -1;
+    }
+    *us = (uint32_t)(value + 0.5);
+    return 0;
+}
+
+/**
+ * Parse a periodic parameter: for Task_Create_Periodic() a whole number of TICKs, which fits in
+ * its uint16_t, for Task_Create_Periodic_Us() any number of us.
+ */
+static int parse_periodic(const char* text, uint8_t in_us, uint32_t tick_us, uint32_t* us) {
+    if(in_us) {
+        return parse_time(text, UNIT_US, tick_us, us);
+    }
+    if(parse_time(text, UNIT_TICKS, tick_us, us) != 0 || *us % tick_us != 0 || *us / tick_us > UINT16_MAX) {
+        return -1;
+    }
+    return 0;
+}
+
+static int parse_rate(const char* text, uint32_t* interarrival_us) {
+    char* end;
+    double rate = strtod(text, &end);
+    if(end == text || rate <= 0 || (strcmp(end, "/s") != 0 && *end != '\0')) {
+        return -1;
+    }
+    *interarrival_us = (uint32_t)(1000000.0 / rate + 0.5);
+    return 0;
+}
+
+void Taskset_Init(taskset_t* set) {
+    memset(set, 0, sizeof(*set));
+    set->tick_us = TICK * 1000UL;
+}
+
+int Taskset_Load(const char* path, taskset_t* set, char* error, size_t error_size) {
+    FILE* file = fopen(path, "r");
+    char line[LINE_LENGTH];
+    unsigned line_number = 0;
+
+    Taskset_Init(set);
+    if(!file) {
+        snprintf(error, error_size, "%s: cannot open", path);
+        return -1;
+    }
+
+#define FAIL(...) do { \
+        int n = snprintf(error, error_size, "%s:%u: ", path, line_number); \
+        snprintf(error + n, error_size - n, __VA_ARGS__); \
+        fclose(file); \
+        return -1; \
+    } while(0)
+
+    while(fgets(line, sizeof(line), file)) {
+        char* word;
+        char* comment = strchr(line, '#');
+        task_spec_t* task;
+
+        line_number++;
+        if(comment) *comment = '\0';
+        word = strtok(line, " \t\r\n");
+        if(!word) {
+            continue;
+        }
+
+        if(strcmp(word, "tick") == 0 || strcmp(word, "overhead") == 0) {
+            char* value = strtok(NULL, " \t\r\n");
+            uint32_t us;
+            if(!value || parse_time(value, UNIT_MS, set->tick_us, &us) != 0) FAIL("bad %s", word);
+            if(word[0] == 't') {
+                if(us == 0) FAIL("tick must not be 0");
+                if(set->count > 0) FAIL("tick must come before the tasks");
+                set->tick_us = us;
+            } else {
+                set->overhead_us = us;
+            }
+            continue;
+        }
+
+        if(set->count == TASKSET_MAX_TASKS) FAIL("more than %d tasks", TASKSET_MAX_TASKS);
+        task = &set->tasks[set->count];
+        memset(task, 0, sizeof(*task));
+        if(strcmp(word, "system") == 0) task->level = SYSTEM;
+        else if(strcmp(word, "periodic") == 0) task->level = PERIODIC;
+        else if(strcmp(word, "periodic_us") == 0) task->level = PERIODIC, task->us = 1;
+        else if(strcmp(word, "rr") == 0) task->level = RR;
+        else FAIL("unknown declaration '%s'", word);
+
+        word = strtok(NULL, " \t\r\n");
+        if(!word || strchr(word, '=')) FAIL("missing task name");
+        strncpy(task->name, word, TASKSET_NAME_LENGTH - 1);
+
+        while((word = strtok(NULL, " \t\r\n")) != NULL) {
+            char* value = strchr(word, '=');
+            int bad;
+            if(!value) FAIL("expected name=value, got '%s'", word);
+            *value++ = '\0';
+
+            if(task->level == PERIODIC && strcmp(word, "period") == 0) bad = parse_periodic(value, task->us, set->tick_us, &task->period_us);
+            else if(task->level == PERIODIC && strcmp(word, "wcet") == 0) bad = parse_periodic(value, task->us, set->tick_us, &task->wcet_us);
+            else if(task->level == PERIODIC && strcmp(word, "start") == 0) bad = parse_periodic(value, task->us, set->tick_us, &task->start_us);
+            else if(task->level != RR && strcmp(word, "exec") == 0) bad = parse_time(value, UNIT_MS, set->tick_us, &task->exec_us);
+            else if(task->level == SYSTEM && strcmp(word, "every") == 0) bad = parse_time(value, UNIT_MS, set->tick_us, &task->interarrival_us);
+            else if(task->level == SYSTEM && strcmp(word, "rate") == 0) bad = parse_rate(value, &task->interarrival_us);
+            else if(task->level == RR && strcmp(word, "load") == 0) {
+                char* end;
+                task->load = strtod(value, &end);
+                bad = end == value || *end != '\0' || task->load < 0 || task->load > 1;
+            }
+            else FAIL("'%s' does not apply to %s", word, task->name);
+            if(bad) FAIL("bad %s '%s'", word, value);
+        }
+
+        if(task->level == PERIODIC) {
+            if(task->period_us == 0 || task->wcet_us == 0) FAIL("%s needs a period and a wcet", task->name);
+            if(task->exec_us == 0) task->exec_us = task->wcet_us;
+        }
+        if(task->level == SYSTEM && (task->interarrival_us == 0 || task->exec_us == 0)) {
+            FAIL("%s needs every= or rate=, and exec=", task->name);
+        }
+        set->count++;
+    }
+
+#undef FAIL
+
+    fclose(file);
+    return 0;
+}
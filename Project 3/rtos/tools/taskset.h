@@ -0,0 +1,71 @@
+/*
+ * taskset.h
+ *
+ * A description of the tasks an application creates, for the host-side analysis tools.
+ *
+ * Task set files hold one declaration per line; '#' starts a comment.
+ *
+ *   tick 5ms                       TICK length (default TICK from os.h)
+ *   overhead 40us                  time the kernel spends in each tick interrupt or release
+ *   periodic <name> period=20 wcet=8 start=200 [exec=28ms]
+ *                                  as passed to Task_Create_Periodic(), in TICKs; exec is the
+ *                                  longest time one activation runs (default: wcet)
+ *   periodic_us <name> period=250 wcet=100 start=1000 [exec=80us]
+ *                                  as passed to Task_Create_Periodic_Us(), in us
+ *   system <name> every=250ms exec=1ms
+ *   system <name> rate=4/s exec=1ms
+ *                                  a SYSTEM task activated at most once per "every", or at most
+ *                                  "rate" times a second, running at most exec each time
+ *   rr <name> [load=0.25]          a RR task wanting this share of the CPU (default 0)
+ *
+ * Times take a unit: us, ms, s, or t for TICKs.  The parameters of "periodic" default to TICKs
+ * and must be whole TICKs, those of "periodic_us" default to us, and all other times to ms.
+ * Both kinds of PERIODIC task are released at their exact times, counted from r_main(), which
+ * starts at a TICK.
+ */
+
+#ifndef TASKSET_H_
+#define TASKSET_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "os.h"
+
+#define TASKSET_MAX_TASKS   32
+#define TASKSET_NAME_LENGTH 24
+
+typedef struct _task_spec {
+    char name[TASKSET_NAME_LENGTH];
+    /** SYSTEM, PERIODIC or RR. */
+    uint8_t level;
+    /** PERIODIC: the period, the wcet its run time is held to, and the first release, in us. */
+    uint32_t period_us;
+    uint32_t wcet_us;
+    uint32_t start_us;
+    /** PERIODIC: declared with periodic_us, for Task_Create_Periodic_Us(); else in TICKs. */
+    uint8_t us;
+    /** SYSTEM and PERIODIC: longest run of one activation, in us. */
+    uint32_t exec_us;
+    /** SYSTEM: shortest time between activations, in us. */
+    uint32_t interarrival_us;
+    /** RR: share of the CPU wanted. */
+    double load;
+} task_spec_t;
+
+typedef struct _taskset {
+    uint32_t tick_us;
+    uint32_t overhead_us;
+    uint8_t count;
+    task_spec_t tasks[TASKSET_MAX_TASKS];
+} taskset_t;
+
+/** An empty task set with the TICK of os.h. */
+void Taskset_Init(taskset_t* set);
+
+/**
+ * Read a task set file.  Returns 0 on success, or -1 with a "file:line: reason" message in
+ * error.
+ */
+int Taskset_Load(const char* path, taskset_t* set, char* error, size_t error_size);
+
+#endif /* TASKSET_H_ */
@@ -0,0 +1,668 @@
+/*
+ * wcet.c
+ *
+ * Measure the execution time of one task body under simavr.
+ *
+ * Usage: wcet [-n activations] [-m margin] [-r packets] [-s seed] [-T ticks] -t task firmware.elf traffic
+ *   -t  the task to profile: its function name, or its index in the order r_main() creates tasks
+ *   -n  activations to measure (default 2000)
+ *   -m  safety margin added to the longest activation before rounding up to TICKs (default 0.2)
+ *   -r  most radio packets waiting at the start of an activation (default 3)
+ *   -s  seed for the choice of recorded traffic
+ *   -T  longest activation allowed, in TICKs, before giving up (default 100)
+ *
+ * The firmware is the application linked against wcet_os.c (see build_wcet.sh).  It talks to a
+ * Roomba on UART1 and an nRF24L01 radio on SPI, both played back from the traffic file:
+ *
+ *   sensor <group> <bytes>     a recorded reply to a sensor query for that group, in hex
+ *   radio <bytes>              a recorded radio packet, in hex, padded to 32 bytes
+ *
+ * Each sensor query gets a reply picked at random among those recorded for its group, and each
+ * activation starts with up to -r recorded packets waiting in the radio.
+ *
+ * Reports the distribution of cycles per activation, the functions the longest activation went
+ * through with the number of calls to each, and the wcet to pass to Task_Create_Periodic().
+ */
+
+#include <fcntl.h>
+#include <gelf.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sim_avr.h"
+#include "sim_elf.h"
+#include "avr_eeprom.h"
+#include "avr_ioport.h"
+#include "avr_spi.h"
+#include "avr_uart.h"
+
+#include "os.h"
+#include "nRF24L01.h"
+#include "roomba_sci.h"
+#include "wcet_protocol.h"
+
+#define DEFAULT_ACTIVATIONS 2000
+#define DEFAULT_MARGIN      0.2
+#define DEFAULT_PACKETS     3
+#define DEFAULT_TIMEOUT     100
+
+#define DEFAULT_MCU         "atmega2560"
+#define DEFAULT_FREQUENCY   16000000UL
+
+/** Functions shown for the longest activation. */
+#define PATH_LENGTH         48
+
+#define HISTOGRAM_BINS      12
+#define HISTOGRAM_WIDTH     50
+
+#define TRAFFIC_LENGTH      32
+#define RADIO_FIFO_SIZE     3
+#define RADIO_ADDRESS_WIDTH 5
+
+#ifndef _BV
+#define _BV(bit)            (1 << (bit))
+#endif
+
+/* ==== Recorded traffic ==== */
+
+typedef struct _record {
+    uint8_t group;
+    uint8_t length;
+    uint8_t bytes[TRAFFIC_LENGTH];
+} record_t;
+
+typedef struct _traffic {
+    record_t* sensors;
+    uint32_t sensor_count;
+    record_t* packets;
+    uint32_t packet_count;
+} traffic_t;
+
+static int parse_bytes(char* text, record_t* record) {
+    char* word;
+    for(word = strtok(text, " \t\r\n"); word; word = strtok(NULL, " \t\r\n")) {
+        char* end;
+        unsigned long value = strtoul(word, &end, 16);
+        if(*end != '\0' || value > 0xFF || record->length == TRAFFIC_LENGTH) {
+            return -1;
+        }
+        record->bytes[record->length++] = (uint8_t)value;
+    }
+    return 0;
+}
+
+static int traffic_load(const char* path, traffic_t* traffic) {
+    FILE* file = fopen(path, "r");
+    char line[256];
+    unsigned line_number = 0;
+
+    memset(traffic, 0, sizeof(*traffic));
+    if(!file) {
+        fprintf(stderr, "wcet: %s: cannot open\n", path);
+        return -1;
+    }
+    while(fgets(line, sizeof(line), file)) {
+        char* comment = strchr(line, '#');
+        char* word;
+        record_t record;
+        record_t** list;
+        uint32_t* count;
+
+        line_number++;
+        if(comment) *comment = '\0';
+        word = strtok(line, " \t\r\n");
+        if(!word) {
+            continue;
+        }
+        memset(&record, 0, sizeof(record));
+        if(strcmp(word, "sensor") == 0) {
+            char* group = strtok(NULL, " \t\r\n");
+            if(!group || atoi(group) <= 0 || atoi(group) > 0xFF) goto bad;
+            record.group = (uint8_t)atoi(group);
+            list = &traffic->sensors;
+            count = &traffic->sensor_count;
+        } else if(strcmp(word, "radio") == 0) {
+            list = &traffic->packets;
+            count = &traffic->packet_count;
+        } else {
+            goto bad;
+        }
+        if(parse_bytes(strtok(NULL, "\n"), &record) != 0 || record.length == 0) goto bad;
+
+        *list = realloc(*list, (*count + 1) * sizeof(record_t));
+        (*list)[(*count)++] = record;
+    }
+    fclose(file);
+    return 0;
+
+bad:
+    fprintf(stderr, "wcet: %s:%u: expected 'sensor <group> <hex bytes>' or 'radio <hex bytes>'\n", path, line_number);
+    fclose(file);
+    return -1;
+}
+
+/* ==== Firmware symbols ==== */
+
+typedef struct _symbols {
+    char** names;
+    uint32_t count;
+    /** For each flash word, 1 + the function starting there, or 0. */
+    uint16_t* entry;
+    uint32_t words;
+} symbols_t;
+
+static int symbols_load(const char* path, symbols_t* symbols) {
+    int fd = open(path, O_RDONLY);
+    Elf* elf;
+    Elf_Scn* section = NULL;
+
+    memset(symbols, 0, sizeof(*symbols));
+    if(fd < 0 || elf_version(EV_CURRENT) == EV_NONE || (elf = elf_begin(fd, ELF_C_READ, NULL)) == NULL) {
+        if(fd >= 0) close(fd);
+        return -1;
+    }
+    symbols->words = 0x20000;
+    symbols->entry = calloc(symbols->words, sizeof(uint16_t));
+
+    while((section = elf_nextscn(elf, section)) != NULL) {
+        GElf_Shdr header;
+        Elf_Data* data;
+        size_t i;
+
+        if(gelf_getshdr(section, &header) == NULL || header.sh_type != SHT_SYMTAB) {
+            continue;
+        }
+        data = elf_getdata(section, NULL);
+        for(i = 0; data && i < header.sh_size / header.sh_entsize; i++) {
+            GElf_Sym symbol;
+            uint32_t word;
+
+            gelf_getsym(data, i, &symbol);
+            word = (uint32_t)(symbol.st_value >> 1);
+            if(GELF_ST_TYPE(symbol.st_info) != STT_FUNC || word >= symbols->words || symbols->entry[word] != 0 ||
+               symbols->count == UINT16_MAX - 1) {
+                continue;
+            }
+            symbols->names = realloc(symbols->names, (symbols->count + 1) * sizeof(char*));
+            symbols->names[symbols->count] = strdup(elf_strptr(elf, header.sh_link, symbol.st_name));
+            symbols->entry[word] = (uint16_t)(++symbols->count);
+        }
+    }
+    elf_end(elf);
+    close(fd);
+    return symbols->count > 0 ? 0 : -1;
+}
+
+static const char* symbol_at(const symbols_t* symbols, uint32_t word) {
+    if(word < symbols->words && symbols->entry[word] != 0) {
+        return symbols->names[symbols->entry[word] - 1];
+    }
+    return "?";
+}
+
+/* ==== Harness ==== */
+
+typedef struct _path_step {
+    uint16_t symbol;
+    uint32_t calls;
+} path_step_t;
+
+/** The functions an activation entered, in the order first entered. */
+typedef struct _path {
+    uint16_t length;
+    uint8_t truncated;
+    uint16_t last;
+    path_step_t steps[PATH_LENGTH];
+} path_t;
+
+/** Just enough of an nRF24L01 for radio.c. */
+typedef struct _nrf {
+    uint8_t registers[32][RADIO_ADDRESS_WIDTH];
+    uint8_t fifo[RADIO_FIFO_SIZE][TRAFFIC_LENGTH];
+    uint8_t fifo_count;
+    uint8_t selected;
+    uint8_t command;
+    uint8_t index;
+    uint8_t read_payload;
+} nrf_t;
+
+typedef struct _harness {
+    avr_t* avr;
+    const traffic_t* traffic;
+    uint64_t rng;
+    uint8_t max_packets;
+
+    uint8_t stopped;
+    uint8_t mark;
+    uint8_t describe[WCET_DESCRIBE_LENGTH];
+    uint8_t describe_count;
+
+    uint8_t open;
+    avr_cycle_count_t begin;
+    path_t path;
+
+    /* Every activation measured, and the longest. */
+    uint64_t* cycles;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t longest;
+    path_t longest_path;
+
+    uint8_t sci_command;
+    uint8_t sci_arguments;
+    avr_irq_t* uart_in;
+
+    nrf_t nrf;
+    avr_irq_t* spi_in;
+} harness_t;
+
+static uint64_t rng_next(uint64_t* state) {
+    /* splitmix64 */
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static void path_enter(path_t* path, uint16_t symbol) {
+    uint16_t i;
+
+    if(path->length > 0 && path->steps[path->last].symbol == symbol) {
+        path->steps[path->last].calls++;
+        return;
+    }
+    for(i = 0; i < path->length; i++) {
+        if(path->steps[i].symbol == symbol) {
+            path->steps[i].calls++;
+            path->last = i;
+            return;
+        }
+    }
+    if(path->length == PATH_LENGTH) {
+        path->truncated = 1;
+        return;
+    }
+    path->steps[path->length].symbol = symbol;
+    path->steps[path->length].calls = 1;
+    path->last = path->length++;
+}
+
+/**
+ * Fill the radio's receive FIFO with recorded packets for the coming activation.
+ */
+static void load_packets(harness_t* h) {
+    const traffic_t* traffic = h->traffic;
+    uint8_t packets;
+
+    h->nrf.fifo_count = 0;
+    if(traffic->packet_count == 0 || h->max_packets == 0) {
+        return;
+    }
+    packets = rng_next(&h->rng) % (h->max_packets + 1);
+    for(; packets > 0 && h->nrf.fifo_count < RADIO_FIFO_SIZE; packets--) {
+        const record_t* packet = &traffic->packets[rng_next(&h->rng) % traffic->packet_count];
+        memset(h->nrf.fifo[h->nrf.fifo_count], 0, TRAFFIC_LENGTH);
+        memcpy(h->nrf.fifo[h->nrf.fifo_count], packet->bytes, packet->length);
+        h->nrf.fifo_count++;
+    }
+}
+
+static void on_mark(avr_t* avr, avr_io_addr_t address, uint8_t value, void* param) {
+    harness_t* h = param;
+    (void)address;
+
+    h->mark = value;
+    if(value == WCET_MARK_BEGIN) {
+        h->open = 1;
+        h->begin = avr->cycle;
+        memset(&h->path, 0, sizeof(h->path));
+        load_packets(h);
+    } else if(value == WCET_MARK_END && h->open) {
+        uint64_t cycles = avr->cycle - h->begin;
+        h->open = 0;
+        if(h->count == h->capacity) {
+            h->capacity = h->capacity ? 2 * h->capacity : 1024;
+            h->cycles = realloc(h->cycles, h->capacity * sizeof(uint64_t));
+        }
+        if(h->count == 0 || cycles > h->cycles[h->longest]) {
+            h->longest = h->count;
+            h->longest_path = h->path;
+        }
+        h->cycles[h->count++] = cycles;
+    } else if(value == WCET_MARK_ABORT || value == WCET_MARK_NO_TASK) {
+        h->stopped = 1;
+    }
+}
+
+static void on_describe(avr_t* avr, avr_io_addr_t address, uint8_t value, void* param) {
+    harness_t* h = param;
+    (void)avr;
+    (void)address;
+
+    if(h->describe_count < WCET_DESCRIBE_LENGTH) {
+        h->describe[h->describe_count++] = value;
+    }
+}
+
+/**
+ * A byte from the AVR to the Roomba.  Sensor queries are answered from the recorded traffic.
+ */
+static void on_uart_output(struct avr_irq_t* irq, uint32_t value, void* param) {
+    harness_t* h = param;
+    const traffic_t* traffic = h->traffic;
+    uint32_t i, matches = 0, pick;
+    (void)irq;
+
+    if(h->sci_arguments > 0) {
+        h->sci_arguments--;
+        if(h->sci_command != SENSORS) {
+            return;
+        }
+        for(i = 0; i < traffic->sensor_count; i++) {
+            if(traffic->sensors[i].group == value) matches++;
+        }
+        if(matches == 0) {
+            fprintf(stderr, "wcet: no recorded reply for sensor group %u\n", value);
+            h->stopped = 1;
+            return;
+        }
+        pick = rng_next(&h->rng) % matches;
+        for(i = 0; i < traffic->sensor_count; i++) {
+            if(traffic->sensors[i].group == value && pick-- == 0) {
+                uint8_t j;
+                for(j = 0; j < traffic->sensors[i].length; j++) {
+                    avr_raise_irq(h->uart_in, traffic->sensors[i].bytes[j]);
+                }
+                return;
+            }
+        }
+    }
+
+    h->sci_command = (uint8_t)value;
+    switch(value) {
+        case DRIVE: h->sci_arguments = 4; break;
+        case LEDS: h->sci_arguments = 3; break;
+        case SENSORS:
+        case BAUD:
+        case PLAY: h->sci_arguments = 1; break;
+        default: h->sci_arguments = 0; break;
+    }
+}
+
+static uint8_t nrf_status(const nrf_t* nrf) {
+    uint8_t pipe = nrf->fifo_count > 0 ? 0 : 7;
+    return (nrf->registers[STATUS][0] & (_BV(RX_DR) | _BV(TX_DS) | _BV(MAX_RT))) | (pipe << RX_P_NO);
+}
+
+/**
+ * CSN, the radio's chip select, on PH6.
+ */
+static void on_radio_select(struct avr_irq_t* irq, uint32_t value, void* param) {
+    nrf_t* nrf = &((harness_t*)param)->nrf;
+    (void)irq;
+
+    if(value == 0) {
+        nrf->selected = 1;
+        nrf->index = 0;
+        nrf->read_payload = 0;
+        return;
+    }
+    if(nrf->selected && nrf->read_payload && nrf->fifo_count > 0) {
+        memmove(nrf->fifo[0], nrf->fifo[1], (RADIO_FIFO_SIZE - 1) * TRAFFIC_LENGTH);
+        nrf->fifo_count--;
+    }
+    if(nrf->selected && nrf->index > 0 && nrf->command == FLUSH_RX) {
+        nrf->fifo_count = 0;
+    }
+    nrf->selected = 0;
+}
+
+static void on_spi_output(struct avr_irq_t* irq, uint32_t value, void* param) {
+    harness_t* h = param;
+    nrf_t* nrf = &h->nrf;
+    uint8_t reply = 0xFF;
+    uint8_t reg = nrf->command & REGISTER_MASK;
+    uint8_t byte = nrf->index > 0 ? (nrf->index - 1) % RADIO_ADDRESS_WIDTH : 0;
+    (void)irq;
+
+    if(!nrf->selected) {
+        avr_raise_irq(h->spi_in, reply);
+        return;
+    }
+    if(nrf->index == 0) {
+        nrf->command = (uint8_t)value;
+        reply = nrf_status(nrf);
+    } else if(nrf->command < W_REGISTER) {
+        reply = nrf->registers[reg][byte];
+    } else if(nrf->command < W_REGISTER + 0x20) {
+        if(reg == STATUS) nrf->registers[STATUS][0] &= ~(uint8_t)value;
+        else nrf->registers[reg][byte] = (uint8_t)value;
+    } else if(nrf->command == R_RX_PAYLOAD) {
+        reply = nrf->index <= TRAFFIC_LENGTH ? nrf->fifo[0][nrf->index - 1] : 0;
+        nrf->read_payload = 1;
+    }
+    if(nrf->index < UINT8_MAX) nrf->index++;
+    avr_raise_irq(h->spi_in, reply);
+}
+
+/**
+ * Load the firmware with the index of the task to profile and run it until it has described
+ * that task.  Returns 0, or -1 if the firmware has fewer tasks or failed to start.
+ */
+static int harness_start(harness_t* h, elf_firmware_t* firmware, uint8_t index, avr_cycle_count_t timeout) {
+    avr_eeprom_desc_t eeprom = { &index, WCET_EEPROM_TASK, 1 };
+    uint32_t flags = 0;
+    char port;
+
+    h->avr = avr_make_mcu_by_name(firmware->mmcu);
+    if(!h->avr) {
+        fprintf(stderr, "wcet: simavr does not know the %s\n", firmware->mmcu);
+        return -1;
+    }
+    avr_init(h->avr);
+    avr_load_firmware(h->avr, firmware);
+    avr_ioctl(h->avr, AVR_IOCTL_EEPROM_SET, &eeprom);
+
+    for(port = '0'; port <= '1'; port++) {
+        avr_ioctl(h->avr, AVR_IOCTL_UART_GET_FLAGS(port), &flags);
+        flags &= ~AVR_UART_FLAG_STDIO;
+        avr_ioctl(h->avr, AVR_IOCTL_UART_SET_FLAGS(port), &flags);
+    }
+    h->uart_in = avr_io_getirq(h->avr, AVR_IOCTL_UART_GETIRQ('1'), UART_IRQ_INPUT);
+    h->spi_in = avr_io_getirq(h->avr, AVR_IOCTL_SPI_GETIRQ(0), SPI_IRQ_INPUT);
+    avr_irq_register_notify(avr_io_getirq(h->avr, AVR_IOCTL_UART_GETIRQ('1'), UART_IRQ_OUTPUT), on_uart_output, h);
+    avr_irq_register_notify(avr_io_getirq(h->avr, AVR_IOCTL_SPI_GETIRQ(0), SPI_IRQ_OUTPUT), on_spi_output, h);
+    avr_irq_register_notify(avr_io_getirq(h->avr, AVR_IOCTL_IOPORT_GETIRQ('H'), 6), on_radio_select, h);
+    avr_register_io_write(h->avr, WCET_MARK_ADDRESS, on_mark, h);
+    avr_register_io_write(h->avr, WCET_DESCRIBE_ADDRESS, on_describe, h);
+
+    /* r_main() may take a while: the roomba waits over a second for its radio and Roomba. */
+    while(h->describe_count < WCET_DESCRIBE_LENGTH && !h->stopped) {
+        int state = avr_run(h->avr);
+        if(state == cpu_Done || state == cpu_Crashed || h->avr->cycle > timeout * 10) {
+            fprintf(stderr, "wcet: the firmware did not reach the task\n");
+            return -1;
+        }
+    }
+    return h->stopped ? -1 : 0;
+}
+
+static void harness_stop(harness_t* h) {
+    if(h->avr) {
+        avr_terminate(h->avr);
+        free(h->avr);
+    }
+    free(h->cycles);
+}
+
+static int compare_cycles(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static const char* level_name(uint8_t level) {
+    switch(level) {
+        case SYSTEM: return "SYSTEM";
+        case PERIODIC: return "PERIODIC";
+        default: return "RR";
+    }
+}
+
+static void report(const harness_t* h, const symbols_t* symbols, const char* name, double margin) {
+    uint64_t* sorted = malloc(h->count * sizeof(uint64_t));
+    double cycles_per_ms = h->avr->frequency / 1000.0;
+    double cycles_per_tick = cycles_per_ms * TICK;
+    uint64_t low, high, longest = h->cycles[h->longest];
+    uint32_t bins[HISTOGRAM_BINS] = { 0 }, most = 0, i;
+    uint8_t level = h->describe[0];
+    uint16_t period = h->describe[3] | h->describe[4] << 8;
+    uint16_t wcet = h->describe[5] | h->describe[6] << 8;
+    double budget;
+    uint16_t suggested;
+
+    memcpy(sorted, h->cycles, h->count * sizeof(uint64_t));
+    qsort(sorted, h->count, sizeof(uint64_t), compare_cycles);
+    low = sorted[0];
+    high = sorted[h->count - 1];
+
+    printf("%s, %s", name, level_name(level));
+    if(level == PERIODIC) printf(" period %u wcet %u", period, wcet);
+    printf(": %u activations at %.0f MHz\n\n", h->count, h->avr->frequency / 1e6);
+
+    printf("cycles  min %llu  median %llu  99%% %llu  max %llu\n", (unsigned long long)low,
+           (unsigned long long)sorted[h->count / 2], (unsigned long long)sorted[(uint32_t)(h->count * 0.99)],
+           (unsigned long long)high);
+    printf("ms      min %.3f  median %.3f  99%% %.3f  max %.3f\n\n", low / cycles_per_ms,
+           sorted[h->count / 2] / cycles_per_ms, sorted[(uint32_t)(h->count * 0.99)] / cycles_per_ms,
+           high / cycles_per_ms);
+
+    for(i = 0; i < h->count; i++) {
+        uint32_t bin = high > low ? (uint32_t)((sorted[i] - low) * HISTOGRAM_BINS / (high - low + 1)) : 0;
+        if(++bins[bin] > most) most = bins[bin];
+    }
+    for(i = 0; i < HISTOGRAM_BINS; i++) {
+        uint32_t width = (uint32_t)((uint64_t)bins[i] * HISTOGRAM_WIDTH / most);
+        printf("%9.3f ms %7u ", (low + (double)(high - low) * i / HISTOGRAM_BINS) / cycles_per_ms, bins[i]);
+        while(width-- > 0) putchar('#');
+        putchar('\n');
+        if(high == low) break;
+    }
+
+    printf("\nlongest: activation %u, %llu cycles, %.3f ms\n", h->longest, (unsigned long long)longest,
+           longest / cycles_per_ms);
+    for(i = 0; i < h->longest_path.length; i++) {
+        const path_step_t* step = &h->longest_path.steps[i];
+        printf("  %-32s %8u call%s\n", symbols->names[step->symbol], step->calls, step->calls == 1 ? "" : "s");
+    }
+    if(h->longest_path.truncated) printf("  ...\n");
+
+    /* os.c aborts a PERIODIC task still running when its wcet-th TICK ends. */
+    budget = longest * (1 + margin);
+    suggested = (uint16_t)floor(budget / cycles_per_tick) + 1;
+    printf("\nsuggested wcet: %u TICKs (%.3f ms with a %.0f%% margin)", suggested, budget / cycles_per_ms,
+           100 * margin);
+    if(level == PERIODIC) {
+        printf(", created with %u%s", wcet, wcet < suggested ? ": TOO SMALL" : "");
+    }
+    printf("\ntask set line: %s %s exec=%.3fms\n", level == PERIODIC ? "periodic" : level == SYSTEM ? "system" : "rr",
+           name, budget / cycles_per_ms);
+    free(sorted);
+}
+
+int main(int argc, char** argv) {
+    uint32_t activations = DEFAULT_ACTIVATIONS, timeout_ticks = DEFAULT_TIMEOUT;
+    double margin = DEFAULT_MARGIN;
+    uint64_t seed = 1;
+    uint8_t packets = DEFAULT_PACKETS;
+    const char* task = NULL;
+    const char* name = NULL;
+    elf_firmware_t firmware;
+    symbols_t symbols;
+    traffic_t traffic;
+    harness_t h;
+    avr_cycle_count_t timeout;
+    int opt, index, found = 0;
+
+    while((opt = getopt(argc, argv, "n:m:r:s:T:t:")) != -1) {
+        switch(opt) {
+            case 'n': activations = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'm': margin = atof(optarg); break;
+            case 'r': packets = (uint8_t)atoi(optarg); break;
+            case 's': seed = strtoull(optarg, NULL, 0); break;
+            case 'T': timeout_ticks = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 't': task = optarg; break;
+            default: task = NULL; optind = argc + 1; break;
+        }
+    }
+    if(!task || optind + 2 != argc || activations == 0) {
+        fprintf(stderr, "usage: wcet [-n activations] [-m margin] [-r packets] [-s seed] [-T ticks] "
+                        "-t task firmware.elf traffic\n");
+        return 2;
+    }
+
+    memset(&firmware, 0, sizeof(firmware));
+    if(elf_read_firmware(argv[optind], &firmware) != 0 || symbols_load(argv[optind], &symbols) != 0) {
+        fprintf(stderr, "wcet: cannot read %s\n", argv[optind]);
+        return 2;
+    }
+    if(firmware.mmcu[0] == '\0') strcpy(firmware.mmcu, DEFAULT_MCU);
+    if(firmware.frequency == 0) firmware.frequency = DEFAULT_FREQUENCY;
+    if(traffic_load(argv[optind + 1], &traffic) != 0) {
+        return 2;
+    }
+    timeout = (avr_cycle_count_t)timeout_ticks * (firmware.frequency / 1000) * TICK;
+
+    /* Find the task: by index, or by trying each index until the firmware names it. */
+    for(index = 0; index < MAXPROCESS - 1 && !found; index++) {
+        char* end;
+        long wanted = strtol(task, &end, 10);
+        if(*end == '\0' && wanted != index) {
+            continue;
+        }
+        memset(&h, 0, sizeof(h));
+        h.traffic = &traffic;
+        h.rng = seed;
+        h.max_packets = packets;
+        if(harness_start(&h, &firmware, (uint8_t)index, timeout) != 0) {
+            harness_stop(&h);
+            break;
+        }
+        name = symbol_at(&symbols, h.describe[1] | h.describe[2] << 8);
+        found = *end == '\0' || strcmp(name, task) == 0;
+        if(!found) harness_stop(&h);
+    }
+    if(!found) {
+        fprintf(stderr, "wcet: r_main() creates no task %s\n", task);
+        return 2;
+    }
+
+    while(h.count < activations && !h.stopped) {
+        int state = avr_run(h.avr);
+        uint32_t word = h.avr->pc >> 1;
+
+        if(h.open && word < symbols.words && symbols.entry[word] != 0) {
+            path_enter(&h.path, symbols.entry[word] - 1);
+        }
+        if(state == cpu_Done || state == cpu_Crashed) {
+            fprintf(stderr, "wcet: the firmware stopped\n");
+            break;
+        }
+        if(h.open && h.avr->cycle - h.begin > timeout) {
+            fprintf(stderr, "wcet: activation %u of %s ran past %u TICKs\n", h.count, name, timeout_ticks);
+            break;
+        }
+    }
+    if(h.mark == WCET_MARK_ABORT) {
+        fprintf(stderr, "wcet: %s called OS_Abort() in activation %u\n", name, h.count);
+    }
+
+    if(h.count > 0) {
+        report(&h, &symbols, name, margin);
+    }
+    found = h.count == activations;
+    harness_stop(&h);
+    return found ? 0 : 1;
+}
@@ -0,0 +1,266 @@
+/*
+ * wcet_os.c
+ *
+ * A stand-in for os.c used to measure task bodies under simavr.
+ *
+ * The application is linked against this file instead of os.c.  main() calls r_main() as
+ * usual, then runs only the task picked by the harness, over and over, with nothing else
+ * scheduled: the cycles between a WCET_MARK_BEGIN and the following WCET_MARK_END are the
+ * task's own.  Service_Subscribe() returns at once, as if the service had been published,
+ * and Service_Publish() does nothing, so the kernel's share of an activation is not counted.
+ * Interrupts stay enabled so drivers that rely on them (the Roomba UART) still work, and
+ * their handlers are counted against the activation they interrupt.
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+#include <setjmp.h>
+#include "os.h"
+#include "wcet_protocol.h"
+
+extern int r_main();
+
+typedef struct
+{
+    void (*f)(void);
+    int16_t arg;
+    uint8_t level;
+    uint16_t period;
+    uint16_t wcet;
+} wcet_task_t;
+
+static wcet_task_t tasks[MAXPROCESS];
+static uint8_t task_count;
+static wcet_task_t* cur_task;
+
+static service_t services[MAXSERVICES];
+static uint8_t service_count;
+
+static uint16_t now;
+
+static jmp_buf restart;
+
+static int8_t create_task(void (*f)(void), int16_t arg, uint8_t level, uint16_t period, uint16_t wcet)
+{
+    if(task_count >= MAXPROCESS - 1) {
+        return 0;
+    }
+    tasks[task_count].f = f;
+    tasks[task_count].arg = arg;
+    tasks[task_count].level = level;
+    tasks[task_count].period = period;
+    tasks[task_count].wcet = wcet;
+    task_count++;
+    return 1;
+}
+
+int8_t Task_Create_System(void (*f)(void), int16_t arg)
+{
+    return create_task(f, arg, SYSTEM, 0, 0);
+}
+
+int8_t Task_Create_RR(void (*f)(void), int16_t arg)
+{
+    return create_task(f, arg, RR, 0, 0);
+}
+
+int8_t Task_Create_Periodic(void(*f)(void), int16_t arg, uint16_t period, uint16_t wcet, uint16_t start)
+{
+    (void)start;
+    return create_task(f, arg, PERIODIC, period, wcet);
+}
+
+/**
+ * End one activation and start the next.
+ */
+void Task_Next()
+{
+    GPIOR0 = WCET_MARK_END;
+    now += TICK;
+    GPIOR0 = WCET_MARK_BEGIN;
+}
+
+void Task_Terminate()
+{
+    GPIOR0 = WCET_MARK_END;
+    longjmp(restart, 1);
+}
+
+int16_t Task_GetArg()
+{
+    return cur_task->arg;
+}
+
+service_t *Service_Init()
+{
+    if(service_count >= MAXSERVICES) {
+        OS_Abort();
+    }
+    return &services[service_count++];
+}
+
+void Service_Subscribe( service_t *s, int16_t *v )
+{
+    (void)s;
+    *v = 0;
+    Task_Next();
+}
+
+void Service_Publish( service_t *s, int16_t v )
+{
+    (void)s;
+    (void)v;
+}
+
+/* Timers never expire. */
+soft_timer_t* Timer_Init(void (*f)(int16_t), int16_t arg, uint16_t ticks, uint8_t reload)
+{
+    (void)f;
+    (void)arg;
+    (void)ticks;
+    (void)reload;
+    return NULL;
+}
+
+void Timer_Start(soft_timer_t* t)
+{
+    (void)t;
+}
+
+void Timer_Stop(soft_timer_t* t)
+{
+    (void)t;
+}
+
+void Timer_Reset(soft_timer_t* t)
+{
+    (void)t;
+}
+
+/* Channels hold nothing: a read ends the activation as a subscribe does, and a write is
+ * always taken. */
+static uint8_t channel;
+
+channel_t* Channel_Init(void* buffer, uint8_t size, uint8_t capacity, uint8_t policy)
+{
+    (void)buffer;
+    (void)size;
+    (void)capacity;
+    (void)policy;
+    return (channel_t*)&channel;
+}
+
+uint8_t Channel_Write(channel_t* c, const void* item)
+{
+    (void)c;
+    (void)item;
+    return 1;
+}
+
+uint32_t Channel_Read(channel_t* c, void* item)
+{
+    (void)c;
+    (void)item;
+    Task_Next();
+    return OS_Time();
+}
+
+uint8_t Channel_Try_Read(channel_t* c, void* item, uint32_t* stamp)
+{
+    (void)c;
+    (void)item;
+    (void)stamp;
+    return 0;
+}
+
+uint16_t Now()
+{
+    return now;
+}
+
+uint32_t OS_Time(void)
+{
+    /* Timer 1 counts, at 2000 to the millisecond. */
+    return (uint32_t)now * 2000;
+}
+
+uint16_t OS_Tick_Us(void)
+{
+    return TICK * 1000;
+}
+
+uint8_t OS_Task_Info(uint8_t task, task_info_t* info)
+{
+    (void)task;
+    (void)info;
+    return 0;
+}
+
+void OS_Periodic_Stats(periodic_stats_t* stats)
+{
+    stats->worst_response = 0;
+    stats->overruns = 0;
+    stats->mode_switches = 0;
+    stats->shed = 0;
+}
+
+uint8_t OS_Service_Info(uint8_t service, service_info_t* info)
+{
+    (void)service;
+    (void)info;
+    return 0;
+}
+
+uint8_t OS_Group_Info(uint8_t group, group_info_t* info)
+{
+    (void)group;
+    (void)info;
+    return 0;
+}
+
+void OS_Abort(void)
+{
+    cli();
+    GPIOR0 = WCET_MARK_ABORT;
+    for(;;);
+}
+
+/**
+ * Describe the task under test to the harness, see wcet_protocol.h.
+ */
+static void describe(const wcet_task_t* task)
+{
+    uint16_t address = (uint16_t)task->f;
+
+    GPIOR1 = task->level;
+    GPIOR1 = address & 0xFF;
+    GPIOR1 = address >> 8;
+    GPIOR1 = task->period & 0xFF;
+    GPIOR1 = task->period >> 8;
+    GPIOR1 = task->wcet & 0xFF;
+    GPIOR1 = task->wcet >> 8;
+}
+
+int main()
+{
+    uint8_t index = eeprom_read_byte((const uint8_t*)WCET_EEPROM_TASK);
+
+    sei();
+    r_main();
+
+    if(index >= task_count) {
+        GPIOR0 = WCET_MARK_NO_TASK;
+        for(;;);
+    }
+    cur_task = &tasks[index];
+    describe(cur_task);
+
+    /* A task that returns or terminates is started again, setup code and all. */
+    setjmp(restart);
+    for(;;) {
+        GPIOR0 = WCET_MARK_BEGIN;
+        cur_task->f();
+        GPIOR0 = WCET_MARK_END;
+    }
+}
@@ -0,0 +1,33 @@
+/*
+ * wcet_protocol.h
+ *
+ * How the profiling build of an application (wcet_os.c) talks to the simavr harness (wcet.c).
+ *
+ * The firmware writes markers to GPIOR0 and a description of the task under test to GPIOR1.
+ * The harness picks the task by writing its index, in the order r_main() creates tasks, to
+ * EEPROM before the firmware starts.
+ */
+
+#ifndef WCET_PROTOCOL_H_
+#define WCET_PROTOCOL_H_
+
+/** Data space addresses of GPIOR0 and GPIOR1 on the ATmega2560. */
+#define WCET_MARK_ADDRESS       0x3E
+#define WCET_DESCRIBE_ADDRESS   0x4A
+
+/** EEPROM byte holding the index of the task to profile. */
+#define WCET_EEPROM_TASK        0
+
+/** Markers written to GPIOR0. */
+#define WCET_MARK_BEGIN         1   /* an activation starts */
+#define WCET_MARK_END           2   /* the task called Task_Next(), Service_Subscribe() or Task_Terminate() */
+#define WCET_MARK_ABORT         3   /* the task called OS_Abort() */
+#define WCET_MARK_NO_TASK       4   /* r_main() did not create that many tasks */
+
+/**
+ * Bytes written to GPIOR1 before the first activation: level, function address (a word
+ * address, low byte first), period (low byte first), wcet (low byte first).
+ */
+#define WCET_DESCRIBE_LENGTH    7
+
+#endif /* WCET_PROTOCOL_H_ */